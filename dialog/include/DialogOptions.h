@@ -54,11 +54,14 @@ private:
     wxSpinCtrl*             mDefaultVideoHeight;
     EnumSelector<model::VideoScaling>* mDefaultVideoScaling;
     EnumSelector<model::VideoAlignment>* mDefaultVideoAlignment;
+    wxSpinCtrl*             mVideoDecodingThreads;
 
     wxComboBox*             mDefaultStillImageLength;
 
     wxComboBox*             mDefaultAudioSampleRate;
     wxComboBox*             mDefaultAudioNumberOfChannels;
+    wxCheckBox*             mAudioCacheEnabled;
+    wxSpinCtrl*             mAudioCacheSize;
 
     wxSpinCtrlDouble*       mMarkerBeginAddition;
     wxSpinCtrlDouble*       mMarkerEndAddition;
@@ -133,6 +133,13 @@ DialogOptions::DialogOptions(wxWindow* win)
 
         mDefaultVideoAlignment = new EnumSelector<model::VideoAlignment>(mPanel, model::VideoAlignmentConverter::getMapToHumanReadibleString(), model::VideoAlignmentConverter::readConfigValue(Config::sPathVideoDefaultAlignment));
         addoption(_("Default video alignment"), mDefaultVideoAlignment);
+
+        addbox(_("Decoding"));
+
+        initial = Config::get().read<int>(Config::sPathVideoDecodingThreads);
+        mVideoDecodingThreads = new wxSpinCtrl(mPanel, wxID_ANY, wxString::Format("%ld", initial), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS | wxALIGN_RIGHT, 0, 256, initial);
+        addoption(_("Maximum number of video decoding threads (0 - number of cores)"), mVideoDecodingThreads);
+        addnote(_("The threads are shared by all video files that are decoded simultaneously (for instance, multiple video tracks)."));
     }
     {
         addtab(_("Images"));
@@ -199,6 +206,18 @@ DialogOptions::DialogOptions(wxWindow* win)
          initial = Config::get().read<int>(Config::sPathAudioDefaultNumberOfChannels);
          mDefaultAudioNumberOfChannels = new wxComboBox(mPanel, wxID_ANY, wxString::Format("%ld", initial),  wxDefaultPosition, wxDefaultSize, channelChoices, 0, channelValidator);
          addoption(_("Default number of audio channels"), mDefaultAudioNumberOfChannels);
+
+        addbox(_("Playback"));
+
+        mAudioCacheEnabled = new wxCheckBox(mPanel, wxID_ANY, _T(""), wxDefaultPosition, wxDefaultSize);
+        mAudioCacheEnabled->SetValue(Config::get().read<bool>(Config::sPathAudioCacheEnabled));
+        addoption(_("Store decoded audio in cache files"), mAudioCacheEnabled);
+        addnote(_("Audio used in sequences is decoded once, in the background. Playback then requires hardly any processing for audio. The cache files require lots of disk space (one hour of stereo audio at 48000 Hz takes 660 MB)."));
+
+        initial = Config::get().read<int>(Config::sPathAudioCacheSize);
+        mAudioCacheSize = new wxSpinCtrl(mPanel, wxID_ANY, wxString::Format("%ld", initial), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS | wxALIGN_RIGHT, 100, 10000000, initial);
+        addoption(_("Maximum size of the audio cache files (MB)"), mAudioCacheSize);
+        addnote(_("When the cache files take more space, the least recently used files are removed."));
     }
     {
         addtab(_("Timeline"));
@@ -318,8 +337,11 @@ DialogOptions::~DialogOptions()
         Config::get().write<long>(Config::sPathVideoDefaultHeight, mDefaultVideoHeight->GetValue());
         Config::get().write<wxString>(Config::sPathVideoDefaultScaling, model::VideoScaling_toString(mDefaultVideoScaling->getValue()).c_str());
         Config::get().write<wxString>(Config::sPathVideoDefaultAlignment, model::VideoAlignment_toString(mDefaultVideoAlignment->getValue()).c_str());
+        Config::get().write<long>(Config::sPathVideoDecodingThreads, mVideoDecodingThreads->GetValue());
         Config::get().write<long>(Config::sPathAudioDefaultSampleRate, toLong(mDefaultAudioSampleRate->GetValue()));
         Config::get().write<long>(Config::sPathAudioDefaultNumberOfChannels, toLong(mDefaultAudioNumberOfChannels->GetValue()));
+        Config::get().write<bool>(Config::sPathAudioCacheEnabled, mAudioCacheEnabled->IsChecked());
+        Config::get().write<long>(Config::sPathAudioCacheSize, mAudioCacheSize->GetValue());
         Config::get().write<bool>(Config::sPathTimelineAutoAddEmptyTrackWhenDragging, mTimelineEnableAutoAddTracks->IsChecked());
         Config::get().write<long>(Config::sPathTimelineMarkerBeginAddition, mMarkerBeginAddition->GetValue());
         Config::get().write<long>(Config::sPathTimelineMarkerEndAddition, mMarkerEndAddition->GetValue());
@@ -31,6 +31,13 @@ namespace util {
 }
 
 namespace model {
+    class AudioCache;
+    class AudioPeaksStore;
+    class DemuxerPool;
+    class FileContextCache;
+    class FileInput;
+    class FileMetaDataStore;
+    class FileValidator;
     class FileWatcher;
     namespace audio {
         class AudioTransitionFactory;
@@ -232,9 +239,17 @@ private:
     Dialog* mDialog = nullptr;
 
     model::FileWatcher* mWatcher = nullptr;
+    model::FileValidator* mValidator = nullptr;
+    model::AudioCache* mAudioCache = nullptr;
 
     util::thread::RunInMainScheduler* mScheduler = nullptr;
 
+    model::FileInput* mFileInput = nullptr;
+    model::DemuxerPool* mDemuxerPool = nullptr;
+    model::FileContextCache* mFileContextCache = nullptr;
+    model::FileMetaDataStore* mFileMetaDataStore = nullptr;
+    model::AudioPeaksStore* mAudioPeaksStore = nullptr;
+
     worker::VisibleWorker*   mVisibleWorker = nullptr;
     worker::InvisibleWorker* mInvisibleWorker = nullptr;
 
@@ -17,6 +17,8 @@
 
 #include "Window.h"
 
+#include "AudioCache.h"
+#include "AudioPeaksStore.h"
 #include "AudioTransitionFactory.h"
 #include "CommandLine.h"
 #include "CommandProcessor.h"
@@ -27,6 +29,11 @@
 #include "DialogOptions.h"
 #include "DialogProjectProperties.h"
 #include "FileAnalyzer.h"
+#include "FileContextCache.h"
+#include "FileDemuxerPool.h"
+#include "FileInput.h"
+#include "FileMetaDataStore.h"
+#include "FileValidator.h"
 #include "Help.h"
 #include "ids.h"
 #include "Node.h"
@@ -118,6 +125,11 @@ Window::Window()
     DragAcceptFiles(true);
 
     // Construction not done in constructor list due to dependency on sCurrent
+    mFileMetaDataStore = new model::FileMetaDataStore();
+    mAudioPeaksStore = new model::AudioPeaksStore();
+    mFileInput       = new model::FileInput();
+    mDemuxerPool     = new model::DemuxerPool();
+    mFileContextCache = new model::FileContextCache();
     mVisibleWorker   = new worker::VisibleWorker();
     mInvisibleWorker = new worker::InvisibleWorker();
     mPreview         = new Preview(this); // Must be opened before timelinesview for the case of autoloading with open sequences/timelines
@@ -531,6 +543,11 @@ Window::~Window()
     delete mDetailsView;
     delete mVisibleWorker;
     delete mInvisibleWorker;
+    delete mDemuxerPool; // After all possible users of files (players, workers) have been destroyed.
+    delete mFileContextCache; // Files closed after this point close their contexts directly.
+    delete mFileInput; // Contexts that are still open keep their files open.
+    delete mFileMetaDataStore; // After the DemuxerPool, since background indexing stores its results.
+    delete mAudioPeaksStore; // After the workers, which may be computing peaks.
     delete mDialog;
     //NOT: delete mDocTemplate;
     delete mDocManager;
@@ -553,9 +570,13 @@ void Window::QueueModelEvent( wxEvent* event )
 void Window::onOpenProject(model::EventOpenProject &event )
 {
     ASSERT_ZERO(mWatcher);
+    ASSERT_ZERO(mValidator);
+    ASSERT_ZERO(mAudioCache);
     // Needs an event loop (under wxGTK)
     // Therefore, creation is delayed until this moment.
     mWatcher = new model::FileWatcher();
+    mValidator = new model::FileValidator(); // After the watcher: changes found by the validator are handled the same way.
+    mAudioCache = new model::AudioCache();
     mMenuFile->Enable(ID_NEW_FILES,true);
     mMenuFile->Enable(ID_NEW_AUTOFOLDER,true);
     mMenuFile->Enable(ID_NEW_SEQUENCE,true);
@@ -577,6 +598,10 @@ void Window::onOpenProject(model::EventOpenProject &event )
 
 void Window::onCloseProject(model::EventCloseProject &event )
 {
+    delete mAudioCache; // Stops decoding, which requires the project's properties.
+    mAudioCache = 0;
+    delete mValidator;
+    mValidator = 0;
     delete mWatcher;
     mWatcher = 0;
     mMenuFile->Enable(ID_NEW_FILES,false);
@@ -123,6 +123,27 @@ protected:
     IClipPtr iterate_get();
     void iterate_next();
 
+    //////////////////////////////////////////////////////////////////////////
+    // LOOKAHEAD
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Start preparing the clip after the current clip of the iteration in a
+    /// separate thread, if the current clip ends within the lookahead period.
+    /// Preparing typically moves that clip to its beginning and retrieves its
+    /// first frame/chunk, which causes the file to be opened, the decoder to be
+    /// started, and (for transitions) the left and right clips to be made.
+    /// That way, switching to the next clip does not delay playback.
+    /// \param position position (in the track) of the frame/chunk that was just retrieved
+    /// \param prepare method executed in the lookahead thread for the clip to be prepared
+    void lookahead_start(pts position, const std::function<void(const IClipPtr&)>& prepare);
+
+    /// Wait until the preparation of the given clip (if started) has finished.
+    /// \return true if the given clip was prepared. Then, the clip has been moved already.
+    bool lookahead_finish(const IClipPtr& clip);
+
+    /// Stop any lookahead. The clip being prepared (if any) is cleaned.
+    void lookahead_cancel();
+
 private:
 
     //////////////////////////////////////////////////////////////////////////
@@ -133,6 +154,9 @@ private:
 
     IClips::const_iterator mItClips;
 
+    IClipPtr mLookaheadClip = nullptr; ///< Clip being prepared (or prepared) by mLookaheadThread.
+    boost::thread mLookaheadThread;
+
     int mHeight = sDefaultTrackHeight;  ///< Height of this track when viewed in a timeline
     int mIndex = 0;                     ///< Index in the list of video/audio tracks
 
@@ -162,6 +186,9 @@ private:
     /// (and any changes thereof) have been signaled to the view classes.
     void updateLength();
 
+    /// Wait until the lookahead thread (if any) has finished.
+    void lookahead_wait();
+
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
     //////////////////////////////////////////////////////////////////////////
@@ -19,16 +19,21 @@
 
 #include "Calculate.h"
 #include "Clip.h"
+#include "Convert.h"
 #include "EmptyClip.h"
 #include "ModelEvent.h"
 #include "Node.h"
 #include "ProjectModification.h"
 #include "TrackEvent.h"
 #include "UtilSet.h"
+#include "UtilThread.h"
 #include "UtilVector.h"
 
 namespace model {
 
+/// Period before a cut at which the preparation of the clip after the cut is started.
+static const milliseconds sTrackLookaheadTime{ 1000 };
+
 Track::Track()
 :   wxEvtHandler()
 ,	IControl()
@@ -67,6 +72,7 @@ void Track::onLoad()
 Track::~Track()
 {
     VAR_DEBUG(this);
+    lookahead_cancel();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -81,10 +87,11 @@ pts Track::getLength() const
 void Track::moveTo(pts position)
 {
     VAR_DEBUG(this)(position);
+    lookahead_cancel();
 
     if (!iterate_atEnd())
     {
-        iterate_get()->clean(); // Reset any running threads (particularly, bufferPacketsThread)
+        iterate_get()->clean(); // Reset any running threads (particularly, the file's demuxer)
     }
 
     // mItClips may become mClips.end() signaling that this is beyond the last clip
@@ -126,6 +133,7 @@ wxString Track::getDescription() const
 void Track::clean()
 {
     VAR_DEBUG(this);
+    lookahead_cancel();
     for (IClipPtr clip : mClips)
     {
         clip->clean();
@@ -336,7 +344,8 @@ IClipPtr Track::iterate_get()
 void Track::iterate_next()
 {
     ASSERT(!iterate_atEnd());
-    iterate_get()->clean(); // Reset any running threads (particularly, bufferPacketsThread)
+    lookahead_wait(); // Preparing a transition clones the current clip.
+    iterate_get()->clean(); // Reset any running threads (particularly, the file's demuxer)
     mItClips++;
     while (!iterate_atEnd() && iterate_get()->getLength() == 0) // Step over clips with length 0. These are only used as part of a transition.
     {
@@ -344,6 +353,66 @@ void Track::iterate_next()
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+// LOOKAHEAD
+//////////////////////////////////////////////////////////////////////////
+
+void Track::lookahead_start(pts position, const std::function<void(const IClipPtr&)>& prepare)
+{
+    if (mLookaheadClip != nullptr) { return; } // Already started
+    if (iterate_atEnd()) { return; }
+    if (position + Convert::timeToPts(sTrackLookaheadTime) < iterate_get()->getRightPts()) { return; }
+
+    IClips::const_iterator it{ mItClips };
+    ++it;
+    while (it != mClips.end() && (*it)->getLength() == 0) { ++it; } // Same as iterate_next()
+    if (it == mClips.end()) { return; }
+    if ((*it)->isA<EmptyClip>()) { return; } // Nothing to prepare
+
+    // Note: Preparing a transition makes clones of the adjacent clips (including
+    //       the current clip). Only attributes that are not changed during playback
+    //       are copied when cloning, thus that can be done in parallel with playback.
+    //       The current clip is only cleaned after the preparation has finished.
+    IClipPtr clip{ *it };
+    VAR_DEBUG(this)(position)(clip);
+    mLookaheadClip = clip;
+    mLookaheadThread = boost::thread([clip, prepare]
+    {
+        util::thread::setCurrentThreadName("Lookahead");
+        prepare(clip);
+    });
+}
+
+bool Track::lookahead_finish(const IClipPtr& clip)
+{
+    if (mLookaheadClip == nullptr) { return false; }
+    lookahead_wait();
+    bool result{ mLookaheadClip == clip };
+    if (!result)
+    {
+        mLookaheadClip->clean();
+    }
+    mLookaheadClip.reset();
+    return result;
+}
+
+void Track::lookahead_cancel()
+{
+    if (mLookaheadClip == nullptr) { return; }
+    VAR_DEBUG(this)(mLookaheadClip);
+    lookahead_wait();
+    mLookaheadClip->clean();
+    mLookaheadClip.reset();
+}
+
+void Track::lookahead_wait()
+{
+    if (mLookaheadThread.joinable())
+    {
+        mLookaheadThread.join();
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // HELPER METHODS
 //////////////////////////////////////////////////////////////////////////
@@ -353,6 +422,7 @@ void Track::updateClips()
     // NOTE: any information updated here must also be serialized in the clip,
     //       since this method is not called during (de)serialization, since
     //       the shared_from_this() handling causes problems then.
+    lookahead_cancel(); // Clips may have been removed or moved.
     pts position = 0;
     int index = 0;
     IClipPtr prev; // First clip has no previous clip
@@ -0,0 +1,179 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "UtilSingleInstance.h"
+
+class MemoryMappedFile;
+
+namespace model {
+
+class AudioCompositionParameters;
+
+/// Decoded audio of one file: interleaved 16 bit samples at the project's
+/// sample rate and number of channels, memory mapped from a cache file.
+class AudioCacheFile
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Map the given cache file. If the file is invalid, or if it holds the
+    /// audio of another file (see AudioCache::getKey), isValid() returns false.
+    AudioCacheFile(const wxFileName& path, const wxString& key, int sampleRate, int nChannels);
+    AudioCacheFile(const AudioCacheFile&) = delete;
+    AudioCacheFile& operator=(const AudioCacheFile&) = delete;
+    virtual ~AudioCacheFile();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    bool isValid() const;
+
+    /// \return true if the data can be used for the given parameters
+    bool matches(const AudioCompositionParameters& parameters) const;
+
+    int getSampleRate() const;
+    int getNrChannels() const;
+
+    /// \return start of the (interleaved) samples
+    const sample* getData() const;
+
+    /// \return number of samples per channel
+    samplecount getLength() const;
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    std::unique_ptr<MemoryMappedFile> mFile;
+    int mSampleRate;
+    int mNrChannels;
+    const sample* mData = nullptr;
+    samplecount mLength = 0;
+};
+
+typedef boost::shared_ptr<const AudioCacheFile> AudioCacheFilePtr;
+
+/// Opt-in cache of decoded audio (see Config::sPathAudioCacheEnabled).
+///
+/// Normally, all audio is decoded (and resampled) again upon each playback,
+/// scrub, or render. With the cache enabled, each audio file that is played
+/// is decoded once (in one background thread, one file at a time) into a
+/// cache file holding all samples in the format that is used for playback.
+/// Subsequently, AudioFile copies the samples directly from the memory
+/// mapped cache file, without decoding.
+///
+/// Cache files are shared by all projects. A cache file is identified by the
+/// audio file's path, size, and modification time, and by the sample rate and
+/// number of channels. Thus, a changed file is never matched with outdated
+/// samples. The name of a cache file is a hash of that identification. The
+/// identification itself is also stored in the file, and checked when the
+/// file is used. Cache files are written under a temporary name first, and
+/// renamed when complete.
+///
+/// The total size of the cache files is bounded (see Config::sPathAudioCacheSize).
+/// After writing a cache file, the least recently used files are removed until
+/// the cache fits in its budget again.
+///
+/// Exists only while a project is opened, since decoding requires the
+/// project's properties.
+class AudioCache
+    :   public SingleInstance<AudioCache>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    AudioCache();
+    AudioCache(const AudioCache&) = delete;
+    AudioCache& operator=(const AudioCache&) = delete;
+    virtual ~AudioCache();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return decoded audio of the given file, nullptr if the cache is disabled,
+    ///         if the parameters can not be served from a cache file (speed
+    ///         changes), or if the file has not been decoded yet. In the latter
+    ///         case, decoding (of a clone of the file) is scheduled.
+    static AudioCacheFilePtr find(const AudioFile& file, const AudioCompositionParameters& parameters);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Job
+    {
+        AudioFilePtr File;
+        wxString Key;
+        wxFileName CacheFile;
+        int SampleRate;
+        int NrChannels;
+    };
+
+    bool mStop = false;
+
+    boost::mutex mMutex;
+    boost::condition_variable mCondition;
+    std::deque<Job> mQueue;
+    std::set<wxString> mPending;  ///< Cache files that are being written.
+    std::map<wxString, boost::weak_ptr<const AudioCacheFile>> mMapped;    ///< Reuse one mapping for all AudioFiles of the same file.
+
+    boost::scoped_ptr<boost::thread> mThread;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return identification of the cached audio, empty if the audio file can not be identified.
+    static wxString getKey(const wxFileName& path, int sampleRate, int nChannels);
+
+    /// \return cache file for the given audio
+    static wxFileName getCacheFile(const wxString& key, int sampleRate, int nChannels);
+
+    void thread();
+
+    /// Executed in the cache thread.
+    /// \return true if the complete file was decoded.
+    bool decode(const Job& job);
+
+    /// Remove the least recently used cache files, until the total size of
+    /// all cache files is within the budget. Executed in the cache thread.
+    /// \param written file that was just written. Never removed, since that
+    ///        would cause the same file to be decoded over and over again.
+    void cleanup(const wxFileName& written);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const AudioCache& obj);
+};
+
+} // namespace
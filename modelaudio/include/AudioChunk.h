@@ -17,18 +17,22 @@
 
 #pragma once
 
-#include "UtilFifo.h"
+#include "UtilRingBuffer.h"
 #include "UtilRTTI.h"
 
 namespace model {
 
-typedef Fifo<AudioChunkPtr> FifoAudio;
+typedef RingBuffer<AudioChunkPtr, RingBufferProducers::Multiple> FifoAudio; ///< Multiple: the video buffer thread may insert the end marker upon errors.
 std::ostream& operator<<(std::ostream& os, const AudioChunkPtr obj);
 
 /// Class holds audio samples
 ///
 /// A sample is the data for one speaker.  Its size is typically two bytes.
 /// A frame  is the data for all speakers. Its size is 'the number of channels' * 'the size of one sample'
+///
+/// Allocated buffers are recycled: when a chunk is destructed, its buffer is
+/// kept for a next chunk of (roughly) the same size. During playback, chunks
+/// are created and destroyed continuously, and mostly have the same size.
 class AudioChunk
     :   public IRTTI
 {
@@ -50,6 +54,11 @@ public:
     /// \pre buffer ==> allocate && !zero
     AudioChunk(int nChannels, samplecount nSamples, bool allocate, bool zero, sample* buffer = 0);
 
+    /// Take over the data of a decoded frame, without copying.
+    /// \param nChannels number of audio channels
+    /// \param frame decoded frame holding (reference counted) interleaved 16 bit samples. Upon return, frame is reset (and can be reused).
+    AudioChunk(int nChannels, AVFrame* frame);
+
     AudioChunk(const AudioChunk& other) = delete;
     AudioChunk& operator=(const AudioChunk&) = delete;
 
@@ -112,6 +121,9 @@ protected:
 
 private:
 
+    bool mPooled = false;           ///< True if mBuffer was taken from the pool of buffers.
+    AVFrame* mFrame = nullptr;      ///< If set, mBuffer points into the data of this frame.
+
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
     //////////////////////////////////////////////////////////////////////////
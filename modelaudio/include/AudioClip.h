@@ -17,7 +17,7 @@
 
 #pragma once
 
-#include "AudioPeaks.h"
+#include "AudioPeaksStore.h"
 #include "ClipInterval.h"
 #include "IAudio.h"
 #include "UtilSoundTouch.h"
@@ -77,7 +77,12 @@ public:
     // AUDIOCLIP
     //////////////////////////////////////////////////////////////////////////
 
-    AudioPeaks getPeaks(const AudioCompositionParameters& parameters);
+    /// \param level resolution of the returned peaks. Level 0 has sPeaksPerPts
+    ///        peaks per pts. Each next level has half the number of peaks of
+    ///        the previous level (see AudioPeaks::reduce). If the given level
+    ///        does not exist, the lowest available resolution is returned.
+    /// \return peaks of the clip (including any adjacent transitions)
+    AudioPeaks getPeaks(const AudioCompositionParameters& parameters, int level = 0);
 
 protected:
 
@@ -114,9 +119,33 @@ private:
 
     std::unique_ptr<util::SoundTouch> mSoundTouch = nullptr;
 
-    /// Cached for performance (stored in the save file to avoid recalculating).
+    /// Cached for performance (stored in the AudioPeaksStore to avoid recalculating).
     /// \note peaks are stored, given a clip's speed and key frames.
-    boost::shared_ptr<AudioPeaks> mPeaks = nullptr;
+    /// Once made, never changed: shared with clones.
+    AudioPeaksFilePtr mPeaks = nullptr;
+
+    /// Id of mPeaks in the AudioPeaksStore. Stored in the save file, such that
+    /// the peaks are found again without recalculating (see getPeaksKey).
+    wxString mPeaksId;
+
+    /// Lower resolutions of mPeaks (not stored in the save file, derived when required).
+    /// Once made, never changed: shared with clones.
+    boost::shared_ptr<const std::vector<AudioPeaks>> mPeakLevels = nullptr;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Decode (part of) the clip and determine the peaks (at level 0).
+    /// \param begin first position (in the clip) to be decoded
+    /// \param end position up to which peaks are required
+    /// \return peaks without volume adjustments. Fewer than required if the audio data ends early.
+    AudioPeaks computePeaks(const AudioCompositionParameters& parameters, pts begin, pts end);
+
+    /// \return all parameters that determine the peaks (file, speed and volume),
+    ///         empty if the file can not be identified.
+    /// \pre clip has been maximized
+    wxString getPeaksKey() const;
 
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
@@ -135,5 +164,5 @@ private:
 
 } // namespace
 
-BOOST_CLASS_VERSION(model::AudioClip, 4)
+BOOST_CLASS_VERSION(model::AudioClip, 5)
 BOOST_CLASS_EXPORT_KEY(model::AudioClip)
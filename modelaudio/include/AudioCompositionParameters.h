@@ -32,6 +32,12 @@ public:
     AudioCompositionParameters();
     AudioCompositionParameters(const AudioCompositionParameters& other);
 
+    //////////////////////////////////////////////////////////////////////////
+    // OPERATORS
+    //////////////////////////////////////////////////////////////////////////
+
+    bool operator==( const AudioCompositionParameters& other ) const;
+
     //////////////////////////////////////////////////////////////////////////
     // GET/SET
     //////////////////////////////////////////////////////////////////////////
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "AudioCache.h"
 #include "File.h"
 #include "IAudio.h"
 
@@ -84,7 +85,10 @@ private:
     SwrContext* mSoftwareResampleContext = nullptr;
     int mNrPlanes = 0;
     boost::optional<pts> mNewStartPosition = boost::none;
-    std::vector< std::vector<uint8_t> > mAudioDecodeBuffer;
+    AVFrame* mFrame = nullptr;  ///< Decoded data. Reused for each decode call.
+
+    AudioCacheFilePtr mCache = nullptr;     ///< If set, the audio is read from this cache file instead of being decoded.
+    samplecount mCachePosition = 0;         ///< Next sample (per channel) to be read from mCache.
 
     //////////////////////////////////////////////////////////////////////////
     // HELPER METHODS
@@ -93,6 +97,13 @@ private:
     void startDecodingAudio(const AudioCompositionParameters& parameters);
     void stopDecodingAudio();
 
+    /// Feed a packet to the decoder, without using the decoded audio.
+    /// Used for the packets preceding the first required packet after a move.
+    void decodeAndDiscard(const PacketPtr& packet);
+
+    /// Return the next chunk from mCache.
+    AudioChunkPtr getNextCachedAudio(const AudioCompositionParameters& parameters);
+
     /// \param pts position (in stream time base units) of a packet returned from ffmpeg
     /// \return number of the first sample in this packet
     samplecount getFirstSample(int64_t pts);
@@ -21,6 +21,11 @@ namespace model {
 
 typedef std::pair< std::pair<sample,sample>, std::pair<sample, sample> > AudioPeak;
 
+/// Minimum/maximum and RMS values for consecutive intervals of audio.
+///
+/// For drawing an overview (zoomed out timeline) of long clips, peaks are
+/// also available at lower resolutions (see AudioClip::getPeaks). Each
+/// lower resolution level is derived from the next higher level via reduce().
 class AudioPeaks : public std::vector < AudioPeak >
 {
 public:
@@ -32,6 +37,14 @@ public:
     AudioPeaks();
     AudioPeaks(AudioPeaks::const_iterator b, AudioPeaks::const_iterator e);
 
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return peaks at half the resolution: each peak combines two
+    ///         consecutive peaks (minimum, maximum, and the RMS of both).
+    AudioPeaks reduce() const;
+
     //////////////////////////////////////////////////////////////////////////
     // SERIALIZATION
     //////////////////////////////////////////////////////////////////////////
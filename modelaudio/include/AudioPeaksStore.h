@@ -0,0 +1,159 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "AudioPeaks.h"
+#include "UtilSingleInstance.h"
+
+class MemoryMappedFile;
+
+namespace model {
+
+/// Immutable peaks of one clip. Either memory mapped from a file of the
+/// AudioPeaksStore, or (if the peaks could not be stored) held in memory.
+class AudioPeaksFile
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Map the given peaks file. If the file is invalid, isValid() returns false.
+    explicit AudioPeaksFile(const wxFileName& path);
+
+    /// Hold the given peaks in memory.
+    explicit AudioPeaksFile(AudioPeaks&& peaks);
+
+    AudioPeaksFile(const AudioPeaksFile&) = delete;
+    AudioPeaksFile& operator=(const AudioPeaksFile&) = delete;
+    virtual ~AudioPeaksFile();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    bool isValid() const;
+
+    const AudioPeak* getData() const;
+
+    /// \return number of peaks
+    size_t getSize() const;
+
+    /// \return copy of the peaks in [begin, end)
+    AudioPeaks get(size_t begin, size_t end) const;
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    std::unique_ptr<MemoryMappedFile> mFile;
+    AudioPeaks mPeaks;
+    const AudioPeak* mData = nullptr;
+    size_t mSize = 0;
+};
+
+typedef boost::shared_ptr<const AudioPeaksFile> AudioPeaksFilePtr;
+
+/// Store for the peaks of audio clips, shared by all projects.
+///
+/// Computing the peaks of a clip requires decoding the entire audio file.
+/// Previously, the results were stored in the save file, which made saving
+/// and loading of projects with much audio slow. Now, each set of peaks is
+/// written to a separate file in the store, and a project only refers to
+/// that file via its id. The file is memory mapped when the peaks are first
+/// drawn, and that mapping is shared by all clips (and clones) with the same
+/// id.
+///
+/// The id is derived from everything that determines the peaks: the audio
+/// file's path, size, and modification time, the clip's speed, and its
+/// volume (key frames). Thus, equal clips in different projects share their
+/// peaks, and a changed clip never refers to outdated peaks.
+///
+/// The store is bounded: when adding peaks causes the combined size of all
+/// files to exceed the budget, the least recently used files are removed.
+/// Files referred to by a (saved) project can thus disappear, in which case
+/// the peaks are computed again when needed.
+///
+/// When running the automated tests, nothing is stored on disk (tests must not
+/// depend on the results of earlier runs).
+class AudioPeaksStore
+    :   public SingleInstance<AudioPeaksStore>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    AudioPeaksStore();
+    AudioPeaksStore(const AudioPeaksStore&) = delete;
+    AudioPeaksStore& operator=(const AudioPeaksStore&) = delete;
+    virtual ~AudioPeaksStore();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \param key all parameters that determine the peaks
+    /// \return id for the given key, empty if key is empty
+    static wxString getId(const wxString& key);
+
+    /// \return stored peaks, nullptr if there are no (valid) peaks for the given id.
+    static AudioPeaksFilePtr find(const wxString& id);
+
+    /// Store the peaks for the given id. If the peaks can not be stored
+    /// (empty id, write error) they are only kept in memory.
+    /// \return peaks for the given id (mapped from the stored file, if possible)
+    static AudioPeaksFilePtr add(const wxString& id, AudioPeaks peaks);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    const bool mPersistent;
+    boost::mutex mMutex;
+    std::map<wxString, boost::weak_ptr<const AudioPeaksFile>> mMapped; ///< Reuse one mapping (or the in-memory peaks, if not persistent) for all clips with the same id.
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    static wxFileName getFile(const wxString& id);
+
+    /// \return true if the peaks were written to the given file.
+    static bool write(const wxFileName& file, const AudioPeaks& peaks);
+
+    /// Remove the least recently used files until the combined size of
+    /// all files is within the budget.
+    /// \param written file that was just written. Never removed.
+    void cleanup(const wxFileName& written);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const AudioPeaksStore& obj);
+};
+
+} // namespace
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "Track.h"
+#include "AudioCompositionParameters.h"
 #include "IAudio.h"
 
 namespace model {
@@ -62,6 +63,13 @@ protected:
 
 private:
 
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    AudioChunkPtr mLookaheadChunk = nullptr;                                ///< First chunk of the next clip, retrieved in advance.
+    boost::optional<AudioCompositionParameters> mLookaheadParameters = boost::none; ///< Parameters used for retrieving mLookaheadChunk.
+
     //////////////////////////////////////////////////////////////////////////
     // SERIALIZATION
     //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,365 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "AudioCache.h"
+
+#include "AudioChunk.h"
+#include "AudioCompositionParameters.h"
+#include "AudioFile.h"
+#include "Config.h"
+#include "UtilMemoryMappedFile.h"
+#include "UtilPath.h"
+#include "UtilThread.h"
+
+namespace model {
+
+/// Layout of the start of each cache file. The key (see AudioCache::getKey)
+/// follows directly, then the samples (see getAudioCacheDataOffset).
+struct AudioCacheHeader
+{
+    char Magic[4] = { 'V', 'P', 'C', 'M' };
+    uint32_t Version = 2;
+    int32_t SampleRate = 0;
+    int32_t NrChannels = 0;
+    int64_t Length = 0;     ///< Number of samples per channel.
+    uint32_t KeySize = 0;   ///< Number of bytes of the key (UTF-8).
+    uint32_t Padding = 0;
+};
+
+/// \return offset of the samples in a cache file with a key of the given size
+static size_t getAudioCacheDataOffset(size_t keySize)
+{
+    return sizeof(AudioCacheHeader) + (keySize + 7) / 8 * 8; // Keep the samples aligned.
+}
+
+//////////////////////////////////////////////////////////////////////////
+// AUDIOCACHEFILE
+//////////////////////////////////////////////////////////////////////////
+
+AudioCacheFile::AudioCacheFile(const wxFileName& path, const wxString& key, int sampleRate, int nChannels)
+    : mFile{ std::make_unique<MemoryMappedFile>(path) }
+    , mSampleRate{ sampleRate }
+    , mNrChannels{ nChannels }
+{
+    if (mFile->getData() == nullptr || mFile->getSize() < sizeof(AudioCacheHeader)) { return; }
+    wxScopedCharBuffer utf8{ key.utf8_str() };
+    AudioCacheHeader expected;
+    AudioCacheHeader header;
+    memcpy(&header, mFile->getData(), sizeof(AudioCacheHeader));
+    size_t offset{ getAudioCacheDataOffset(header.KeySize) };
+    if (memcmp(header.Magic, expected.Magic, sizeof(header.Magic)) != 0 ||
+        header.Version != expected.Version ||
+        header.SampleRate != sampleRate ||
+        header.NrChannels != nChannels ||
+        header.Length <= 0 ||
+        header.KeySize != utf8.length() ||
+        mFile->getSize() < offset + static_cast<size_t>(header.Length * nChannels) * AudioChunk::sBytesPerSample)
+    {
+        VAR_WARNING(path)(mFile->getSize())(header.Version)(header.SampleRate)(header.NrChannels)(header.Length)(header.KeySize);
+        return;
+    }
+    if (memcmp(mFile->getData() + sizeof(AudioCacheHeader), utf8.data(), utf8.length()) != 0)
+    {
+        VAR_WARNING(path)(key); // Same hash for another file.
+        return;
+    }
+    mData = reinterpret_cast<const sample*>(mFile->getData() + offset);
+    mLength = header.Length;
+}
+
+AudioCacheFile::~AudioCacheFile()
+{
+}
+
+bool AudioCacheFile::isValid() const
+{
+    return mData != nullptr;
+}
+
+bool AudioCacheFile::matches(const AudioCompositionParameters& parameters) const
+{
+    return
+        parameters.getSampleRate() == mSampleRate &&
+        parameters.getNrChannels() == mNrChannels &&
+        parameters.getSpeed() == 1;
+}
+
+int AudioCacheFile::getSampleRate() const
+{
+    return mSampleRate;
+}
+
+int AudioCacheFile::getNrChannels() const
+{
+    return mNrChannels;
+}
+
+const sample* AudioCacheFile::getData() const
+{
+    return mData;
+}
+
+samplecount AudioCacheFile::getLength() const
+{
+    return mLength;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+AudioCache::AudioCache()
+{
+    VAR_DEBUG(this);
+}
+
+AudioCache::~AudioCache()
+{
+    VAR_DEBUG(this);
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    if (mThread)
+    {
+        mThread->join();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+// static
+AudioCacheFilePtr AudioCache::find(const AudioFile& file, const AudioCompositionParameters& parameters)
+{
+    if (!exists() ||
+        parameters.getSpeed() != 1 ||
+        !Config::get().read<bool>(Config::sPathAudioCacheEnabled))
+    {
+        return nullptr;
+    }
+    wxString id{ getKey(file.getPath(), parameters.getSampleRate(), parameters.getNrChannels()) };
+    if (id.IsEmpty()) { return nullptr; }
+    wxFileName cacheFile{ getCacheFile(id, parameters.getSampleRate(), parameters.getNrChannels()) };
+    wxString key{ cacheFile.GetFullPath() };
+
+    AudioCache& cache{ get() };
+    boost::mutex::scoped_lock lock(cache.mMutex);
+    if (cache.mStop || cache.mPending.find(key) != cache.mPending.end())
+    {
+        return nullptr;
+    }
+    auto it = cache.mMapped.find(key);
+    if (it != cache.mMapped.end())
+    {
+        AudioCacheFilePtr mapped{ it->second.lock() };
+        if (mapped) { return mapped; }
+        cache.mMapped.erase(it);
+    }
+    if (cacheFile.FileExists())
+    {
+        cacheFile.Touch(); // Mark as recently used (see cleanup). Before mapping, since a mapped file may not allow changing its times.
+        AudioCacheFilePtr mapped{ boost::make_shared<AudioCacheFile>(cacheFile, id, parameters.getSampleRate(), parameters.getNrChannels()) };
+        if (mapped->isValid())
+        {
+            cache.mMapped[key] = mapped;
+            return mapped;
+        }
+        // Invalid (truncated) file: decode again.
+    }
+
+    Job job;
+    job.File = AudioFilePtr(file.clone());
+    job.File->onCloned();
+    job.Key = id;
+    job.CacheFile = cacheFile;
+    job.SampleRate = parameters.getSampleRate();
+    job.NrChannels = parameters.getNrChannels();
+    cache.mQueue.emplace_back(job);
+    cache.mPending.insert(key);
+    if (!cache.mThread)
+    {
+        cache.mThread.reset(new boost::thread(std::bind(&AudioCache::thread, &cache)));
+    }
+    cache.mCondition.notify_all();
+    return nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+wxString AudioCache::getKey(const wxFileName& path, int sampleRate, int nChannels)
+{
+    boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(path) };
+    if (!identity)
+    {
+        return "";
+    }
+    return wxString::Format("%s|%d|%d", identity->toString(), sampleRate, nChannels);
+}
+
+// static
+wxFileName AudioCache::getCacheFile(const wxString& key, int sampleRate, int nChannels)
+{
+    std::string utf8{ key.ToUTF8().data() };
+    wxFileName result{ util::path::getAudioCachePath() };
+    result.SetName(wxString::Format("%016" PRIx64 "_%d_%d", static_cast<uint64_t>(std::hash<std::string>()(utf8)), sampleRate, nChannels));
+    result.SetExt("pcm");
+    return result;
+}
+
+void AudioCache::thread()
+{
+    util::thread::setCurrentThreadName("AudioCache");
+    while (true)
+    {
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (!mStop && mQueue.empty())
+            {
+                mCondition.wait(lock);
+            }
+            if (mStop)
+            {
+                break;
+            }
+            job = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        bool done{ decode(job) };
+        VAR_INFO(job.File->getPath())(job.CacheFile)(done);
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mPending.erase(job.CacheFile.GetFullPath());
+        }
+        if (done)
+        {
+            cleanup(job.CacheFile);
+        }
+    }
+}
+
+bool AudioCache::decode(const Job& job)
+{
+    // Only complete files are ever used.
+    return util::path::writeAtomically(job.CacheFile, [this, &job](wxFile& file) -> bool
+    {
+        wxScopedCharBuffer key{ job.Key.utf8_str() };
+        std::vector<char> padding(getAudioCacheDataOffset(key.length()) - sizeof(AudioCacheHeader) - key.length(), 0);
+        AudioCacheHeader header;
+        header.SampleRate = job.SampleRate;
+        header.NrChannels = job.NrChannels;
+        header.KeySize = narrow_cast<uint32_t>(key.length());
+        if (file.Write(&header, sizeof(AudioCacheHeader)) != sizeof(AudioCacheHeader) ||
+            file.Write(key.data(), key.length()) != key.length() ||
+            file.Write(padding.data(), padding.size()) != padding.size())
+        {
+            return false;
+        }
+
+        AudioCompositionParameters parameters;
+        parameters.setSampleRate(job.SampleRate).setNrChannels(job.NrChannels).setPts(0).determineChunkSize();
+        job.File->moveTo(0);
+
+        samplecount nSamples{ 0 };
+        bool ok{ true };
+        while (ok)
+        {
+            {
+                boost::mutex::scoped_lock lock(mMutex);
+                if (mStop) { ok = false; break; } // Project closed: continue upon a next playback.
+            }
+            AudioChunkPtr chunk{ job.File->getNextAudio(parameters) };
+            if (!chunk) { break; } // End of file
+            size_t bytes{ static_cast<size_t>(chunk->getUnreadSampleCount()) * AudioChunk::sBytesPerSample };
+            ok = !chunk->getError() &&
+                file.Write(chunk->getUnreadSamples(), bytes) == bytes;
+            nSamples += chunk->getUnreadSampleCount();
+        }
+        job.File->clean();
+
+        header.Length = nSamples / job.NrChannels;
+        return ok &&
+            header.Length > 0 &&
+            file.Seek(0) == 0 &&
+            file.Write(&header, sizeof(AudioCacheHeader)) == sizeof(AudioCacheHeader);
+    });
+}
+
+void AudioCache::cleanup(const wxFileName& written)
+{
+    wxFileName folder{ util::path::getAudioCachePath() };
+    if (!folder.DirExists()) { return; }
+    int64_t budget{ static_cast<int64_t>(Config::get().read<int>(Config::sPathAudioCacheSize)) * 1024 * 1024 };
+
+    wxArrayString names;
+    wxDir::GetAllFiles(folder.GetLongPath(), &names, "*.pcm", wxDIR_FILES);
+    std::vector<util::path::FileIdentity> files;
+    int64_t total{ 0 };
+    for (const wxString& name : names)
+    {
+        boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(wxFileName(name)) };
+        if (identity)
+        {
+            files.emplace_back(*identity);
+            total += identity->Size;
+        }
+    }
+    if (total <= budget) { return; }
+
+    // Each file's modification time is updated when it is used (see find()).
+    std::sort(files.begin(), files.end(), [](const util::path::FileIdentity& f1, const util::path::FileIdentity& f2) { return f1.Modified < f2.Modified; });
+    boost::mutex::scoped_lock lock(mMutex); // Avoid removing a file that is mapped by find() simultaneously.
+    for (const util::path::FileIdentity& file : files)
+    {
+        if (total <= budget) { break; }
+        wxString key{ wxFileName(file.Path).GetFullPath() };
+        auto it = mMapped.find(key);
+        if ((it != mMapped.end() && !it->second.expired()) ||
+            mPending.find(key) != mPending.end() ||
+            key == written.GetFullPath())
+        {
+            continue; // In use.
+        }
+        if (wxRemoveFile(file.Path))
+        {
+            total -= file.Size;
+        }
+    }
+    VAR_INFO(total)(budget);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const AudioCache& obj)
+{
+    os  << &obj << '|'
+        << obj.mQueue.size() << '|'
+        << obj.mPending.size() << '|'
+        << obj.mMapped.size();
+    return os;
+}
+
+} //namespace
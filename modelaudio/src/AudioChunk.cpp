@@ -21,6 +21,73 @@ namespace model {
 
 const int AudioChunk::sBytesPerSample = 2;
 
+/// Buffer sizes are rounded up to a multiple of this number of samples, for better reuse.
+static const samplecount sAudioChunkPoolGranularity{ 4096 };
+
+/// Maximum number of unused buffers that is kept.
+static const size_t sAudioChunkPoolMaximum{ 64 };
+
+/// Unused chunk buffers, per buffer size.
+class AudioChunkPool
+{
+public:
+
+    ~AudioChunkPool()
+    {
+        for (auto size_buffers : mBuffers)
+        {
+            for (sample* buffer : size_buffers.second)
+            {
+                free(buffer);
+            }
+        }
+    }
+
+    static samplecount getSize(samplecount nSamples)
+    {
+        return ((nSamples + sAudioChunkPoolGranularity - 1) / sAudioChunkPoolGranularity) * sAudioChunkPoolGranularity;
+    }
+
+    sample* take(samplecount nSamples)
+    {
+        samplecount size{ getSize(nSamples) };
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            auto it = mBuffers.find(size);
+            if (it != mBuffers.end() && !it->second.empty())
+            {
+                sample* result{ it->second.back() };
+                it->second.pop_back();
+                --mCount;
+                return result;
+            }
+        }
+        return static_cast<sample*>(malloc(size * AudioChunk::sBytesPerSample));
+    }
+
+    void give(sample* buffer, samplecount nSamples)
+    {
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (mCount < sAudioChunkPoolMaximum)
+            {
+                mBuffers[getSize(nSamples)].push_back(buffer);
+                ++mCount;
+                return;
+            }
+        }
+        free(buffer);
+    }
+
+private:
+
+    boost::mutex mMutex;
+    std::map<samplecount, std::vector<sample*>> mBuffers;
+    size_t mCount = 0;
+};
+
+static AudioChunkPool sAudioChunkPool;
+
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
 //////////////////////////////////////////////////////////////////////////
@@ -39,15 +106,13 @@ AudioChunk::AudioChunk(int nChannels, samplecount nSamples, bool allocate, bool
 
     if (allocate)
     {
+        mBuffer = sAudioChunkPool.take(mNrSamples);
+        mPooled = true;
+        ASSERT_NONZERO(mBuffer);
         if (zero)
         {
-            mBuffer = static_cast<sample*>(calloc( mNrSamples, sBytesPerSample ));
-        }
-        else
-        {
-            mBuffer = static_cast<sample*>(malloc( mNrSamples * sBytesPerSample ));
+            memset(mBuffer, 0, mNrSamples * sBytesPerSample);
         }
-        ASSERT_NONZERO(mBuffer);
         if (buffer)
         {
             memcpy(mBuffer, buffer, mNrSamples * sBytesPerSample);
@@ -55,13 +120,41 @@ AudioChunk::AudioChunk(int nChannels, samplecount nSamples, bool allocate, bool
     }
 }
 
+AudioChunk::AudioChunk(int nChannels, AVFrame* frame)
+    : mBuffer(0)
+    , mNrChannels(nChannels)
+    , mNrSamples(frame->nb_samples * nChannels)
+    , mNrReadSamples(0)
+    , mNrSkippedSamples(0)
+    , mPts(boost::none)
+{
+    ASSERT_NONZERO(frame->buf[0]); // Reference counted
+    ASSERT_EQUALS(frame->format, AV_SAMPLE_FMT_S16);
+    ASSERT_EQUALS(av_frame_get_channels(frame), nChannels);
+    mFrame = av_frame_alloc();
+    ASSERT_NONZERO(mFrame);
+    av_frame_move_ref(mFrame, frame);
+    mBuffer = reinterpret_cast<sample*>(mFrame->extended_data[0]);
+}
+
 AudioChunk::~AudioChunk()
 {
-    if (mBuffer)
+    if (mFrame)
+    {
+        av_frame_free(&mFrame); // mBuffer points into the frame
+    }
+    else if (mBuffer)
     {
-        free(mBuffer);
-        mBuffer = 0;
+        if (mPooled)
+        {
+            sAudioChunkPool.give(mBuffer, mNrSamples);
+        }
+        else
+        {
+            free(mBuffer);
+        }
     }
+    mBuffer = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,8 @@
 #include "EmptyChunk.h"
 #include "Node.h"
 #include "Transition.h"
+#include "UtilPath.h"
+#include "UtilThread.h"
 
 namespace model {
 
@@ -33,6 +35,13 @@ namespace model {
 //auto Linear = [](const double& volume, sample& s) { s = std::floor(volume * s); };
 //auto IncreasedLowVolumeSensitivity = [](const double& volume, sample& s) { s = std::floor(std::sin(volume * M_PI / 2) * s); }; // Note: Does not work for higher values (sine probably too far, resulting in lower volume instead of higher).
 
+/// Maximum number of threads used for computing the peaks of one clip.
+static const unsigned int sAudioPeaksMaximumThreads{ 4 };
+
+/// Minimum length of each part of a clip for which the peaks are computed by a separate thread.
+/// Avoids starting threads (and opening files) for short clips.
+static const pts sAudioPeaksMinimumPartLength{ 1500 };
+
 void adjustSampleVolume(const double& volume, sample& s)
 {
     double base{ M_E };
@@ -73,6 +82,8 @@ AudioClip::AudioClip(const AudioFilePtr& file)
 AudioClip::AudioClip(const AudioClip& other)
     : ClipInterval(other)
     , mPeaks(other.mPeaks)
+    , mPeaksId(other.mPeaksId)
+    , mPeakLevels(other.mPeakLevels)
 {
     VAR_DEBUG(other)(*this);
     Bind(model::EVENT_CHANGE_CLIP_KEYFRAMES, &AudioClip::onKeyFramesChanged, this);
@@ -264,7 +275,7 @@ AudioChunkPtr AudioClip::getNextAudio(const AudioCompositionParameters& paramete
 // AUDIOCLIP
 //////////////////////////////////////////////////////////////////////////
 
-AudioPeaks AudioClip::getPeaks(const AudioCompositionParameters& parameters)
+AudioPeaks AudioClip::getPeaks(const AudioCompositionParameters& parameters, int level)
 {
     pts offset{ getOffset() };
     pts length{ getLength() };
@@ -283,77 +294,62 @@ AudioPeaks AudioClip::getPeaks(const AudioCompositionParameters& parameters)
         length += *right;
     }
 
+    if (!mPeaks && !mPeaksId.IsEmpty())
+    {
+        // Peaks referred to by the save file: mapped upon first use.
+        mPeaks = AudioPeaksStore::find(mPeaksId);
+        mPeakLevels = nullptr;
+    }
     if (!mPeaks)
     {
-        // Store cached peaks (with adjusted volume/key frames) in save file.
-        mPeaks = boost::make_shared<AudioPeaks>();
-
-        // The setPts() & determineChunkSize() below is required for the case where the file has been removed from disk,
-        // and the chunk size is used to initialize a chunk of silence.
         maximize(); // When caching, cache the entire file.
-        moveTo(0);
 
-        samplecount samplePosition{ 0 };
-        samplecount nextRequiredSample{ 0 };
-        AudioChunkPtr chunk{ getNextAudio(parameters) };
-
-        size_t data_length{ narrow_cast<size_t>(getLength()) * sPeaksPerPts };
-
-        sample negativePeak = 0;
-        sample positivePeak = 0;
-        int64_t positiveSum = 0;
-        int64_t negativeSum = 0;
-        int count = 0;
-        double max = std::numeric_limits<sample>::max();
-
-        while (chunk && !chunk->getError())
+        mPeaksId = AudioPeaksStore::getId(getPeaksKey());
+        mPeaks = AudioPeaksStore::find(mPeaksId); // Computed before (for another clip, or in another project)
+        mPeakLevels = nullptr;
+    }
+    if (!mPeaks)
+    {
+        // Store cached peaks (with adjusted volume/key frames) in the peaks store.
+        AudioPeaks peaks;
+
+        // Decode consecutive parts of the clip simultaneously, each via its own clone.
+        pts total{ getLength() };
+        int64_t nParts{ std::min<int64_t>(total / sAudioPeaksMinimumPartLength, std::min<unsigned int>(sAudioPeaksMaximumThreads, boost::thread::hardware_concurrency())) };
+        nParts = std::max<int64_t>(nParts, 1);
+        std::vector<AudioPeaks> parts(narrow_cast<size_t>(nParts));
+        auto getPartBegin = [total, nParts](int64_t part) -> pts { return total * part / nParts; };
+        if (nParts == 1)
         {
-            samplecount chunksize = chunk->getUnreadSampleCount();
-            sample* buffer = chunk->getBuffer();
-
-            for (int i = 0; (i < chunksize) && (mPeaks->size() < data_length); ++i)
+            parts[0] = computePeaks(parameters, 0, total);
+        }
+        else
+        {
+            boost::thread_group threads;
+            for (int64_t part = 0; part < nParts; ++part)
             {
-                ++count;
-                if (*buffer > 0)
+                AudioClipPtr partClip{ clone() };
+                partClip->onCloned();
+                AudioPeaks& result{ parts[narrow_cast<size_t>(part)] };
+                pts begin{ getPartBegin(part) };
+                pts end{ getPartBegin(part + 1) };
+                threads.create_thread([partClip, parameters, begin, end, &result]
                 {
-                    positiveSum += (*buffer * *buffer);
-                    positivePeak = std::max(positivePeak, *buffer);
-                }
-                else
-                {
-                    negativeSum += (*buffer * *buffer); // - * - = + !
-                    negativePeak = std::min(negativePeak, *buffer);
-                }
-
-                if (samplePosition == nextRequiredSample)
-                {
-                    ASSERT_LESS_THAN_EQUALS_ZERO(negativePeak);
-                    ASSERT_MORE_THAN_EQUALS_ZERO(negativeSum);
-                    ASSERT_MORE_THAN_EQUALS_ZERO(positivePeak);
-                    ASSERT_MORE_THAN_EQUALS_ZERO(positiveSum);
-                    mPeaks->emplace_back(AudioPeak(
-                    { 
-                        { 
-                            negativePeak, 
-                            positivePeak 
-                        },
-                        { 
-                            -narrow_cast<sample>(std::min(max, std::trunc(sqrt(negativeSum / count)))),  
-                            narrow_cast<sample>(std::min(max, std::trunc(sqrt(positiveSum / count)))) 
-                        } 
-                    }));
-                    count = 0;
-                    positiveSum = 0;
-                    negativeSum = 0;
-                    negativePeak = 0;
-                    positivePeak = 0;
-                    // Note: new speed has been taken into account by getNextAudio already!
-                    nextRequiredSample = Convert::ptsToSamplesPerChannel(parameters.getSampleRate(), mPeaks->size()) / sPeaksPerPts;
-                }
-                ++samplePosition;
-                ++buffer;
+                    util::thread::setCurrentThreadName("AudioPeaks");
+                    result = partClip->computePeaks(parameters, begin, end);
+                });
             }
-            chunk = getNextAudio(parameters);
+            threads.join_all();
+        }
+        for (int64_t part = 0; part < nParts; ++part)
+        {
+            AudioPeaks& result{ parts[narrow_cast<size_t>(part)] };
+            if (part < nParts - 1)
+            {
+                // Keep the subsequent parts aligned, also if the audio data of this part was incomplete.
+                result.resize(narrow_cast<size_t>((getPartBegin(part + 1) - getPartBegin(part)) * sPeaksPerPts), AudioPeak({ { 0,0 },{ 0,0 } }));
+            }
+            peaks.insert(peaks.end(), result.begin(), result.end());
         }
 
         KeyFrameMap keyFrames{ getKeyFramesOfPerceivedClip() };
@@ -367,7 +363,7 @@ AudioPeaks AudioClip::getPeaks(const AudioCompositionParameters& parameters)
         {
             pts position{ 0 };
             int volumeBefore{ boost::dynamic_pointer_cast<AudioKeyFrame>(getFrameAt(position / sPeaksPerPts))->getVolume() };
-            for (AudioPeak& peak : *mPeaks)
+            for (AudioPeak& peak : peaks)
             {
                 ++position;
                 int volumeAfter{ boost::dynamic_pointer_cast<AudioKeyFrame>(getFrameAt(position / sPeaksPerPts))->getVolume() };
@@ -385,27 +381,141 @@ AudioPeaks AudioClip::getPeaks(const AudioCompositionParameters& parameters)
         // The video data in a file may be slightly longer than the audio data, resulting in such a difference. Instead of truncating the video, the audio is extended
         // with silence, leaving the truncating (the choice) to the user.
 
+        mPeaks = AudioPeaksStore::add(mPeaksId, std::move(peaks));
+        mPeakLevels = nullptr;
     }
 
+    const AudioPeak* peaks{ mPeaks->getData() };
+    int nPeaks{ narrow_cast<int>(mPeaks->getSize()) };
+    if (level > 0)
+    {
+        if (!mPeakLevels)
+        {
+            boost::shared_ptr<std::vector<AudioPeaks>> levels{ boost::make_shared<std::vector<AudioPeaks>>() };
+            while ((levels->empty() ? mPeaks->getSize() : levels->back().size()) > 1)
+            {
+                levels->emplace_back(levels->empty() ? mPeaks->get(0, mPeaks->getSize()).reduce() : levels->back().reduce());
+            }
+            mPeakLevels = levels;
+        }
+        level = std::min<int>(level, narrow_cast<int>(mPeakLevels->size()));
+        if (level > 0)
+        {
+            peaks = (*mPeakLevels)[level - 1].data();
+            nPeaks = narrow_cast<int>((*mPeakLevels)[level - 1].size());
+        }
+    }
 
-    int offsetInPeaks = offset * sPeaksPerPts;
-    int lengthInPeaks = length * sPeaksPerPts;
-    int nPeaks = mPeaks->size();
+    int offsetInPeaks = (offset * sPeaksPerPts) >> level;
+    int lengthInPeaks = ((length * sPeaksPerPts) + (1 << level) - 1) >> level;
 
-    auto itBegin = mPeaks->cbegin() + std::min(offsetInPeaks, nPeaks);
-    auto itEnd = mPeaks->cbegin() + std::min(offsetInPeaks + lengthInPeaks, nPeaks);
-    if ((std::distance(mPeaks->cbegin(), itBegin) < nPeaks) &&
-        (std::distance(mPeaks->cbegin(), itEnd) <= nPeaks))
+    AudioPeaks result;
+    if (offsetInPeaks < nPeaks)
     {
-        return std::move(AudioPeaks(itBegin, itEnd));
+        result.assign(peaks + offsetInPeaks, peaks + std::min(offsetInPeaks + lengthInPeaks, nPeaks));
     }
-    if (static_cast<int>(mPeaks->size()) < length)
+    // Ensure resulting peaks length equals length of clip. Add 'silence' if required.
+    // The stored peaks are never changed, since these are shared with other clips.
+    result.resize(lengthInPeaks, AudioPeak({ { 0,0 },{ 0,0 } }));
+    return result;
+}
+
+AudioPeaks AudioClip::computePeaks(const AudioCompositionParameters& parameters, pts begin, pts end)
+{
+    AudioPeaks result;
+
+    // The setPts() & determineChunkSize() of the parameters is required for the case where the file has been removed from disk,
+    // and the chunk size is used to initialize a chunk of silence.
+    moveTo(begin);
+
+    size_t firstPeak{ narrow_cast<size_t>(begin * sPeaksPerPts) };
+    size_t data_length{ narrow_cast<size_t>((end - begin) * sPeaksPerPts) };
+    samplecount samplePosition{ Convert::ptsToSamplesPerChannel(parameters.getSampleRate(), begin) };
+    samplecount nextRequiredSample{ Convert::ptsToSamplesPerChannel(parameters.getSampleRate(), firstPeak) / sPeaksPerPts };
+    AudioChunkPtr chunk{ getNextAudio(parameters) };
+
+    sample negativePeak = 0;
+    sample positivePeak = 0;
+    int64_t positiveSum = 0;
+    int64_t negativeSum = 0;
+    int count = 0;
+    double max = std::numeric_limits<sample>::max();
+
+    while (chunk && !chunk->getError() && result.size() < data_length)
     {
-        // Ensure resulting peaks length equals length of clip. Add 'silence' if required.
-        mPeaks->resize(length, AudioPeak({ { 0,0 },{ 0,0 } }));
+        samplecount chunksize = chunk->getUnreadSampleCount();
+        sample* buffer = chunk->getBuffer();
+
+        for (int i = 0; (i < chunksize) && (result.size() < data_length); ++i)
+        {
+            ++count;
+            if (*buffer > 0)
+            {
+                positiveSum += (*buffer * *buffer);
+                positivePeak = std::max(positivePeak, *buffer);
+            }
+            else
+            {
+                negativeSum += (*buffer * *buffer); // - * - = + !
+                negativePeak = std::min(negativePeak, *buffer);
+            }
+
+            if (samplePosition >= nextRequiredSample) // NOT: ==, the first sample of a part may be slightly beyond its first peak due to rounding.
+            {
+                ASSERT_LESS_THAN_EQUALS_ZERO(negativePeak);
+                ASSERT_MORE_THAN_EQUALS_ZERO(negativeSum);
+                ASSERT_MORE_THAN_EQUALS_ZERO(positivePeak);
+                ASSERT_MORE_THAN_EQUALS_ZERO(positiveSum);
+                result.emplace_back(AudioPeak(
+                { 
+                    { 
+                        negativePeak, 
+                        positivePeak 
+                    },
+                    { 
+                        -narrow_cast<sample>(std::min(max, std::trunc(sqrt(negativeSum / count)))),  
+                        narrow_cast<sample>(std::min(max, std::trunc(sqrt(positiveSum / count)))) 
+                    } 
+                }));
+                count = 0;
+                positiveSum = 0;
+                negativeSum = 0;
+                negativePeak = 0;
+                positivePeak = 0;
+                // Note: new speed has been taken into account by getNextAudio already!
+                nextRequiredSample = Convert::ptsToSamplesPerChannel(parameters.getSampleRate(), firstPeak + result.size()) / sPeaksPerPts;
+            }
+            ++samplePosition;
+            ++buffer;
+        }
+        if (result.size() < data_length)
+        {
+            chunk = getNextAudio(parameters);
+        }
     }
+    return result;
+}
 
-    return AudioPeaks();
+wxString AudioClip::getPeaksKey() const
+{
+    FilePtr file{ getFile() };
+    if (!file) { return ""; }
+    wxFileName path{ file->getPath() };
+    boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(path) };
+    if (!identity)
+    {
+        return ""; // Missing file: peaks are not stored.
+    }
+    wxString result{ wxString::Format("%s|%" PRId64 "/%" PRId64 "|%d",
+        identity->toString(),
+        static_cast<int64_t>(getSpeed().numerator()),
+        static_cast<int64_t>(getSpeed().denominator()),
+        boost::dynamic_pointer_cast<AudioKeyFrame>(getDefaultKeyFrame())->getVolume()) };
+    for (auto k : getKeyFramesOfPerceivedClip())
+    {
+        result << wxString::Format("|%" PRId64 ":%d", static_cast<int64_t>(k.first), boost::dynamic_pointer_cast<AudioKeyFrame>(k.second)->getVolume());
+    }
+    return result;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -424,12 +534,16 @@ KeyFramePtr AudioClip::interpolate(KeyFramePtr before, KeyFramePtr after, pts po
 void AudioClip::onKeyFramesChanged(EventChangeClipKeyFrames& event)
 {
     mPeaks = nullptr;
+    mPeaksId.Clear();
+    mPeakLevels = nullptr;
     event.Skip();
 }
 
 void AudioClip::onSpeedChanged(EventChangeClipSpeed& event)
 {
     mPeaks = nullptr;
+    mPeaksId.Clear();
+    mPeakLevels = nullptr;
     event.Skip();
 }
 
@@ -467,10 +581,17 @@ void AudioClip::serialize(Archive & ar, const unsigned int version)
             keyFrame->setVolume(mVolume);
             setDefaultKeyFrame(keyFrame);
         }
-        if (version >= 4)
+        if (version == 4)
         {
+            // Peaks were stored in the save file. Discarded: recomputed (and then
+            // stored in the peaks store) when the clip is drawn for the first time.
+            boost::shared_ptr<AudioPeaks> mPeaks;
             ar & BOOST_SERIALIZATION_NVP(mPeaks);
         }
+        if (version >= 5)
+        {
+            ar & BOOST_SERIALIZATION_NVP(mPeaksId);
+        }
     }
     catch (boost::exception &e)                  { VAR_ERROR(boost::diagnostic_information(e)); throw; }
     catch (std::exception& e)                    { VAR_ERROR(e.what());                         throw; }
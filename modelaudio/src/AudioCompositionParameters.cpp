@@ -45,6 +45,20 @@ AudioCompositionParameters::AudioCompositionParameters(const AudioCompositionPar
 {
 }
 
+//////////////////////////////////////////////////////////////////////////
+// OPERATORS
+//////////////////////////////////////////////////////////////////////////
+
+bool AudioCompositionParameters::operator==( const AudioCompositionParameters& other ) const
+{
+    return
+        (mSampleRate == other.mSampleRate) &&
+        (mNrChannels == other.mNrChannels) &&
+        (mSpeed == other.mSpeed) &&
+        (mPts == other.mPts) &&
+        (mChunkSize == other.mChunkSize);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // GET/SET
 //////////////////////////////////////////////////////////////////////////
@@ -29,7 +29,14 @@ namespace model
 static const int sMicroSecondsPerSeconds = 1000 * 1000;
 static const int sMaxBufferSize = 100;
 
-static const int sAudioBufferSizeInBytes = 8192; // Note: always multiple of 32 (align to 32 bytes)
+/// Number of packets before the required position that is decoded (and
+/// discarded) after a move. Without these, the first decoded packet lacks
+/// the data that the decoder carries over between packets (for instance,
+/// the mp3 bit reservoir or the overlapping windows of aac), causing a click.
+static const size_t sAudioPrerollPackets = 2;
+
+/// Number of samples (per channel) returned per chunk when reading from the audio cache.
+static const samplecount sAudioCacheChunkSize = 4096;
 
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
@@ -94,8 +101,8 @@ void AudioFile::clean()
     VAR_DEBUG(this);
 
     stopDecodingAudio();
-
-    mAudioDecodeBuffer.clear();
+    mCache.reset();
+    mCachePosition = 0;
 
     File::clean();
 }
@@ -106,6 +113,25 @@ void AudioFile::clean()
 
 AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& parameters)
 {
+    if (mCache && !mCache->matches(parameters))
+    {
+        // Speed changed. Continue with decoding, at the current position.
+        if (!mNewStartPosition)
+        {
+            microseconds position{ Convert::samplesToTime(mCache->getSampleRate(), mCache->getNrChannels(), mCachePosition * mCache->getNrChannels()) * 1000 };
+            moveTo(Convert::microsecondsToPts(position));
+        }
+        mCache.reset();
+    }
+    if (!mCache && !mDecodingAudio)
+    {
+        mCache = AudioCache::find(*this, parameters); // Only when starting: a file is never switched from decoding to the cache.
+    }
+    if (mCache)
+    {
+        return getNextCachedAudio(parameters);
+    }
+
     startDecodingAudio(parameters);
 
     if (!canBeOpened())
@@ -141,11 +167,17 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
             return getFirstSample(packet->pts + 1);
         };
 
+        std::deque<PacketPtr> preroll;
         while (positionInfoAvailable() &&
             getFirstSampleOfNextPacket(audioPacket->getPacket()) <= nextSample)
         {
             // The next packet starts also 'before' the required sample. Use that packet.
             // Seeking was too far ahread of the required point.
+            preroll.push_back(audioPacket);
+            if (preroll.size() > sAudioPrerollPackets)
+            {
+                preroll.pop_front();
+            }
             audioPacket = getNextPacket();
         }
 
@@ -162,6 +194,10 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
             else
             {
                 nSkipSamples = nextSample - firstSample;
+                for (PacketPtr packet : preroll)
+                {
+                    decodeAndDiscard(packet);
+                }
             }
         }
 
@@ -173,63 +209,124 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
 
     //////////////////////////////////////////////////////////////////////////
     // DECODING
+    //
+    // Decoded frames are not copied into an intermediate buffer. Instead, they
+    // are resampled directly into the (recycled) storage of the resulting chunk.
+    // Without resampling (the decoded data is interleaved 16 bit at the required
+    // rate) a packet that is decoded into one frame is not copied at all: the
+    // chunk takes over the frame's (reference counted) data.
 
     AVCodecContext* codec = getCodec();
+    int nChannels{ parameters.getNrChannels() };
+
+    AudioChunkPtr audioChunk;
+    samplecount nOutputSamples = 0; // Number of samples (in all channels) stored in audioChunk
+    int nDecodedSamplesPerChannel = 0;
 
-    auto allocateFrame = []() -> boost::shared_ptr<AVFrame>
+    auto initResampling = [this, codec, &parameters]()
     {
-        // Ensure memory cleaned up in all possible control flows:
+        // Only take planes with actual data into account.
+        // Some files have packets with fewer frames than described in the codec.
+        int nPlanesInFrame{ 0 };
+        for (int i = 0; i < mNrPlanes; ++i)
+        {
+            if (mFrame->extended_data[i] != 0)
+            {
+                nPlanesInFrame++;
+            }
+        }
+        // Code taken from ffplay.c
+        int nChannels = av_frame_get_channels(mFrame);
+        int framelayout = av_frame_get_channel_layout(mFrame);
+        int nChannelsInFrameLayout = av_get_channel_layout_nb_channels(framelayout);
 
-        boost::shared_ptr<AVFrame> frame(av_frame_alloc(), [](AVFrame* frame) { av_frame_free(&frame); });
-        ASSERT_NONZERO(frame);
-        ASSERT_NONZERO(frame.get());
-        return frame;
-    };
+        // Default: use default layout for number of channels
+        int64_t dec_channel_layout = av_get_default_channel_layout(nChannels);
 
-    auto copyFrame = [this, codec](boost::shared_ptr<AVFrame> frame, int offset) -> int
-    {
-        int decodedLineSize(0); // Will contain the number of bytes per plane
-        // return value of av_samples_get_buffer_size (unused) contains the entire required buffer size:
-        // - Contains ALL channel data
-        // - Contains 32 bit alignment for all used data fields (one for packet, multiple for planar)
-        av_samples_get_buffer_size(&decodedLineSize, codec->channels, frame->nb_samples, codec->sample_fmt, 1);
-
-        size_t requiredBufferSize{ static_cast<size_t>(offset + decodedLineSize) };
-        if (requiredBufferSize > mAudioDecodeBuffer[0].size())
+        if ((nPlanesInFrame != mNrPlanes) ||
+            (mNrPlanes > 1 && (nPlanesInFrame != nChannelsInFrameLayout)))
+        {
+            // In case of inconsistencies: Revert to default channel layout for number of planes in frame
+            dec_channel_layout = av_get_default_channel_layout(nPlanesInFrame);
+        }
+        else
         {
-            // Some file formats packets (.ape) contain multiple sizes.
-            // First seen packet may not be the biggest...
-            int size{ offset + decodedLineSize };
-            int newAudioBufferSizeInBytes{ (size + 32 - 1) - (size + 32 - 1) % 32 }; // Align to 32 bytes
-            for (int i = 0; i < mNrPlanes; ++i)
+            // If data in frame consistent with expected format, use layout as specified in frame
+            if (framelayout != 0 && nChannels == nChannelsInFrameLayout)
             {
-                mAudioDecodeBuffer[i].resize(newAudioBufferSizeInBytes);
+                dec_channel_layout = framelayout; // Use frame layout as specified in the frame
             }
         }
-        ASSERT_LESS_THAN_EQUALS(requiredBufferSize, mAudioDecodeBuffer[0].size())(offset)(decodedLineSize)(*this);
-        for (int i = 0; i < mNrPlanes; ++i)
+
+        mSoftwareResampleContext = swr_alloc_set_opts(0,
+            av_get_default_channel_layout(parameters.getNrChannels()),
+            AV_SAMPLE_FMT_S16,
+            Convert::samplerateToNewSpeed(parameters.getSampleRate(), parameters.getSpeed(), 1),
+            dec_channel_layout, codec->sample_fmt, mFrame->sample_rate, 0, 0);
+        ASSERT_NONZERO(mSoftwareResampleContext);
+
+        int result { swr_init(mSoftwareResampleContext) };
+        ASSERT_ZERO(result)(avcodecErrorString(result));
+    };
+
+    auto reserve = [&audioChunk, &nOutputSamples, nChannels](samplecount required)
+    {
+        if (audioChunk && required <= audioChunk->getUnreadSampleCount()) { return; }
+        // Typically, one packet is decoded into one frame. Some file formats
+        // (.ape) have packets with multiple frames: then, grow and copy.
+        samplecount size{ audioChunk ? std::max(required, 2 * audioChunk->getUnreadSampleCount()) : required };
+        AudioChunkPtr larger{ boost::make_shared<AudioChunk>(nChannels, size, true, false) };
+        if (audioChunk)
         {
-            if (frame->extended_data[i] != 0)
+            memcpy(larger->getBuffer(), audioChunk->getBuffer(), nOutputSamples * AudioChunk::sBytesPerSample);
+        }
+        audioChunk = larger;
+    };
+
+    // Add the samples of mFrame to the result.
+    auto addFrame = [this, &audioChunk, &nOutputSamples, &nDecodedSamplesPerChannel, nChannels, &initResampling, &reserve](bool lastFrameOfPacket)
+    {
+        // Only after the first packet has been decoded, all of the information
+        // required for initializing resampling is available.
+        if (mNeedsResampling && mSoftwareResampleContext == 0)
+        {
+            initResampling();
+        }
+
+        int nFrameSamplesPerChannel{ mFrame->nb_samples };
+        nDecodedSamplesPerChannel += nFrameSamplesPerChannel;
+
+        if (mSoftwareResampleContext == 0)
+        {
+            // Use the plain decoded data without resampling.
+            ASSERT_EQUALS(mNrPlanes,1); // Resulting data is never planar, in case of planar data resampling should be done
+            samplecount nFrameSamples{ nFrameSamplesPerChannel * nChannels };
+            if (!audioChunk && lastFrameOfPacket && mFrame->buf[0] != nullptr)
             {
-                // Only take planes with actual data into account.
-                // Example: resolutionchange_contains_6_audio_planes_but_not_for_all_packets.mpg
-                //          This file contains (according to the meta data from the AVCodecContext)
-                //          6 audio planes. However, for some packets in the audio stream there are
-                //          only two contained planes.
-                memcpy(&(mAudioDecodeBuffer[i][offset]), frame->extended_data[i], decodedLineSize);
+                audioChunk = boost::make_shared<AudioChunk>(nChannels, mFrame); // Takes over the data (and resets mFrame)
             }
             else
             {
-                memset(&(mAudioDecodeBuffer[i][offset]), 0, decodedLineSize);
+                reserve(nOutputSamples + nFrameSamples);
+                memcpy(audioChunk->getBuffer() + nOutputSamples, mFrame->extended_data[0], nFrameSamples * AudioChunk::sBytesPerSample);
             }
+            nOutputSamples += nFrameSamples;
+        }
+        else
+        {
+            // Resample, directly from the decoded frame into the chunk.
+            int nExpectedOutputFrames{ swr_get_out_samples(mSoftwareResampleContext, nFrameSamplesPerChannel) };
+            reserve(nOutputSamples + nExpectedOutputFrames * nChannels);
+            uint8_t *out[1]; // Output data always packed into one plane
+            out[0] = reinterpret_cast<uint8_t*>(audioChunk->getBuffer() + nOutputSamples);
+            int nOutputFrames = swr_convert(mSoftwareResampleContext, &out[0], nExpectedOutputFrames, const_cast<const uint8_t**>(mFrame->extended_data), nFrameSamplesPerChannel);
+            ASSERT_MORE_THAN_EQUALS_ZERO(nOutputFrames);
+            ASSERT_LESS_THAN_EQUALS(nOutputFrames, nExpectedOutputFrames); // The chunk was large enough to hold everything produced by swr_convert in one pass.
+            nOutputSamples += nOutputFrames * nChannels;
         }
-        return decodedLineSize;
+        av_frame_unref(mFrame);
     };
 
-
-    // All sizes are in bytes below
-    int targetSizeInBytes = 0; // For planar data, size of each plane. For packet data, size of first plane, which contains all channels.
-    int nDecodedSamplesPerChannel = 0;
     bool done = false;
 
     while (!done && audioPacket)
@@ -245,13 +342,12 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
             packet.data = sourceData;
             packet.size = sourceSize;
 
-            boost::shared_ptr<AVFrame> frame{ allocateFrame() };
-
             int got_frame = 0;
-            int usedSourceBytes = avcodec_decode_audio4(codec, frame.get(), &got_frame, &packet);
+            int usedSourceBytes = avcodec_decode_audio4(codec, mFrame, &got_frame, &packet);
 
             if (usedSourceBytes < 0 || !got_frame)
             {
+                av_frame_unref(mFrame);
                 audioPacket = getNextPacket();
                 break; // This frame failed. Can happen after moveTo(); due to seeking the first packets do not contain (enough) header information.
             }
@@ -261,61 +357,10 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
                 done = true;
             }
 
-            int decodedLineSize{ copyFrame(frame, targetSizeInBytes) };  // decodedLineSize will contain the number of bytes per plane
-
             sourceData += usedSourceBytes;
             sourceSize -= usedSourceBytes;
 
-            targetSizeInBytes += decodedLineSize;
-            nDecodedSamplesPerChannel += frame->nb_samples;
-
-            // Only after the first packet has been decoded, all of the information
-            // required for initializing resampling is available.
-            if (mNeedsResampling && mSoftwareResampleContext == 0)
-            {
-                // Only take planes with actual data into account.
-                // Some files have packets with fewer frames than described in the codec.
-                int nPlanesInFrame{ 0 };
-                for (int i = 0; i < mNrPlanes; ++i)
-                {
-                    if (frame->extended_data[i] != 0)
-                    {
-                        nPlanesInFrame++;
-                    }
-                }
-                // Code taken from ffplay.c
-                int nChannels = av_frame_get_channels(frame.get());
-                int framelayout = av_frame_get_channel_layout(frame.get());
-                int nChannelsInFrameLayout = av_get_channel_layout_nb_channels(framelayout);
-
-                // Default: use default layout for number of channels
-                int64_t dec_channel_layout = av_get_default_channel_layout(nChannels);
-
-                if ((nPlanesInFrame != mNrPlanes) ||
-                    (mNrPlanes > 1 && (nPlanesInFrame != nChannelsInFrameLayout)))
-                {
-                    // In case of inconsistencies: Revert to default channel layout for number of planes in frame
-                    dec_channel_layout = av_get_default_channel_layout(nPlanesInFrame);
-                }
-                else
-                {
-                    // If data in frame consistent with expected format, use layout as specified in frame
-                    if (framelayout != 0 && nChannels == nChannelsInFrameLayout)
-                    {
-                        dec_channel_layout = framelayout; // Use frame layout as specified in the frame
-                    }
-                }
-
-                mSoftwareResampleContext = swr_alloc_set_opts(0,
-                    av_get_default_channel_layout(parameters.getNrChannels()),
-                    AV_SAMPLE_FMT_S16,
-                    Convert::samplerateToNewSpeed(parameters.getSampleRate(), parameters.getSpeed(), 1),
-                    dec_channel_layout, codec->sample_fmt, frame->sample_rate, 0, 0);
-                ASSERT_NONZERO(mSoftwareResampleContext);
-
-                int result { swr_init(mSoftwareResampleContext) };
-                ASSERT_ZERO(result)(avcodecErrorString(result));
-            }
+            addFrame(sourceSize <= 0);
         }
     }
 
@@ -324,74 +369,36 @@ AudioChunkPtr AudioFile::getNextAudio(const AudioCompositionParameters& paramete
         AVPacket packet;
         memset(&packet, 0, sizeof(packet));
 
-        boost::shared_ptr<AVFrame> frame{ allocateFrame() };
-
         int got_frame = 0;
-        int usedSourceBytes = avcodec_decode_audio4(codec, frame.get(), &got_frame, &packet);
+        avcodec_decode_audio4(codec, mFrame, &got_frame, &packet);
 
         if (!got_frame)
         {
             // No samples, end of data
+            av_frame_unref(mFrame);
             static const std::string status("End of file");
             VAR_DEBUG(status);
             return AudioChunkPtr();
         }
 
-#pragma GCC diagnostic ignored "-Wunused-variable"
-        int decodedLineSize{ copyFrame(frame, targetSizeInBytes) };  // decodedLineSize will contain the number of bytes per plane
-
-        nDecodedSamplesPerChannel += frame->nb_samples;
-
         ASSERT_IMPLIES(mNeedsResampling, mSoftwareResampleContext != 0); // Must have been initialized already
+        addFrame(true);
     }
 
     ASSERT_MORE_THAN_ZERO(nDecodedSamplesPerChannel);
+    ASSERT_NONZERO(audioChunk);
 
-    //////////////////////////////////////////////////////////////////////////
-    // RESAMPLING
-
-    AudioChunkPtr audioChunk;
+    // More data may have been allocated (to compensate for differences between the number
+    // of output samples 'calculated' and the number that avcodec actually produced).
+    audioChunk->setAdjustedLength(nOutputSamples);
 
-    if (mSoftwareResampleContext == 0)
-    {
-        // Use the plain decoded data without resampling.
-        ASSERT_EQUALS(mNrPlanes,1); // Resulting data is never planar, in case of planar data resampling should be done
-        audioChunk = boost::make_shared<AudioChunk>(parameters.getNrChannels(), nDecodedSamplesPerChannel * parameters.getNrChannels(), true, false, reinterpret_cast<sample*>(&(mAudioDecodeBuffer[0][0])));
-    }
-    else
+    if (mSoftwareResampleContext != 0)
     {
-        // Resample
         auto convertInputSampleCountToOutputSampleCount = [parameters,codec](samplecount input) -> samplecount
         {
             return floor(rational64(input) * rational64(Convert::samplerateToNewSpeed(parameters.getSampleRate(), parameters.getSpeed(), 1)) / rational64(codec->sample_rate));
         };
 
-        int nExpectedOutputSamplesPerChannel = convertInputSampleCountToOutputSampleCount(nDecodedSamplesPerChannel);
-        nExpectedOutputSamplesPerChannel = std::max(nExpectedOutputSamplesPerChannel, swr_get_out_samples(mSoftwareResampleContext, nDecodedSamplesPerChannel));
-        int bufferSize = av_samples_get_buffer_size(0, parameters.getNrChannels(), nExpectedOutputSamplesPerChannel, AV_SAMPLE_FMT_S16, 1);
-        int nExpectedOutputFrames = swr_get_out_samples(mSoftwareResampleContext, nDecodedSamplesPerChannel);
-        // The audioChunk is pre-allocated to avoid one extra memcpy (from resampled data into the chunk).
-        audioChunk = boost::make_shared<AudioChunk>(parameters.getNrChannels(), bufferSize, true, false);
-
-        uint8_t *out[1]; // Output data always packed into one plane
-        out[0] = reinterpret_cast<uint8_t*>(audioChunk->getBuffer());
-        uint8_t **in{ new uint8_t*[mNrPlanes] };
-        for (int i{ 0 }; i < mNrPlanes; ++i)
-        {
-            in[i] = reinterpret_cast<uint8_t*>(&(mAudioDecodeBuffer[i][0]));
-        }
-        int nOutputFrames = swr_convert(mSoftwareResampleContext, &out[0], bufferSize, const_cast<const uint8_t**>(&in[0]), nDecodedSamplesPerChannel);
-        ASSERT_MORE_THAN_EQUALS_ZERO(nOutputFrames);
-        delete[] in;
-        int nOutputSamples = nOutputFrames * parameters.getNrChannels();
-
-        // To check that the buffer was large enough to hold everything produced by swr_convert in one pass.
-        ASSERT_LESS_THAN_EQUALS(nOutputSamples, bufferSize);
-
-        // More data was allocated (to compensate for differences between the number
-        // of output samples 'calculated' and the number that avcodec actually produced).
-        audioChunk->setAdjustedLength(nOutputSamples);
-
         // NOTE: When splitting a clip into several smaller parts, the splitting may cause the total sum of
         //       returned samples by swr_convert to differ slightly (order of 1 or 2 samples difference per
         //       decoded packet. So, computing the sum of all returned output samples of a clip split into
@@ -445,14 +452,20 @@ void AudioFile::startDecodingAudio(const AudioCompositionParameters& parameters)
 
     mNrPlanes = av_sample_fmt_is_planar(codec->sample_fmt) ? codec->channels : 1;
 
-    mAudioDecodeBuffer = std::vector< std::vector<uint8_t> >(mNrPlanes, std::vector<uint8_t>(sAudioBufferSizeInBytes));
+    ASSERT_ZERO(mFrame);
+    mFrame = av_frame_alloc(); // Reused for all decoded frames
+    ASSERT_NONZERO(mFrame);
 
     AVCodec* audioCodec = avcodec_find_decoder(codec->codec_id);
     ASSERT_NONZERO(audioCodec);
 
-    boost::mutex::scoped_lock lock(Avcodec::sMutex);
+    codec->refcounted_frames = 1; // Decoded data may outlive the next decode call (see AudioChunk).
 
-    int result = avcodec_open2(codec, audioCodec, 0);
+    int result{ 0 };
+    {
+        boost::mutex::scoped_lock lock(Avcodec::sMutex);
+        result = avcodec_open2(codec, audioCodec, 0);
+    }
     ASSERT_MORE_THAN_EQUALS_ZERO(result)(avcodecErrorString(result));
 
     int nBytesPerSample = av_get_bytes_per_sample(codec->sample_fmt);
@@ -474,21 +487,65 @@ void AudioFile::stopDecodingAudio()
     VAR_DEBUG(this);
     if (mDecodingAudio)
     {
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
-
         if (mSoftwareResampleContext != 0)
         {
             LOG_INFO << "Resampling ended";
             swr_free(&mSoftwareResampleContext);
         }
 
-        avcodec_close(getCodec());
+        {
+            boost::mutex::scoped_lock lock(Avcodec::sMutex);
+            avcodec_close(getCodec());
+        }
 
-        mAudioDecodeBuffer.clear();
+        av_frame_free(&mFrame);
     }
     mDecodingAudio = false;
 }
 
+AudioChunkPtr AudioFile::getNextCachedAudio(const AudioCompositionParameters& parameters)
+{
+    if (mNewStartPosition)
+    {
+        mCachePosition = Convert::ptsToSamplesPerChannel(parameters.getSampleRate(), *mNewStartPosition);
+        mNewStartPosition.reset();
+    }
+    if (mCachePosition >= mCache->getLength())
+    {
+        static const std::string status("End of file");
+        VAR_DEBUG(status);
+        return AudioChunkPtr();
+    }
+    int nChannels{ parameters.getNrChannels() };
+    samplecount nSamples{ std::min(sAudioCacheChunkSize, mCache->getLength() - mCachePosition) * nChannels };
+    AudioChunkPtr result{ boost::make_shared<AudioChunk>(nChannels, nSamples, true, false) };
+    // Copy, since chunks are changed in place (volume, transitions). This
+    // does not decode anything: only the pages that are read are loaded.
+    memcpy(result->getBuffer(), mCache->getData() + mCachePosition * nChannels, nSamples * AudioChunk::sBytesPerSample);
+    mCachePosition += nSamples / nChannels;
+    return result;
+}
+
+void AudioFile::decodeAndDiscard(const PacketPtr& packet)
+{
+    AVPacket decode;
+    memset(&decode, 0, sizeof(decode));
+    decode.data = packet->getPacket()->data;
+    decode.size = packet->getPacket()->size;
+    while (decode.size > 0)
+    {
+        int got_frame = 0;
+        int usedSourceBytes = avcodec_decode_audio4(getCodec(), mFrame, &got_frame, &decode);
+        av_frame_unref(mFrame);
+        if (usedSourceBytes <= 0)
+        {
+            break; // Preroll is best effort: the first packets after a seek may lack header information.
+        }
+        decode.data += usedSourceBytes;
+        decode.size -= usedSourceBytes;
+    }
+}
+
 samplecount AudioFile::getFirstSample(int64_t pts)
 {
     AVStream* stream{ getStream() };
@@ -33,6 +33,40 @@ AudioPeaks::AudioPeaks(AudioPeaks::const_iterator b, AudioPeaks::const_iterator
     : std::vector< AudioPeak >(b, e)
 {}
 
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+AudioPeaks AudioPeaks::reduce() const
+{
+    auto rms = [](sample a, sample b) -> sample
+    {
+        // Both values have the same sign (or are 0).
+        double result{ std::trunc(std::sqrt((static_cast<double>(a) * a + static_cast<double>(b) * b) / 2)) };
+        return narrow_cast<sample>(a < 0 || b < 0 ? -result : result);
+    };
+
+    AudioPeaks result;
+    result.reserve((size() + 1) / 2);
+    for (size_t i = 0; i < size(); i += 2)
+    {
+        const AudioPeak& first{ (*this)[i] };
+        const AudioPeak& second{ i + 1 < size() ? (*this)[i + 1] : first };
+        result.emplace_back(AudioPeak(
+        {
+            {
+                std::min(first.first.first, second.first.first),
+                std::max(first.first.second, second.first.second)
+            },
+            {
+                rms(first.second.first, second.second.first),
+                rms(first.second.second, second.second.second)
+            }
+        }));
+    }
+    return result;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // SERIALIZATION
 //////////////////////////////////////////////////////////////////////////
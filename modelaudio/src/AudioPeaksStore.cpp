@@ -0,0 +1,265 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "AudioPeaksStore.h"
+
+#include "Config.h"
+#include "UtilMemoryMappedFile.h"
+#include "UtilPath.h"
+
+namespace model {
+
+const int64_t sAudioPeaksStoreMaximumSize{ 256 * 1024 * 1024 }; ///< Combined size of all peaks files, in bytes. One hour of audio requires roughly 1 MB.
+
+/// Layout of the start of each peaks file. The peaks follow directly.
+struct AudioPeaksHeader
+{
+    char Magic[4] = { 'V', 'P', 'K', 'S' };
+    uint32_t Version = 1;
+    uint64_t Count = 0; ///< Number of peaks.
+};
+
+//////////////////////////////////////////////////////////////////////////
+// AUDIOPEAKSFILE
+//////////////////////////////////////////////////////////////////////////
+
+AudioPeaksFile::AudioPeaksFile(const wxFileName& path)
+    : mFile{ std::make_unique<MemoryMappedFile>(path) }
+{
+    if (mFile->getData() == nullptr || mFile->getSize() < sizeof(AudioPeaksHeader)) { return; }
+    AudioPeaksHeader expected;
+    AudioPeaksHeader header;
+    memcpy(&header, mFile->getData(), sizeof(AudioPeaksHeader));
+    if (memcmp(header.Magic, expected.Magic, sizeof(header.Magic)) != 0 ||
+        header.Version != expected.Version ||
+        mFile->getSize() != sizeof(AudioPeaksHeader) + header.Count * sizeof(AudioPeak))
+    {
+        VAR_WARNING(path)(mFile->getSize())(header.Version)(header.Count);
+        return;
+    }
+    mData = reinterpret_cast<const AudioPeak*>(mFile->getData() + sizeof(AudioPeaksHeader));
+    mSize = narrow_cast<size_t>(header.Count);
+}
+
+AudioPeaksFile::AudioPeaksFile(AudioPeaks&& peaks)
+    : mPeaks{ std::move(peaks) }
+{
+    mData = mPeaks.data();
+    mSize = mPeaks.size();
+}
+
+AudioPeaksFile::~AudioPeaksFile()
+{
+}
+
+bool AudioPeaksFile::isValid() const
+{
+    return mData != nullptr || (!mFile && mSize == 0);
+}
+
+const AudioPeak* AudioPeaksFile::getData() const
+{
+    return mData;
+}
+
+size_t AudioPeaksFile::getSize() const
+{
+    return mSize;
+}
+
+AudioPeaks AudioPeaksFile::get(size_t begin, size_t end) const
+{
+    ASSERT_LESS_THAN_EQUALS(begin, end);
+    ASSERT_LESS_THAN_EQUALS(end, mSize);
+    AudioPeaks result;
+    result.assign(mData + begin, mData + end);
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+AudioPeaksStore::AudioPeaksStore()
+    : mPersistent(!Config::get().read<bool>(Config::sPathTestCxxMode)) // Tests must not depend on the results of earlier runs.
+{
+    VAR_DEBUG(this);
+}
+
+AudioPeaksStore::~AudioPeaksStore()
+{
+    VAR_DEBUG(this);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+// static
+wxString AudioPeaksStore::getId(const wxString& key)
+{
+    if (key.IsEmpty()) { return ""; }
+    std::string utf8{ key.ToUTF8().data() };
+    return wxString::Format("%016" PRIx64, static_cast<uint64_t>(std::hash<std::string>()(utf8)));
+}
+
+// static
+AudioPeaksFilePtr AudioPeaksStore::find(const wxString& id)
+{
+    if (!exists() || id.IsEmpty()) { return nullptr; }
+
+    AudioPeaksStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    auto it = store.mMapped.find(id);
+    if (it != store.mMapped.end())
+    {
+        AudioPeaksFilePtr mapped{ it->second.lock() };
+        if (mapped) { return mapped; }
+        store.mMapped.erase(it);
+    }
+    if (!store.mPersistent) { return nullptr; }
+    wxFileName file{ getFile(id) };
+    if (!file.FileExists()) { return nullptr; }
+    file.Touch(); // Mark as recently used (see cleanup). Before mapping, since a mapped file may not allow changing its times.
+    AudioPeaksFilePtr mapped{ boost::make_shared<AudioPeaksFile>(file) };
+    if (!mapped->isValid())
+    {
+        return nullptr; // Invalid (truncated) file: computed and written again.
+    }
+    store.mMapped[id] = mapped;
+    return mapped;
+}
+
+// static
+AudioPeaksFilePtr AudioPeaksStore::add(const wxString& id, AudioPeaks peaks)
+{
+    if (!exists() || id.IsEmpty()) { return boost::make_shared<AudioPeaksFile>(std::move(peaks)); }
+
+    AudioPeaksStore& store{ get() };
+    wxFileName file{ getFile(id) };
+    AudioPeaksFilePtr result;
+    {
+        boost::mutex::scoped_lock lock(store.mMutex);
+        auto it = store.mMapped.find(id);
+        if (it != store.mMapped.end())
+        {
+            AudioPeaksFilePtr mapped{ it->second.lock() };
+            if (mapped) { return mapped; } // Computed simultaneously for another clip. Do not overwrite a mapped file.
+        }
+        if (store.mPersistent && write(file, peaks))
+        {
+            AudioPeaksFilePtr mapped{ boost::make_shared<AudioPeaksFile>(file) };
+            if (mapped->isValid())
+            {
+                result = mapped;
+            }
+        }
+        if (!result)
+        {
+            result = boost::make_shared<AudioPeaksFile>(std::move(peaks));
+        }
+        store.mMapped[id] = result;
+    }
+    if (store.mPersistent)
+    {
+        store.cleanup(file);
+    }
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+wxFileName AudioPeaksStore::getFile(const wxString& id)
+{
+    wxFileName result{ util::path::getAudioPeaksPath() };
+    result.SetName(id);
+    result.SetExt("peaks");
+    return result;
+}
+
+// static
+bool AudioPeaksStore::write(const wxFileName& file, const AudioPeaks& peaks)
+{
+    // Only complete files are ever used.
+    return util::path::writeAtomically(file, [&peaks](wxFile& output) -> bool
+    {
+        AudioPeaksHeader header;
+        header.Count = peaks.size();
+        size_t bytes{ peaks.size() * sizeof(AudioPeak) };
+        return
+            output.Write(&header, sizeof(AudioPeaksHeader)) == sizeof(AudioPeaksHeader) &&
+            output.Write(peaks.data(), bytes) == bytes;
+    });
+}
+
+void AudioPeaksStore::cleanup(const wxFileName& written)
+{
+    wxFileName folder{ util::path::getAudioPeaksPath() };
+    if (!folder.DirExists()) { return; }
+
+    wxArrayString names;
+    wxDir::GetAllFiles(folder.GetLongPath(), &names, "*.peaks", wxDIR_FILES);
+    std::vector<util::path::FileIdentity> files;
+    int64_t total{ 0 };
+    for (const wxString& name : names)
+    {
+        boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(wxFileName(name)) };
+        if (identity)
+        {
+            files.emplace_back(*identity);
+            total += identity->Size;
+        }
+    }
+    if (total <= sAudioPeaksStoreMaximumSize) { return; }
+
+    // Each file's modification time is updated when it is used (see find()).
+    std::sort(files.begin(), files.end(), [](const util::path::FileIdentity& f1, const util::path::FileIdentity& f2) { return f1.Modified < f2.Modified; });
+    boost::mutex::scoped_lock lock(mMutex); // Avoid removing a file that is mapped by find() simultaneously.
+    for (const util::path::FileIdentity& file : files)
+    {
+        if (total <= sAudioPeaksStoreMaximumSize) { break; }
+        wxFileName name{ file.Path };
+        auto it = mMapped.find(name.GetName());
+        if ((it != mMapped.end() && !it->second.expired()) ||
+            name.GetFullPath() == written.GetFullPath())
+        {
+            continue; // In use.
+        }
+        if (wxRemoveFile(file.Path))
+        {
+            total -= file.Size;
+        }
+    }
+    VAR_INFO(total);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const AudioPeaksStore& obj)
+{
+    os  << &obj << '|'
+        << obj.mMapped.size();
+    return os;
+}
+
+} //namespace
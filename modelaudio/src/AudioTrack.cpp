@@ -47,6 +47,7 @@ AudioTrack* AudioTrack::clone() const
 AudioTrack::~AudioTrack()
 {
     VAR_DEBUG(this);
+    lookahead_cancel(); // Before the members used by the lookahead thread are destructed.
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -57,6 +58,7 @@ void AudioTrack::clean()
 {
     VAR_DEBUG(this);
     Track::clean();
+    mLookaheadChunk.reset(); // Release the chunk's memory
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -66,22 +68,63 @@ void AudioTrack::clean()
 AudioChunkPtr AudioTrack::getNextAudio(const AudioCompositionParameters& parameters)
 {
     AudioChunkPtr audioChunk;
+    AudioChunkPtr preparedChunk; // First chunk of the current clip, retrieved in advance.
 
     while (!audioChunk && !iterate_atEnd())
     {
         model::IAudioPtr audio = boost::dynamic_pointer_cast<IAudio>(iterate_get());
         model::IClipPtr clip = boost::dynamic_pointer_cast<IClip>(iterate_get());
-        audioChunk = audio->getNextAudio(AudioCompositionParameters(parameters).adjustPts(-clip->getLeftPts()));
+        AudioCompositionParameters clipParameters{ AudioCompositionParameters(parameters).adjustPts(-clip->getLeftPts()) };
+        if (preparedChunk && mLookaheadParameters && *mLookaheadParameters == clipParameters)
+        {
+            audioChunk = preparedChunk;
+        }
+        else
+        {
+            if (preparedChunk)
+            {
+                // Retrieved with different parameters (for instance, the playback speed was changed).
+                clip->moveTo(0);
+            }
+            audioChunk = audio->getNextAudio(clipParameters);
+        }
+        preparedChunk.reset();
         if (!audioChunk)
         {
             iterate_next();
             if (!iterate_atEnd())
             {
-                iterate_get()->moveTo(0);
+                if (lookahead_finish(iterate_get()))
+                {
+                    preparedChunk = mLookaheadChunk;
+                }
+                mLookaheadChunk.reset();
+                if (!preparedChunk)
+                {
+                    iterate_get()->moveTo(0);
+                }
             }
         }
     }
 
+    if (audioChunk && parameters.hasPts())
+    {
+        lookahead_start(parameters.getPts(), [this, parameters](const IClipPtr& clip)
+        {
+            // The chunk size depends on the position in the sequence.
+            AudioCompositionParameters lookaheadParameters{ AudioCompositionParameters()
+                .setSampleRate(parameters.getSampleRate())
+                .setNrChannels(parameters.getNrChannels())
+                .setSpeed(parameters.getSpeed())
+                .setPts(clip->getLeftPts())
+                .determineChunkSize()
+                .adjustPts(-clip->getLeftPts()) };
+            clip->moveTo(0);
+            mLookaheadChunk = boost::dynamic_pointer_cast<IAudio>(clip)->getNextAudio(lookaheadParameters);
+            mLookaheadParameters.reset(lookaheadParameters);
+        });
+    }
+
     return audioChunk;
 }
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "FileContextCache.h"
 #include "FilePacket.h"
 #include "IFile.h"
 #include "IPath.h"
@@ -157,6 +158,23 @@ protected:
     /// first a moveTo() is required to reset the EOF flag.
     bool getEOF() const;
 
+    //////////////////////////////////////////////////////////////////////////
+    // DECODER REUSE INTERFACE TO SUBCLASSES
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Take over the decoder for the current stream, if it was left open in
+    /// the (cached) file context. The decoder's threads are claimed again. If
+    /// the budget does not allow that, the decoder is closed.
+    /// \return number of decoding threads claimed for the open decoder, 0 if the decoder is not open.
+    int takeOpenDecoder();
+
+    /// Do not close the decoder of the current stream. Instead, keep it open
+    /// when the file is closed, for reuse by a subsequent user of the file context.
+    /// The decoder's threads are returned to the budget until the decoder is taken over.
+    /// \param nThreads number of decoding threads claimed for the decoder
+    /// \see FileContextCache
+    void leaveDecoderOpen(int nThreads);
+
 private:
 
     //////////////////////////////////////////////////////////////////////////
@@ -164,11 +182,13 @@ private:
     //////////////////////////////////////////////////////////////////////////
 
     boost::mutex sMutexStop; ///< This mutex is needed to ensure that any pending getNextPacket() - which is executed in an external thread - is finished when stopping.
+    boost::mutex mMutexFile; ///< Guards opening/closing of mFileContext and starting/stopping the reading of packets. Only this file is locked, thus other files can be opened/read in parallel.
 
     // Attributes
     wxFileName mPath;
     wxString mName;
     mutable boost::optional<pts> mNumberOfFrames;
+    bool mNumberOfFramesEstimated = false; ///< True if mNumberOfFrames is a provisional value (see FileLength::estimate).
     bool mHasVideo = false;
     bool mHasAudio = false;
     int64_t mMaximumStartPts = 0; ///< Holds the maximum of the start positions of any stream. Any packet that is before this, is discarded, to ensure audio-video sync.
@@ -183,12 +203,13 @@ private:
     // AVCodec access
     AVFormatContext* mFileContext = nullptr;
     int mStreamIndex = STREAMINDEX_UNDEFINED;
+    OpenDecoders mOpenDecoders;     ///< Decoders that are open in mFileContext, but not in use.
 
     // Buffering
     int mMaxBufferSize = 0;
-    FifoPacket mPackets; ///< Holds retrieved packets until extracted with getNextPacket()
     int mTwoInARow = 0;
-    std::unique_ptr<boost::thread> mBufferPacketsThreadPtr = nullptr;
+    int64_t mSeekTimestamp = 0; ///< Position at which reading packets starts (in AV_TIME_BASE units). 0 means 'from the beginning of the file'.
+    DemuxerStreamPtr mDemuxerStream = nullptr; ///< Holds retrieved packets until extracted with getNextPacket(). The demuxer may be shared with other files (streams) for the same path.
 
     //////////////////////////////////////////////////////////////////////////
     // HELPER METHODS
@@ -208,11 +229,9 @@ private:
 
     void closeFile();
 
-    //////////////////////////////////////////////////////////////////////////
-    // THREADS
-    //////////////////////////////////////////////////////////////////////////
-
-    void bufferPacketsThread();
+    /// \return true if the meta data of the file was found in the
+    ///         FileMetaDataStore. Then, the file need not be opened.
+    bool readMetaDataFromStore();
 
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
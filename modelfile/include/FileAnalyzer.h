@@ -91,14 +91,37 @@ private:
 
     int mNumberOfProjects = 0;
     int mFolders = 0;
-    int mNumberOfMediaFiles = 0;
+    std::atomic<int> mNumberOfMediaFiles{ 0 };
+
+    /// Result of opening one file.
+    struct Probe
+    {
+        wxFileName Path;
+        boost::optional<size_t> Node;   ///< Index in mNodes, for files that were given explicitly (not found in a folder).
+        FilePtr File;                   ///< Only set if the file can be opened.
+        boost::optional<FrameRate> VideoFrameRate;
+        boost::optional<wxSize> VideoSize;
+        boost::optional<std::pair<int, int>> AudioRate;
+    };
+
+    std::vector<Probe> mProbes;
 
     //////////////////////////////////////////////////////////////////////////
     // HELPER METHODS
     //////////////////////////////////////////////////////////////////////////
 
     void indexFolder(const wxFileName& dirName, bool recurse = true);
-    FilePtr indexFile(const wxFileName& fileName);
+
+    /// Open all files in mProbes, using multiple threads. Opening a file
+    /// mostly consists of waiting for (small) reads of the file headers.
+    void probeFiles();
+
+    /// Open one file. Called from the probing threads.
+    void probeFile(Probe& probe);
+
+    /// Update the 'most frequent' statistics with the result of one probe.
+    void addToStatistics(const Probe& probe);
+
     void updateProgressDialog();
 
 };
@@ -0,0 +1,106 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "UtilSingleInstance.h"
+
+struct AVFormatContext;
+
+namespace model {
+
+/// Open decoders in a format context: stream index -> number of decoding
+/// threads of that decoder. Whilst not in use, these threads are not claimed
+/// from the budget (see Avcodec::claimDecodingThreads).
+typedef std::map<int, int> OpenDecoders;
+
+/// Holds opened (avformat_open_input + avformat_find_stream_info) format
+/// contexts that are currently not in use, for reuse by other File objects
+/// for the same path (typically, clones made for the timeline). Decoders
+/// that were opened in such a context may be left open, for avoiding the
+/// costs of avcodec_open2 (and starting the decoding threads) again.
+///
+/// The cache is bounded by a memory budget. The least recently released
+/// contexts are closed first.
+class FileContextCache
+    :   public SingleInstance<FileContextCache>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    FileContextCache();
+    FileContextCache(const FileContextCache&) = delete;
+    FileContextCache& operator=(const FileContextCache&) = delete;
+    virtual ~FileContextCache();
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Get an opened context from the cache. The context is removed from the
+    /// cache (it is not shared).
+    /// \param path file for which a context is required
+    /// \param decoders upon return, the decoders that are open in the returned context
+    /// \param decoderStream if >= 0, preferably return a context in which the decoder for this stream is open
+    /// \return nullptr if the cache holds no context for the given path. Then, the caller must open the file.
+    static AVFormatContext* acquire(const wxFileName& path, OpenDecoders& decoders, int decoderStream = -1);
+
+    /// Return a context that is no longer used to the cache. If there is no
+    /// cache, the context is closed.
+    /// \param path file for which the context was opened
+    /// \param context context to be returned (may be nullptr)
+    /// \param decoders the decoders that are left open in the given context
+    static void release(const wxFileName& path, AVFormatContext* context, const OpenDecoders& decoders);
+
+    /// Close a context, including any decoders left open in it.
+    static void close(AVFormatContext* context, const OpenDecoders& decoders);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Entry
+    {
+        wxString Path;
+        AVFormatContext* Context;
+        OpenDecoders Decoders;
+        size_t Size;    ///< Estimated memory usage (bytes).
+    };
+
+    boost::mutex mMutex;
+    std::list<Entry> mEntries; ///< Most recently released last.
+    size_t mSize = 0;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    static size_t estimateSize(AVFormatContext* context, const OpenDecoders& decoders);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FileContextCache& obj);
+};
+
+} // namespace
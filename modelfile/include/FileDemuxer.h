@@ -0,0 +1,212 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "FileContextCache.h"
+#include "FilePacket.h"
+
+struct AVFormatContext;
+struct AVPacket;
+
+namespace model {
+
+class FileIndex;
+
+/// Reads all packets of one media file (starting at a given position) and
+/// routes these packets to per-stream queues. Multiple File objects reading
+/// different streams of the same file (typically, the VideoFile and AudioFile
+/// of a clip with sound) share one Demuxer. That way, the file is read (and
+/// demuxed) only once, by only one thread.
+///
+/// A File joins an existing Demuxer if that Demuxer was started (nearly) at
+/// the same position, and if the packets for the File's stream have been
+/// retained since that start. Packets of streams without a consumer are only
+/// retained for a limited amount of packets. After that, the stream can no
+/// longer be joined, and a new Demuxer is started for a subsequent consumer.
+///
+/// A Demuxer has no thread of its own. The actual reading is done by the
+/// threads of the DemuxerPool, via readPackets().
+///
+/// When starting at a position other than the beginning, a format context
+/// that was opened before is taken from the FileContextCache and positioned
+/// with a seek. The context is returned to that cache when the Demuxer is
+/// destructed. That avoids opening and probing the file again upon each
+/// seek or clip boundary.
+class Demuxer
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    Demuxer(const wxFileName& path, int64_t timestamp);
+    Demuxer(const Demuxer&) = delete;
+    Demuxer& operator=(const Demuxer&) = delete;
+    virtual ~Demuxer();
+
+    /// Start reading the packets of one stream of a file.
+    /// \param path file to be read
+    /// \param streamIndex index of the stream to be read (as determined by avformat)
+    /// \param timestamp start position (in AV_TIME_BASE units, including any start_time offset). 0 means 'read from the beginning, without seeking'.
+    /// \param maxBufferSize number of packets that is buffered for this stream
+    /// \return handle for retrieving the packets. Reading stops when this handle is destructed.
+    static DemuxerStreamPtr subscribe(const wxFileName& path, int streamIndex, int64_t timestamp, size_t maxBufferSize);
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE FOR DEMUXERSTREAM
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Retrieve next packet for a stream. Blocks until a packet is available.
+    /// \return '0' packet if the end of file was reached or if reading was aborted.
+    PacketPtr pop(int streamIndex);
+
+    /// Unblock any pending pop() for this stream (returns a '0' packet).
+    void abort(int streamIndex);
+
+    void setMaxBufferSize(int streamIndex, size_t maxBufferSize);
+
+    void unsubscribe(int streamIndex);
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE FOR DEMUXERPOOL
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return amount of buffered media (in AV_TIME_BASE units) of the consumer
+    ///         that will run out of packets first. Lower values are more urgent.
+    ///         Returns -1 if a consumer is blocked, waiting for a packet.
+    ///         Returns boost::none if no consumer requires packets.
+    boost::optional<int64_t> getDeadline();
+
+    /// Read a limited batch of packets. Opens the file upon the first call.
+    /// \return false if no more packets will be read (end of file or error).
+    bool readPackets();
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct StreamQueue
+    {
+        std::deque<PacketPtr> Packets;
+        size_t MaxBufferSize = 1;
+        AVRational TimeBase = { 1, AV_TIME_BASE };
+        bool Subscribed = false;
+        bool Joinable = true;  ///< True if all packets since the start have been retained.
+        bool Aborted = false;
+        bool Waiting = false;  ///< True if the consumer is blocked in pop().
+    };
+
+    wxFileName mPath;
+    int64_t mTimestamp;             ///< Requested start position of the first consumer.
+    AVFormatContext* mContext = nullptr;
+    OpenDecoders mDecoders;         ///< Decoders left open in mContext by a previous user (see FileContextCache).
+
+    boost::mutex mMutex;
+    boost::condition_variable mConditionPacketAvailable;
+    std::map<int, StreamQueue> mQueues;
+    bool mStreamsKnown = false;     ///< True once the file has been opened and the list of retained streams is known.
+    bool mEOF = false;
+
+    /// After seeking via the byte offset of an indexed packet, avformat
+    /// does not know the timestamps of the packets read. These are then
+    /// derived from the index entry's pts and the packet durations.
+    /// Only used by the (one) pool thread servicing this demuxer.
+    int mRestoreStream = -1;
+    int64_t mRestorePts = 0;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return true if a consumer for the given stream, starting at the given
+    ///         position, can use the packets of this demuxer.
+    bool canJoin(int streamIndex, int64_t timestamp);
+
+    void join(int streamIndex, size_t maxBufferSize);
+
+    /// \return true if any consumer requires more packets, and no consumer
+    ///         has reached the hard limit of its buffer.
+    bool packetRequired() const;
+
+    /// Open the file and position at the start position.
+    /// \return false if the file could not be opened.
+    bool open();
+
+    /// Open the file anew (without using the FileContextCache).
+    /// \return false if the file could not be opened.
+    bool openContext();
+
+    /// Close the current context, including any decoders left open in it.
+    void closeContext();
+
+    /// \return stream of which the index is used for seeking, -1 if the index can not be used.
+    int getSeekStream(const FileIndex& index);
+
+    /// Fill in the pts of packets that lack timestamps after seeking (see mRestoreStream).
+    void restoreTimestamps(AVPacket* packet);
+
+    /// Signal the DemuxerPool that the demand for packets changed.
+    void notifyPool();
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const Demuxer& obj);
+};
+
+/// Handle for reading the packets of one stream from a (possibly shared) Demuxer.
+class DemuxerStream
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    DemuxerStream(DemuxerPtr demuxer, int streamIndex);
+    DemuxerStream(const DemuxerStream&) = delete;
+    DemuxerStream& operator=(const DemuxerStream&) = delete;
+    virtual ~DemuxerStream();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \see Demuxer::pop
+    PacketPtr pop();
+
+    /// \see Demuxer::abort
+    void abort();
+
+    void setMaxBufferSize(size_t maxBufferSize);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    DemuxerPtr mDemuxer;
+    int mStreamIndex;
+};
+
+} // namespace
@@ -0,0 +1,97 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "UtilSingleInstance.h"
+
+namespace model {
+
+/// Small, fixed set of threads that read the packets for all demuxers.
+///
+/// Previously, each opened file had its own reading thread, most of which
+/// were blocked on a full buffer most of the time. Now, demuxers signal
+/// (via notify()) that their demand has changed, and the pool threads service
+/// the demuxer with the earliest deadline first: the demuxer for which a
+/// consumer has the least amount of buffered media. Demuxers with equal
+/// deadlines are serviced round robin.
+class DemuxerPool
+    :   public SingleInstance<DemuxerPool>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    DemuxerPool();
+    DemuxerPool(const DemuxerPool&) = delete;
+    DemuxerPool& operator=(const DemuxerPool&) = delete;
+    virtual ~DemuxerPool();
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE FOR DEMUXER
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Start reading for the given demuxer. The demuxer is removed from the
+    /// pool when the end of the file is reached, or when it is destructed.
+    void add(const DemuxerPtr& demuxer);
+
+    /// Wake up the threads for (re)evaluating the demuxers' demand.
+    void notify();
+
+    //////////////////////////////////////////////////////////////////////////
+    // BACKGROUND TASKS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Run a (file reading) task whenever no demuxer requires packets. Only
+    /// one such task is executed at a time, to avoid disturbing playback.
+    /// \param task is called repeatedly until it returns false. Each call
+    ///        should do only a limited amount of work (for example, read
+    ///        a batch of packets).
+    void schedule(const std::function<bool()>& task);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Entry
+    {
+        boost::weak_ptr<Demuxer> Reader;
+        bool Busy = false;  ///< True if a pool thread is reading for this demuxer.
+    };
+
+    boost::mutex mMutex;
+    boost::condition_variable mCondition;
+    std::list<Entry> mEntries;
+    std::deque<std::function<bool()>> mTasks;
+    bool mTaskBusy = false;
+    unsigned int mChanges = 0;  ///< Incremented whenever the condition is notified. Detects notifications given while a pool thread had released the lock.
+    bool mStop = false;
+
+    boost::thread_group mThreads;
+
+    //////////////////////////////////////////////////////////////////////////
+    // THREADS
+    //////////////////////////////////////////////////////////////////////////
+
+    void thread();
+};
+
+} // namespace
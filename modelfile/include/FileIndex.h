@@ -0,0 +1,174 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+class BinaryReader;
+class BinaryWriter;
+struct AVFormatContext;
+struct AVPacket;
+
+namespace model {
+
+class FileIndex;
+typedef boost::shared_ptr<const FileIndex> FileIndexPtr;
+
+struct FileIndexEntry
+{
+    int64_t Pts = 0;        ///< In stream time base.
+    int64_t Position = -1;  ///< Byte offset of the packet in the file. -1 if unknown.
+    bool KeyFrame = false;
+};
+
+/// Seek index for one media file. Holds the position of all keyframes of the
+/// video streams of the file. With this index, seeking is done to exactly the
+/// nearest keyframe at or before the requested position. Without the index,
+/// avformat may position on a keyframe after the requested position, or (long
+/// GOP sources) far before it, causing lots of frames to be decoded and
+/// discarded after each seek.
+///
+/// For audio-only files, the first sample (pts) and byte offset of a packet is
+/// stored for every sFileIndexAudioInterval of audio. For files with variable
+/// bit rate audio (mp3, aac) avformat estimates the position from the average
+/// bit rate, which may be seconds off for long files. With the index, reading
+/// starts at a packet whose timestamp is known exactly.
+///
+/// Most containers (mp4, mov, mkv, avi) hold an index of their own, which
+/// avformat reads when opening the file. For these, the index is taken from
+/// the container. For other files (mpeg-ts, vob, mp3) the index is built by
+/// reading the entire file. That is done in the background, only once the
+/// file is positioned or played for the first time (see require()).
+///
+/// The index is stored in the FileMetaDataStore. Once stored, an index is
+/// never changed.
+class FileIndex
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    FileIndex() = default;
+    FileIndex(const FileIndex&) = default;
+    ~FileIndex() = default;
+
+    /// Get the index of a file that is about to be read. If the index is not
+    /// known yet, it is taken from the container. If the container has no
+    /// index, building the index is started (see schedule()).
+    /// \param path file for which the index is required
+    /// \param context opened (and probed) format context of the file
+    /// \return the index, nullptr if it is not available (yet)
+    static FileIndexPtr require(const wxFileName& path, const AVFormatContext* context);
+
+    /// \return index made from the index entries that avformat read from the
+    ///         container, nullptr if the container holds no (complete) index.
+    static boost::shared_ptr<FileIndex> fromContainer(const AVFormatContext* context);
+
+    /// Start building the index for the given file in the background, unless
+    /// the index is already available (or being built).
+    /// \param determineLength if true, then also the exact length of the file
+    ///        is determined from the packets read, and stored in the
+    ///        FileMetaDataCache (for files without duration metadata, see FileLength).
+    static void schedule(const wxFileName& path, bool determineLength = false);
+
+    //////////////////////////////////////////////////////////////////////////
+    // BUILDING
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Must be called with each packet read, in file order.
+    void add(const AVFormatContext* context, const AVPacket* packet);
+
+    //////////////////////////////////////////////////////////////////////////
+    // SEEKING
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Seek to the keyframe at or before the given position.
+    /// For audio streams, the position is chosen such that at least
+    /// sFileIndexAudioPreroll of audio is read before the given position
+    /// (for 'warming up' the decoder, see AudioFile::getNextAudio).
+    /// \param context opened file to be positioned
+    /// \param streamIndex stream of which the index entries are used
+    /// \param timestamp position (in AV_TIME_BASE units, including any start_time offset).
+    /// \return pts (in the stream's time base) of the first packet of the stream read after the seek, boost::none if the seek failed.
+    boost::optional<int64_t> seek(AVFormatContext* context, int streamIndex, int64_t timestamp) const;
+
+    /// \return true if the given stream is indexed.
+    bool hasStream(int streamIndex) const;
+
+    /// \param streamIndex stream for which the keyframe is required
+    /// \param pts position (in stream time base, including any start_time offset)
+    /// \return pts of the keyframe at or before the given position, boost::none if not known.
+    boost::optional<int64_t> getKeyFrame(int streamIndex, int64_t pts) const;
+
+    /// \return pts (in stream time base) of the last keyframe of the stream, boost::none if not known.
+    boost::optional<int64_t> getLastKeyFrame(int streamIndex) const;
+
+    /// Determine which part of the file must be read for decoding an interval
+    /// of all indexed streams (from the keyframe at or before the interval).
+    /// \param begin start of the interval (in AV_TIME_BASE units, relative to the first indexed packet of each stream)
+    /// \param end end of the interval (idem)
+    /// \return first and last byte offset, the latter std::numeric_limits<int64_t>::max() if the interval extends to the end of the file. boost::none if unknown.
+    boost::optional<std::pair<int64_t, int64_t>> getByteRange(int64_t begin, int64_t end) const;
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Stream
+    {
+        int TimeBaseNum = 1;
+        int TimeBaseDen = AV_TIME_BASE;
+        std::vector<FileIndexEntry> Entries; ///< Sorted on Pts.
+    };
+
+    std::map<int, Stream> mStreams;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return true if the packets of the given stream are indexed. Audio is
+    ///         only indexed for files without video: files with video are
+    ///         positioned via their video keyframes (see Demuxer::getSeekStream).
+    static bool isIndexed(const AVFormatContext* context, int streamIndex);
+
+    /// \return keyframe at or before the given position. nullptr if there is no such keyframe.
+    static const FileIndexEntry* findKeyFrame(const Stream& stream, int64_t pts);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FileIndex& obj);
+
+    //////////////////////////////////////////////////////////////////////////
+    // SERIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+public:
+
+    /// Compact representation, used by the FileMetaDataStore.
+    void write(BinaryWriter& writer) const;
+
+    /// \return index read from the given data, nullptr if the data is invalid.
+    static boost::shared_ptr<FileIndex> read(BinaryReader& reader);
+};
+
+} // namespace
@@ -0,0 +1,138 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "UtilSingleInstance.h"
+
+class ReadOnlyFile;
+struct AVFormatContext;
+namespace util { namespace path { struct FileIdentity; } }
+
+namespace model {
+
+/// Reads done by demuxers, and how many of these were served from data
+/// requested beforehand via FileInput::prefetch.
+struct FileInputStatistics
+{
+    uint64_t Reads = 0;
+    uint64_t Hits = 0;
+
+    /// \return fraction of the reads that were prefetched, 0 if there were no reads.
+    double getHitRate() const;
+
+    friend std::ostream& operator<<(std::ostream& os, const FileInputStatistics& obj);
+};
+
+/// Opens media files for avformat via larger, positional reads, instead of
+/// via avformat's file protocol.
+///
+/// The file protocol reads with many small read() calls (one per 32KB
+/// buffer), which is costly for high bitrate (intra frame) files. Here,
+/// avformat's reads use a larger buffer, and the operating system is asked
+/// to read the part of the file that follows the current read position in
+/// the background.
+///
+/// NOT: memory mapping the files. Accessing a mapping of a file that is
+/// truncated, still being written, or on a network share that becomes
+/// unavailable crashes the application.
+///
+/// All contexts opened for the same file (the VideoFile and AudioFile of a
+/// clip, their clones, the demuxers, and the index builder) share one open
+/// file. An open file is identified by the file's path, size and
+/// modification time. Thus, a changed file is opened again.
+///
+/// If a file can not be opened, or if this object does not exist, files are
+/// opened via avformat's file protocol.
+///
+/// Parts of files that will be read soon (see FilePrefetcher) can be
+/// requested from disk in advance via prefetch().
+class FileInput
+    :   public SingleInstance<FileInput>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    FileInput();
+    FileInput(const FileInput&) = delete;
+    FileInput& operator=(const FileInput&) = delete;
+    virtual ~FileInput();
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Replacement for avformat_open_input.
+    /// \param context must point to nullptr. Upon success, points to the opened context.
+    /// \param path file to be opened
+    /// \param demuxing if true, the reads are included in the statistics
+    /// \return result of avformat_open_input
+    static int open(AVFormatContext** context, const wxFileName& path, bool demuxing = false);
+
+    /// Replacement for avformat_close_input. Must be used for all contexts opened with open().
+    /// \param context context to be closed. Is set to nullptr.
+    static void close(AVFormatContext** context);
+
+    /// Start reading the given part of the file from disk, in the background.
+    /// \param file file to be read, as determined by the caller (avoids querying the file system again for each part)
+    /// \param offset first byte
+    /// \param length number of bytes. Parts beyond the end of the file are ignored.
+    static void prefetch(const util::path::FileIdentity& file, int64_t offset, int64_t length);
+
+    /// \return statistics of all reads done by demuxers since the application was started.
+    static FileInputStatistics getStatistics();
+
+    /// Register a read done by a demuxer.
+    void countRead(const wxString& key, int64_t offset, int64_t length);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    boost::mutex mMutex;
+    std::map<wxString, boost::weak_ptr<const ReadOnlyFile>> mOpened; ///< Entries of closed files are removed whenever a context is closed.
+    std::map<wxString, std::deque<std::pair<int64_t, int64_t>>> mPrefetched; ///< Most recently prefetched parts [begin,end) of the most recently prefetched files.
+    std::deque<wxString> mPrefetchedOrder; ///< Keys of mPrefetched, least recently prefetched first.
+    FileInputStatistics mStatistics;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return identification of the given file (path, size, modification time), empty if the file can not be accessed.
+    static wxString getKey(const wxFileName& path);
+
+    /// \return shared open file, nullptr if the file can not be opened.
+    boost::shared_ptr<const ReadOnlyFile> openFile(const wxFileName& path, const wxString& key);
+
+    /// Remove the entries of files that are no longer used by any context.
+    void removeClosedFiles();
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FileInput& obj);
+};
+
+} // namespace
@@ -0,0 +1,98 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "FileIndex.h"
+
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+namespace model {
+
+/// Determines the length of a media file from the timestamps of its packets.
+/// Used for files that lack duration metadata (typically, MPEG-TS and VOB).
+///
+/// Reading all packets of such a file can take minutes for recordings of a
+/// few hours. Therefore, when opening a file only a provisional length is
+/// estimated (see estimate()). The exact length is determined in the
+/// background by reading all packets (see FileIndex::schedule) and stored in
+/// the FileMetaDataCache, for all subsequent uses of the file.
+class FileLength
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    explicit FileLength(const AVFormatContext* context);
+    FileLength(const FileLength&) = default;
+    ~FileLength() = default;
+
+    /// Estimate the length of a file without reading all of its packets.
+    /// Uses the timestamps of the packets at the end of the file, and the
+    /// keyframes in the seek index (if already built). As a last resort, the
+    /// length is derived from the file size and the bit rate.
+    /// Afterwards, the file is positioned at the beginning again.
+    /// \param context opened file
+    /// \param index seek index of the file, nullptr if not built yet
+    /// \return estimated length (in project frames), boost::none if no estimate could be made
+    static boost::optional<pts> estimate(AVFormatContext* context, const FileIndexPtr& index);
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Must be called for each packet read.
+    void add(const AVPacket* packet);
+
+    /// \return length (in project frames) derived from the packets that were
+    ///         added, boost::none if no length could be derived.
+    boost::optional<pts> get() const;
+
+    /// \return number of project frames for the given duration.
+    /// \param stream stream for which the duration is given
+    /// \param duration duration in stream time base
+    static pts getFrameCount(const AVStream* stream, int64_t duration);
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    const AVFormatContext* mContext;
+    std::vector<int64_t> mMaximumPts;   ///< Per stream, in stream time base.
+    std::vector<pts> mVideoPackets;     ///< Per stream, number of packets of video streams.
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    void addPts(int streamIndex, int64_t timestamp);
+
+    /// \return length derived from the maximum timestamps only.
+    boost::optional<pts> getFromTimestamps() const;
+
+    /// Read the packets at the end of the file (if the file supports
+    /// positioning on a byte offset), and position at the beginning again.
+    void readTail(AVFormatContext* context);
+};
+
+} // namespace
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "FileIndex.h"
 #include "UtilSingleInstance.h"
 
 namespace model {
@@ -24,6 +25,17 @@ namespace model {
 struct FileMetaData;
 typedef boost::shared_ptr<FileMetaData> FileMetaDataPtr;
 
+/// Meta data of the files in a project, stored with the project. Seek indexes
+/// are only cached here: these are stored in the FileMetaDataStore.
+///
+/// Lookups do not access the file system, and do not take a lock: they read
+/// an immutable snapshot of the cached data. Changes are made to a copy,
+/// which then replaces the snapshot. Changes are rare (typically, once per
+/// file) compared to lookups (for instance, for each clone of a file).
+///
+/// Each entry is validated (its modification time compared with the file on
+/// disk) once per session, upon its first use. Entries are validated again
+/// after a change of the file has been reported (see FileWatcher).
 class FileMetaDataCache
     :   public SingleInstance<FileMetaDataCache>
 {
@@ -44,6 +56,14 @@ public:
     boost::optional<pts> getLength(const wxFileName& file);
     void setLength(const wxFileName& file, const pts& length);
 
+    /// \return seek index for the file, nullptr if not built yet.
+    FileIndexPtr getIndex(const wxFileName& file);
+    void setIndex(const wxFileName& file, const boost::shared_ptr<FileIndex>& index);
+
+    /// Validate the data for the given file again upon its next use.
+    /// \param path changed file, or folder containing changed files. If empty, all data is validated again.
+    void invalidate(const wxFileName& path);
+
 protected:
 
 private:
@@ -52,19 +72,29 @@ private:
     // MEMBERS
     //////////////////////////////////////////////////////////////////////////
 
+    typedef std::map<wxFileName, FileMetaDataPtr> MetaDataMap;
 
-    std::map<wxFileName, FileMetaDataPtr> mMetaData;
+    /// The entries in a published map are never changed.
+    /// Access only via boost::atomic_load/atomic_store.
+    boost::shared_ptr<const MetaDataMap> mMetaData;
 
-    mutable boost::mutex mMutex;
+    mutable boost::mutex mMutex; ///< Serializes changes.
 
     //////////////////////////////////////////////////////////////////////////
     // HELPER METHODS
     //////////////////////////////////////////////////////////////////////////
 
-    /// This method also verifies if the stored data was created for the file
-    /// with the same modification time. If not, then any stored information
-    /// is erased and nullptr is returned.
-    FileMetaDataPtr getDataForFile(const wxFileName& file);
+    /// \return validated data for the file, nullptr if there is none.
+    FileMetaDataPtr find(const wxFileName& file);
+
+    /// Must be called with mMutex taken.
+    /// Verifies that the stored data was created for the file with the same
+    /// modification time. If not, then nullptr is returned.
+    /// \return validated data for the file (possibly a validated copy of the stored data), nullptr if there is none.
+    FileMetaDataPtr validate(const MetaDataMap& metadata, const wxFileName& file) const;
+
+    /// Change the data for a file. Data is added for a file that is not known yet.
+    void change(const wxFileName& file, const std::function<void(FileMetaData&)>& method);
 
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
@@ -0,0 +1,145 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "FileIndex.h"
+#include "UtilSingleInstance.h"
+
+class MemoryMappedFile;
+
+namespace model {
+
+/// Stream layout and formats of a media file, as determined by opening it.
+struct FileProperties
+{
+    int VideoStream = -1;       ///< Index of the (first) supported video stream. -1 if there is no such stream.
+    int AudioStream = -1;       ///< Index of the (first) supported audio stream. -1 if there is no such stream.
+    int64_t MaximumStartPts = 0;
+    int FrameRateNum = 0;
+    int FrameRateDen = 1;
+    int Width = 0;
+    int Height = 0;
+    int SampleRate = 0;
+    int Channels = 0;
+};
+
+/// Machine wide cache of media file meta data, shared by all projects.
+/// For known files, opening a project or importing files does not require
+/// opening (probing) the files again.
+///
+/// Entries are identified by the file's path, size and modification time.
+/// A file that was changed on disk is thus never matched with outdated data.
+///
+/// The data is stored in a compact binary file (see util::path::getMediaCacheFilePath)
+/// which is memory mapped upon startup. Keyframe indexes are only decoded
+/// when used. The file is rewritten when the application exits. When running
+/// the automated tests the file is neither read nor written.
+class FileMetaDataStore
+    :   public SingleInstance<FileMetaDataStore>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    FileMetaDataStore();
+    FileMetaDataStore(const FileMetaDataStore&) = delete;
+    FileMetaDataStore& operator=(const FileMetaDataStore&) = delete;
+    virtual ~FileMetaDataStore();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    // All methods return 'nothing' if the file is unknown, or if the file was
+    // changed after storing the data.
+    //
+    // With 'trusted' the file on disk is not accessed at all: the stored data
+    // is returned even if the file was changed or removed in the meantime.
+    // Used for files that still have to be validated (see FileValidator).
+
+    static boost::optional<pts> getLength(const wxFileName& file, bool trusted = false);
+    static void setLength(const wxFileName& file, pts length);
+
+    static boost::optional<FileProperties> getProperties(const wxFileName& file, bool trusted = false);
+    static void setProperties(const wxFileName& file, const FileProperties& properties);
+
+    static FileIndexPtr getIndex(const wxFileName& file);
+    static void setIndex(const wxFileName& file, const FileIndexPtr& index);
+
+    /// \return location of the stored audio peaks of the file. Empty if not known.
+    static wxString getPeaks(const wxFileName& file);
+    static void setPeaks(const wxFileName& file, const wxString& location);
+
+    //////////////////////////////////////////////////////////////////////////
+    // TEST
+    //////////////////////////////////////////////////////////////////////////
+
+    static void write(const wxFileName& file);  ///< For testing only. Write all entries to the given file, and remove them.
+    static void read(const wxFileName& file);   ///< For testing only. Replace all entries with the entries in the given file.
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Entry
+    {
+        int64_t Size = 0;
+        int64_t Modified = 0;   ///< Seconds since epoch.
+        int64_t LastUsed = 0;   ///< Seconds since epoch.
+        boost::optional<pts> Length = boost::none;
+        boost::optional<FileProperties> Properties = boost::none;
+        wxString Peaks;
+        FileIndexPtr Index = nullptr;
+        const char* IndexData = nullptr;    ///< Index, not decoded yet (points into mFile).
+        size_t IndexSize = 0;
+    };
+
+    const bool mPersistent;
+    wxFileName mPath;
+    std::unique_ptr<MemoryMappedFile> mFile;
+
+    boost::mutex mMutex;
+    std::map<wxString, Entry> mEntries;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Must be called with mMutex taken.
+    /// \param create if true, an entry is made for a file that is not known
+    /// \param trusted if true, the stored entry is returned without comparing it to the file on disk
+    /// \return entry for the file, nullptr if not present (or outdated, or the file does not exist)
+    Entry* find(const wxFileName& file, bool create, bool trusted = false);
+
+    /// Must be called with mMutex taken.
+    void load(const wxFileName& path);
+
+    void save(const wxFileName& path);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FileMetaDataStore& obj);
+};
+
+} // namespace
@@ -17,13 +17,17 @@
 
 #pragma once
 
-#include "UtilFifo.h"
-
 struct AVPacket;
 
 namespace model {
 
-/// Container class for embedding avcodec packets
+/// Container class for embedding avcodec packets.
+///
+/// Packets are reference counted (intrusively) and recycled: when the last
+/// reference is released, the packet's data is unreferenced and the Packet
+/// object (including its AVPacket) is returned to a pool, for reuse by the
+/// next demuxed packet. The data of a demuxed packet is never copied: the
+/// Packet takes over the reference to the demuxer's buffer.
 class Packet
 {
 public:
@@ -32,7 +36,12 @@ public:
     // INITIALIZATION
     //////////////////////////////////////////////////////////////////////////
 
-    Packet(AVPacket* packet);
+    /// Take over the data of the given packet.
+    /// \param packet packet as returned by av_read_frame. Upon return, the packet has been reset.
+    /// \return packet holding the data
+    static PacketPtr take(AVPacket* packet);
+
+    Packet();
     Packet(const Packet& other) = delete;
     Packet& operator=(const Packet&) = delete;
     virtual ~Packet();
@@ -51,8 +60,17 @@ private:
     //////////////////////////////////////////////////////////////////////////
 
     AVPacket* mPacket;
+    std::atomic<int> mReferences{ 0 };
+
+    //////////////////////////////////////////////////////////////////////////
+    // REFERENCE COUNTING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend void intrusive_ptr_add_ref(Packet* packet);
+    friend void intrusive_ptr_release(Packet* packet);
 };
 
-typedef Fifo<PacketPtr> FifoPacket;
+void intrusive_ptr_add_ref(Packet* packet);
+void intrusive_ptr_release(Packet* packet);
 
 } // namespace
@@ -0,0 +1,104 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+namespace model {
+
+struct FilePrefetcherWork;
+
+/// Requests the parts of media files that are needed for playing a sequence
+/// from disk, before the demuxers need them.
+///
+/// Reading is normally done on demand, by the Demuxer, when the decoders
+/// require packets. For sources on slow (spinning, network) disks that may
+/// cause stuttering playback, particularly at clip boundaries where another
+/// file is started. However, given the playback position, the clips that
+/// will be played next are known from the tracks, and the parts of their
+/// files from the clips' offsets and speeds (and the FileIndex of the file).
+/// For all these parts, the operating system is asked to start reading
+/// (see FileInput::prefetch).
+///
+/// The prefetched interval is a fixed amount of playback time, which is
+/// extended once half of it has been played.
+///
+/// Only the clips are determined in the main thread. Determining the parts
+/// of the files (which may require file system access) and requesting them
+/// is done in the background (see DemuxerPool::schedule). Requests that have
+/// not been handled yet when playback is started elsewhere (scrubbing) are
+/// discarded.
+///
+/// The fraction of the demuxers' reads that were served from prefetched data
+/// is available via FileInput::getStatistics.
+class FilePrefetcher
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    explicit FilePrefetcher(const SequencePtr& sequence);
+    FilePrefetcher(const FilePrefetcher&) = delete;
+    FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+    virtual ~FilePrefetcher();
+
+    //////////////////////////////////////////////////////////////////////////
+    // INTERFACE
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Prefetch the data that is needed when playing from the given position
+    /// in the given direction. Data that was prefetched already (for the
+    /// previous position and direction) is not requested again.
+    /// Must be called from the main thread, since the tracks are inspected.
+    /// Does not access the file system.
+    /// \param position current position in the sequence
+    /// \param forward true if the position increases during playback
+    void update(pts position, bool forward = true);
+
+    /// Forget which data has been prefetched (for instance, after editing),
+    /// and which files are used (they may have been changed on disk).
+    void reset();
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    SequencePtr mSequence;
+    bool mForward = true;
+    boost::optional<std::pair<pts, pts>> mPrefetched = boost::none; ///< Interval [begin,end) of the sequence that has been prefetched.
+    boost::shared_ptr<FilePrefetcherWork> mWork; ///< Shared with the background task, which may outlive this object.
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Prefetch the data for the given interval [begin,end) of the sequence.
+    /// \param restart if true, discard the requests that have not been handled yet
+    void prefetch(pts begin, pts end, bool restart);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FilePrefetcher& obj);
+};
+
+} // namespace
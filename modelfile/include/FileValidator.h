@@ -0,0 +1,109 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "UtilSingleInstance.h"
+
+namespace model {
+
+/// Validates the files of a project in the background, after it was opened.
+///
+/// Opening a project does not access the media files. Instead, the meta data
+/// of a file that still has to be validated is taken from the caches (see
+/// FileMetaDataStore and FileMetaDataCache), without verifying that the file
+/// still exists and is unchanged. That verification is done here, in one
+/// background thread, file by file. Files shown in the timelines and in the
+/// project view are handled first (see prioritize()).
+///
+/// A file that was removed, or changed, is handled in the main thread after
+/// its validation, via INode::check() of the file's project view nodes.
+class FileValidator
+    :   public SingleInstance<FileValidator>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Start validating all files of the current project.
+    FileValidator();
+    FileValidator(const FileValidator&) = delete;
+    FileValidator& operator=(const FileValidator&) = delete;
+    virtual ~FileValidator();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return true if the file has not been validated yet. Until then, its
+    ///         cached meta data is trusted.
+    static bool isPending(const wxFileName& path);
+
+    /// Validate the given file before any other (not prioritized) files.
+    /// Called for files that become visible.
+    static void prioritize(const wxFileName& path);
+
+    //////////////////////////////////////////////////////////////////////////
+    // TEST
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Block until all files have been validated.
+    /// Note that the resulting checks are done later, in the main thread.
+    void waitUntilDone();
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    std::atomic<bool> mActive{ false }; ///< Avoids locking in isPending() once all files have been validated.
+    bool mStop = false;
+
+    mutable boost::mutex mMutex;
+    boost::condition_variable mCondition;
+    std::deque<wxString> mQueue;        ///< All files, in project view order.
+    std::deque<wxString> mPriority;     ///< Files that must be validated first.
+    std::set<wxString> mPending;        ///< Files that have not been validated yet.
+
+    boost::scoped_ptr<boost::thread> mThread;
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    void collect(const NodePtr& node);
+
+    void thread();
+
+    /// Executed in the validation thread.
+    /// \return true if the file exists, is readable, and was not changed since its meta data was cached
+    bool validate(const wxFileName& path) const;
+
+    /// Executed in the main thread, for a file that failed validation.
+    void handleInvalid(const wxString& path);
+
+    //////////////////////////////////////////////////////////////////////////
+    // LOGGING
+    //////////////////////////////////////////////////////////////////////////
+
+    friend std::ostream& operator<<(std::ostream& os, const FileValidator& obj);
+};
+
+} // namespace
@@ -28,6 +28,12 @@ namespace model {
 
 /// For each node in the project view that is a file/dir on disk, the parent folder
 /// must be watched for changes (to detect that the file/dir is removed).
+///
+/// For dispatching file system events, all nodes that correspond to a file/dir
+/// on disk are indexed on their path. That index is updated via the project
+/// events, avoiding a traversal of the whole project tree for each event. The
+/// resulting check() calls are batched: all events that arrive before the
+/// batch is handled cause only one check() per node.
 class FileWatcher
     :   public SingleInstance<FileWatcher>
 {
@@ -64,6 +70,11 @@ private:
     typedef std::map<wxString, NodeSet> MapFolderToNodes;
     MapFolderToNodes mWatches;
 
+    typedef std::unordered_map<wxString, NodeSet, wxStringHash, wxStringEqual> MapPathToNodes;
+    MapPathToNodes mPaths; ///< All nodes that correspond to a file/dir on disk, indexed on their (normalized) path.
+
+    NodeSet mPendingChecks; ///< Nodes for which a change was reported, but check() has not been called yet.
+
     // See wxWidgets Ticket #13294. To avoid this issue, Watcher is not
     // derived from wxFileSystemWatcher. Instead, mWatcher is going to be
     // destroyed and restarted again, upon each change. This ensures that
@@ -89,6 +100,16 @@ private:
 
     void watchAll(const model::NodePtr& node );
 
+    /// Add the node, and all its descendants, to the path index.
+    void index(const model::NodePtr& node);
+    /// Remove the node, and all its descendants, from the path index.
+    void unindex(const model::NodePtr& node);
+    /// \return all nodes that correspond to the given path on disk.
+    model::NodePtrs findPath(const wxFileName& path) const;
+
+    /// Call check() for all nodes for which a change was reported.
+    void checkPending();
+
     void watch(const model::NodePtr& node );
     void unwatch(const model::NodePtr& node );
 
@@ -21,7 +21,14 @@
 #include "Config.h"
 #include "Convert.h"
 #include "Dialog.h"
+#include "FileContextCache.h"
+#include "FileDemuxer.h"
+#include "FileIndex.h"
+#include "FileInput.h"
+#include "FileLength.h"
 #include "FileMetaDataCache.h"
+#include "FileMetaDataStore.h"
+#include "FileValidator.h"
 #include "FilePacket.h"
 #include "Project.h"
 #include "Properties.h"
@@ -30,7 +37,6 @@
 #include "UtilPath.h"
 #include "UtilSerializeBoost.h"
 #include "UtilSerializeWxwidgets.h"
-#include "UtilThread.h"
 #include "WximageFile.h"
 
 namespace model {
@@ -53,19 +59,6 @@ wxString File::sSupportedAudioExtensions{ "*.wav;*.mp3;*.flac;*.m2a;*.m4a;*.8svx
 //static
 wxString File::sSupportedImageExtensions{ "*.bmp;*.gif;*.jpg;*.png;*.tga;*.tif;*.tiff" };
 
-pts getFrameCount(AVStream* stream, int64_t duration)
-{
-    ASSERT_DIFFERS(duration, AV_NOPTS_VALUE);
-    if (duration == 1)
-    {
-        // Stil image: disregard the timebase, since rounding errors
-        // (timebase of file different than project time base)
-        // may result in the outcome '0'.
-        return 1;
-    }
-    return Convert::rationaltimeToPts(rational64(sSecond, 1) * rational64(duration, 1) * rational64(stream->time_base.num, stream->time_base.den));
-};
-
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
 //////////////////////////////////////////////////////////////////////////
@@ -79,7 +72,6 @@ File::File()
     , mNumberOfFrames(boost::none)
     // Buffering
     , mMaxBufferSize{ 0 }
-    , mPackets{ 1 }
 {
     VAR_DEBUG(this);
 }
@@ -93,7 +85,6 @@ File::File(const wxFileName& path, int buffersize)
     , mNumberOfFrames(boost::none)
     // Buffering
     , mMaxBufferSize(buffersize)
-    , mPackets(1)
 {
     VAR_DEBUG(this);
     readMetaData();
@@ -106,15 +97,17 @@ File::File(const File& other)
     , mPath{ other.mPath }
     , mName{ other.mName }
     , mNumberOfFrames{ other.mNumberOfFrames }
+    , mNumberOfFramesEstimated{ other.mNumberOfFramesEstimated }
     , mHasVideo{ other.mHasVideo }
     , mHasAudio{ other.mHasAudio }
     , mMaximumStartPts{ other.mMaximumStartPts }
     // Status of opening
     , mMetaDataKnown{ other.mMetaDataKnown }
     , mFileOpenedOk{ other.mFileOpenedOk }
+    // AVCodec access
+    , mStreamIndex{ other.mStreamIndex } // Known index: an opened decoder for that stream can be taken from the FileContextCache.
     // Buffering
     , mMaxBufferSize{ other.mMaxBufferSize }
-    , mPackets{ 1 }
 {
     VAR_DEBUG(this);
 }
@@ -204,7 +197,10 @@ pts File::getLength() const
             if (clone.canBeOpened())
             {
                 mNumberOfFrames.reset(clone.getNumberOfFrames());
-                FileMetaDataCache::get().setLength(getPath(), *mNumberOfFrames);
+                if (!clone.mNumberOfFramesEstimated)
+                {
+                    FileMetaDataCache::get().setLength(getPath(), *mNumberOfFrames); // Estimated lengths are replaced once the exact length is known.
+                }
             }
             else
             {
@@ -225,14 +221,6 @@ void File::moveTo(pts position)   // todo multipass rendering?
 {
     VAR_DEBUG(this)(position);
     ASSERT_MORE_THAN_EQUALS_ZERO(position);
-    if (position == 0)
-    {
-        // No seek required, just re-open file. Furthermore, for some files seeking to '0' causes problems
-        // whereas directly getting packets from these files results in proper decoding.
-        // Maybe these files do not start with a keyframe, causing the problems?
-        stopReadingPackets();
-        closeFile();
-    }
 
     openFile(); // Needed for avcodec calls below
 
@@ -240,6 +228,12 @@ void File::moveTo(pts position)   // todo multipass rendering?
 
     stopReadingPackets();
 
+    // The actual seek is done by the Demuxer when reading is started. Note that
+    // for position 0 no seek is done at all: for some files seeking to '0' causes
+    // problems whereas directly getting packets from these files results in proper
+    // decoding. Maybe these files do not start with a keyframe, causing the problems?
+    mSeekTimestamp = 0;
+
     int64_t timestamp = model::Convert::ptsToMicroseconds(position);
     if ((mFileContext->duration != AV_NOPTS_VALUE && timestamp >= mFileContext->duration) ||
         (position >= mNumberOfFrames))
@@ -257,49 +251,17 @@ void File::moveTo(pts position)   // todo multipass rendering?
 
         if (timestamp > 0)
         {
-            // Do not seek if == 0, may mess up some files. See remark at top of method.
+            // Do not seek if == 0, may mess up some files. See remark above.
             if (mFileContext->start_time != AV_NOPTS_VALUE)
             {
                 timestamp += mFileContext->start_time;
             }
-
-            // First, try seeking to a keyframe at the given position.
-            int result{ avformat_seek_file(mFileContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), 0) };
-            if (result < 0)
-            {
-                // Second, try seeking to a keyframe before the given position.
-                result = avformat_seek_file(mFileContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), AVSEEK_FLAG_BACKWARD);
-                if (result < 0)
-                {
-                    // Last resort, any frame will do.
-                    result = avformat_seek_file(mFileContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY);
-                }
-            }
-            if (result < 0)
-            {
-                VAR_WARNING(position)(avcodecErrorString(result))(*this);
-                // Extracting data from an improperly initialized file will cause a crash.
-                // However, some files can be read (only) when starting at the beginning.
-                // Close the file to ensure reading starts at the beginning.
-                // Then the 'skip frames' and 'skip samples' algorithms in VideoFile/AudioFile
-                // will cause the initial (unwanted) data to be discarded. Not efficient, but
-                // at least the files can be read in that case - and possibly converted.
-                //
-                // Note: original implementation here was to set 'mFileOpenedOk' to false and
-                //       avoid reading the data in the file (because I sometimes saw crashes)
-                //       when not doing so.
-                //
-                // Close file completely. It will be reopened (at the beginning) when its
-                // data is required.
-                stopReadingPackets();
-                closeFile();
-            }
+            mSeekTimestamp = timestamp;
         }
     }
 
-    ASSERT_ZERO(mPackets.getSize());
-    mPackets.resize(1); // Ensures that only one packet is buffered (used for thumbnail generation).
-    mTwoInARow = 0;
+    ASSERT_ZERO(mDemuxerStream);
+    mTwoInARow = 0; // Ensures that initially only one packet is buffered (used for thumbnail generation).
 
     VAR_DEBUG(this);
 }
@@ -341,6 +303,7 @@ wxString File::getName() const
 void File::readMetaData()
 {
     if (mMetaDataKnown) { return; }
+    if (readMetaDataFromStore()) { return; }
     openFile();
     closeFile();
 }
@@ -442,7 +405,7 @@ void File::startReadingPackets()
 {
     // If the end of file is reached, a subsequent getNext* should not
     // trigger a new (useless) sequence of startReadingPackets,
-    // bufferPacketsThread, "bufferPacketsThread: End of file."
+    // Demuxer::subscribe, "End of file."
     // (and this, over and over again....).
     //
     // First a moveTo() is required to reset EOF.
@@ -455,13 +418,13 @@ void File::startReadingPackets()
 
     VAR_DEBUG(this);
 
-    boost::mutex::scoped_lock lock(Avcodec::sMutex);
+    boost::mutex::scoped_lock lock(mMutexFile);
 
     mReadingPackets = true;
-    ASSERT(mBufferPacketsThreadPtr == nullptr); // To avoid leaking threads
+    ASSERT_ZERO(mDemuxerStream); // To avoid leaking demuxers
     try
     {
-        mBufferPacketsThreadPtr.reset(new boost::thread(std::bind(&File::bufferPacketsThread,this)));
+        mDemuxerStream = Demuxer::subscribe(mPath, mStreamIndex, mSeekTimestamp, mTwoInARow >= 2 ? mMaxBufferSize : 1);
     }
     catch (boost::exception &e)
     {
@@ -474,32 +437,27 @@ void File::startReadingPackets()
 void File::stopReadingPackets()
 {
     VAR_DEBUG(this)(mReadingPackets)(mEOF);
-    if (!mReadingPackets && !mEOF) return; // !mEOF is needed since we still want the buffers to be cleared, in the case that bufferPacketsThread has already delivered the last packet
-
-    boost::mutex::scoped_lock lock(Avcodec::sMutex);
+    if (!mReadingPackets && !mEOF) return; // !mEOF is needed since we still want the buffers to be cleared, in the case that the demuxer has already delivered the last packet
 
-    // Avoid new packets to be retrieved from the file in bufferPacketsThread.
-    mReadingPackets = false;
+    {
+        boost::mutex::scoped_lock lock(mMutexFile);
 
-    // Clear fifo to unblock any pending push in bufferPacketsThread.
-    mPackets.flush();
+        mReadingPackets = false;
 
-    // Wait until thread ends.
-    if (mBufferPacketsThreadPtr)
-    {
-        mBufferPacketsThreadPtr->join();
-        mBufferPacketsThreadPtr.reset();
+        // Unblock any pending pop in getNextPacket().
+        if (mDemuxerStream)
+        {
+            mDemuxerStream->abort();
+        }
     }
 
     // When this lock is taken, it is certain that no 'pop' is
     // blocking the return of getNextPacket().
     boost::mutex::scoped_lock stoplock(sMutexStop);
 
-    // Clear buffers again, since one new (empty) packet may have
-    // been added when ending bufferPacketsThread. This is done
-    // AFTER taking the lock sMutexStop to avoid clearing the
-    // '0' packet before getNextPacket() had a chance to return.
-    mPackets.flush();
+    // Release the demuxer. If no other file (stream) uses the same
+    // demuxer, its reading thread is stopped.
+    mDemuxerStream.reset();
 
     // Flush any buffered data
     // Typically, flush avcodec decoding buffers in AudioFile and VideoFile.
@@ -530,34 +488,32 @@ PacketPtr File::getNextPacket()
     if (mEOF)
     {
         // After EOF is reached, first a 'moveTo' must be done.
-        // Since in bufferPacketsThread() mReadingPackets is set to
-        // false also, we need to do this, to avoid restarting the
-        // bufferPacketsThread() in method startReadingPackets()
-
-        VAR_DEBUG(mEOF);
-
-        if (mPackets.getSize() == 0)
-        {
-            // EOF was reached AND the list of remaining packets
-            // is empty. Signal this.
-            LOG_DEBUG << "EOF";
-            return PacketPtr();
-        }
-    }
-    else
-    {
-        startReadingPackets(); // This is the normal trigger for starting to read
+        // EOF was reached AND the list of remaining packets
+        // is empty. Signal this.
+        LOG_DEBUG << "EOF";
+        return PacketPtr();
     }
 
+    startReadingPackets(); // This is the normal trigger for starting to read
+
     // This lock is used to signal that an external thread is blocked on
     // getting a new packet.
     boost::mutex::scoped_lock stoplock(sMutexStop);
 
+    if (!mDemuxerStream)
+    {
+        return PacketPtr(); // File could not be opened or reading was stopped.
+    }
     if (++mTwoInARow == 2)
     {
-        mPackets.resize(mMaxBufferSize);
+        mDemuxerStream->setMaxBufferSize(mMaxBufferSize);
+    }
+    PacketPtr packet = mDemuxerStream->pop();
+    if (!packet && mReadingPackets)
+    {
+        // End of file (as opposed to explicitly stopped reading).
+        mEOF = true;
     }
-    PacketPtr packet = mPackets.pop();
     return packet;
 }
 
@@ -579,6 +535,7 @@ pts File::getNumberOfFrames() const
 
 void File::openFile()
 {
+    boost::mutex::scoped_lock lock(mMutexFile);
     if (mFileOpened) return;
     mFileOpened = true;
     VAR_DEBUG(this);
@@ -599,29 +556,32 @@ void File::openFile()
         return;
     }
 
+    ASSERT(mOpenDecoders.empty())(mOpenDecoders);
+    mFileContext = FileContextCache::acquire(mPath, mOpenDecoders, mStreamIndex);
+    if (mFileContext == nullptr)
     {
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
-        result = avformat_open_input(&mFileContext, path, 0, 0);
-    }
+        result = FileInput::open(&mFileContext, mPath);
+
+        if (result != 0)
+        {
+            // Some error occured when opening the file.
+            VAR_WARNING(path)(result)(avcodecErrorString(result))(*this);
+            return;
+        }
 
-    if (result != 0)
-    {
-        // Some error occured when opening the file.
-        VAR_WARNING(path)(result)(avcodecErrorString(result))(*this);
-        return;
-    }
-    {
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
         result = avformat_find_stream_info(mFileContext,0);
         if (result < 0) // Some error occured when reading stream info. Close the file again.
         {
             VAR_DEBUG(path)(result)(avcodecErrorString(result))(*this);
-            avformat_close_input(&mFileContext); // Requires the lock also
+            FileInput::close(&mFileContext);
             ASSERT_ZERO(mFileContext);
             return;
         }
     }
 
+    int videoStream{ STREAMINDEX_UNDEFINED }; // Only set if the stream layout is determined below.
+    int audioStream{ STREAMINDEX_UNDEFINED };
+
     auto setNumberOfFrames = [this](pts nFrames)
     {
         if ((nFrames != AV_NOPTS_VALUE) &&
@@ -636,13 +596,17 @@ void File::openFile()
 
     auto isCodecSupported = [this, path](AVStream* stream) -> bool
     {
+        if (avcodec_is_open(stream->codec))
+        {
+            return true; // Decoder left open by a previous user of this (cached) context.
+        }
         AVCodec* codec = avcodec_find_decoder(stream->codec->codec_id);
         if (codec == nullptr)
         {
             LOG_WARNING << "Unsupported codec (could not find) '" << path << "'. Codec id " << stream->codec->codec_id << ".";
             return false;
         }
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
+        boost::mutex::scoped_lock lock(Avcodec::sMutex); // Only codec open/close requires the global lock
         int result = avcodec_open2(stream->codec, codec, 0);
         if (result != 0)
         {
@@ -684,8 +648,6 @@ void File::openFile()
 
     auto isVideoSupported = [this,path](AVStream* stream) -> bool
     {
-        // Note: Called very often when scanning through the entire file for determining the video length.
-        //       Therefore, do not add lengthy operations here.
         if (stream->codec->codec_type != AVMEDIA_TYPE_VIDEO)
         {
             return false;
@@ -715,6 +677,7 @@ void File::openFile()
         // Determine number of frames and correct stream index.
         // Not determined again if already known for performance (opening the codec)
         mNumberOfFrames = boost::none;
+        mNumberOfFramesEstimated = false;
         mStreamIndex = STREAMINDEX_UNDEFINED;
         mMaximumStartPts = 0;
         for (unsigned int i = 0; i < mFileContext->nb_streams; ++i)
@@ -727,10 +690,11 @@ void File::openFile()
                 isVideoSupported(stream))
             {
                 mHasVideo = true;
+                if (videoStream == STREAMINDEX_UNDEFINED) { videoStream = i; }
 
                 if (stream->duration != AV_NOPTS_VALUE)
                 {
-                    setNumberOfFrames(getFrameCount(stream, stream->duration));
+                    setNumberOfFrames(FileLength::getFrameCount(stream, stream->duration));
                 }
                 if (stream->nb_frames != AV_NOPTS_VALUE)
                 {
@@ -750,10 +714,11 @@ void File::openFile()
                 isAudioSupported(stream))
             {
                 mHasAudio = true;
+                if (audioStream == STREAMINDEX_UNDEFINED) { audioStream = i; }
                 // For files without video, determine the number of 'virtual video frames'.
                 if (stream->duration != AV_NOPTS_VALUE)
                 {
-                    setNumberOfFrames(getFrameCount(stream, stream->duration));
+                    setNumberOfFrames(FileLength::getFrameCount(stream, stream->duration));
                 }
                 if (stream->start_time != AV_NOPTS_VALUE &&
                     stream->start_time > mMaximumStartPts)
@@ -787,41 +752,42 @@ void File::openFile()
         mNumberOfFrames = FileMetaDataCache::get().getLength(getPath()); // Try to read from cache
         if (!mNumberOfFrames)
         {
-
-            // TRANSLATORS: %s == Name of file which is scanned completely to determine the file length.
-            gui::StatusBar::get().pushInfoText(wxString::Format(_("Scanning %s to determine media length."), mPath.GetFullName()));
-#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-            AVPacket pkt1 = { 0 };
-            AVPacket* packet = &pkt1;
-            std::vector<pts> streamPts(mFileContext->nb_streams, 0); // Note: no {, since that'll cause the wrong size
-            std::vector<pts> streamPackets(mFileContext->nb_streams, 0);
-            while (av_read_frame(mFileContext, packet) >= 0)
-            {
-                if (packet->pts != AV_NOPTS_VALUE) { streamPts[packet->stream_index] = std::max(streamPts[packet->stream_index], packet->pts); }
-                if (isVideoSupported(mFileContext->streams[packet->stream_index])) { streamPackets[packet->stream_index]++; }
-                av_packet_unref(packet);
-            }
-            gui::StatusBar::get().popInfoText();
-
-            // Reset position to beginning again. Otherwise, first playback (without 'moveTo' first) will cause errors.
-            avformat_seek_file(mFileContext, -1, std::numeric_limits<int64_t>::min(), 0, std::numeric_limits<int64_t>::max(), 0);
-
-            if (std::any_of(streamPts.begin(), streamPts.end(), [](pts value) { return value > 0; }))
+            // Reading all packets may take minutes (hours of MPEG-TS/VOB recordings). Use a provisional length
+            // for now. The exact length is determined in the background, and used upon the next opening of the file.
+            boost::optional<pts> nFrames{ FileLength::estimate(mFileContext, FileMetaDataCache::get().getIndex(getPath())) };
+            if (nFrames)
             {
-                // Try to extract length data by looking at the pts values in the packets.
-                std::vector<pts>::iterator it{ std::max_element(streamPts.begin(), streamPts.end()) };
-                int index{ narrow_cast<int>(std::distance(streamPts.begin(), it)) };
-                pts nFrames{ getFrameCount(mFileContext->streams[index], *it) };
-                setNumberOfFrames(nFrames);
-                VAR_WARNING(*this)(nFrames);
+                setNumberOfFrames(*nFrames);
+                mNumberOfFramesEstimated = true;
+                FileIndex::schedule(getPath(), true);
             }
             else
             {
-                // Fallback: use number of packets. May be too much, but then the user can still cut off the end of the clip.
-                pts nFrames{ *std::max_element(streamPackets.begin(), streamPackets.end()) };
-                setNumberOfFrames(nFrames);
-                VAR_WARNING(*this)(nFrames);
+                // No estimate possible (file can't be positioned on a byte offset and has no bit rate). Scan the entire file.
+                // TRANSLATORS: %s == Name of file which is scanned completely to determine the file length.
+                gui::StatusBar::get().pushInfoText(wxString::Format(_("Scanning %s to determine media length."), mPath.GetFullName()));
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+                AVPacket pkt1 = { 0 };
+                AVPacket* packet = &pkt1;
+                FileLength length(mFileContext);
+                while (av_read_frame(mFileContext, packet) >= 0)
+                {
+                    length.add(packet);
+                    av_packet_unref(packet);
+                }
+                gui::StatusBar::get().popInfoText();
+
+                // Reset position to beginning again. Otherwise, first playback (without 'moveTo' first) will cause errors.
+                avformat_seek_file(mFileContext, -1, std::numeric_limits<int64_t>::min(), 0, std::numeric_limits<int64_t>::max(), 0);
+
+                nFrames = length.get();
+                if (nFrames)
+                {
+                    setNumberOfFrames(*nFrames);
+                    FileMetaDataCache::get().setLength(getPath(), *mNumberOfFrames);
+                }
             }
+            VAR_WARNING(*this)(nFrames);
         }
     }
 
@@ -830,9 +796,9 @@ void File::openFile()
         (*mNumberOfFrames <= 0)) // <= 0: Some files have streams, but with all lengths == 0 (once happened when indexing by mistake ffprobe.exe)
     {
         LOG_WARNING << "No correct stream found " << '(' << (*this) << ')';
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
-        avformat_close_input(&mFileContext);
-        ASSERT_ZERO(mFileContext);
+        FileContextCache::close(mFileContext, mOpenDecoders);
+        mFileContext = nullptr;
+        mOpenDecoders.clear();
         mNumberOfFrames = boost::none;
         return;
     }
@@ -846,6 +812,58 @@ void File::openFile()
     }
     VAR_DEBUG(mFileContext)(mStreamIndex)(mNumberOfFrames);
     mFileOpenedOk = true;
+
+    if (videoStream != STREAMINDEX_UNDEFINED || audioStream != STREAMINDEX_UNDEFINED)
+    {
+        // Store the results of probing the file, for subsequent uses (also in other projects).
+        FileProperties properties;
+        properties.VideoStream = videoStream;
+        properties.AudioStream = audioStream;
+        properties.MaximumStartPts = mMaximumStartPts;
+        if (videoStream != STREAMINDEX_UNDEFINED)
+        {
+            AVStream* stream{ mFileContext->streams[videoStream] };
+            AVRational rate{ av_stream_get_r_frame_rate(stream) };
+            properties.FrameRateNum = rate.num;
+            properties.FrameRateDen = rate.den;
+            properties.Width = stream->codec->width;
+            properties.Height = stream->codec->height;
+        }
+        if (audioStream != STREAMINDEX_UNDEFINED)
+        {
+            AVStream* stream{ mFileContext->streams[audioStream] };
+            properties.SampleRate = stream->codec->sample_rate;
+            properties.Channels = stream->codec->channels;
+        }
+        FileMetaDataStore::setProperties(mPath, properties);
+        if (!mNumberOfFramesEstimated)
+        {
+            FileMetaDataStore::setLength(mPath, *mNumberOfFrames);
+        }
+    }
+
+    // NOT: FileIndex::schedule(getPath()); -- The index is only made (or built, which
+    //      requires reading the entire file) once the file is read. See Demuxer::open.
+}
+
+bool File::readMetaDataFromStore()
+{
+    if (getType() == FileType_Title) { return false; } // Opening images is cheap.
+    bool trusted{ FileValidator::isPending(mPath) }; // Directly after opening a project, the file is not accessed until it has been validated.
+    boost::optional<FileProperties> properties{ FileMetaDataStore::getProperties(mPath, trusted) };
+    if (!properties) { return false; }
+    boost::optional<pts> length{ FileMetaDataStore::getLength(mPath, trusted) };
+    if (!length) { return false; }
+
+    boost::mutex::scoped_lock lock(mMutexFile);
+    mNumberOfFrames = length;
+    mHasVideo = properties->VideoStream != STREAMINDEX_UNDEFINED;
+    mHasAudio = properties->AudioStream != STREAMINDEX_UNDEFINED;
+    mMaximumStartPts = properties->MaximumStartPts;
+    mMetaDataKnown = true;
+    mFileOpenedOk = true; // The file is opened (and the stream layout is determined again) upon first use.
+    VAR_DEBUG(this)(mNumberOfFrames);
+    return true;
 }
 
 void File::closeFile()
@@ -854,58 +872,43 @@ void File::closeFile()
     if (!mFileOpened) { return; }
     if (!canBeOpened()) { return; }
 
-    boost::mutex::scoped_lock lock(Avcodec::sMutex);
-    avformat_close_input(&mFileContext);
-    ASSERT_ZERO(mFileContext);
+    boost::mutex::scoped_lock lock(mMutexFile);
+    FileContextCache::release(mPath, mFileContext, mOpenDecoders);
+    mFileContext = nullptr;
+    mOpenDecoders.clear();
     mFileOpened = false;
 }
 
-//////////////////////////////////////////////////////////////////////////
-// THREADS
-//////////////////////////////////////////////////////////////////////////
-
-void File::bufferPacketsThread()
+int File::takeOpenDecoder()
 {
-    util::thread::setCurrentThreadName("BufferPackets");
-    VAR_DEBUG(this);
-
-    AVPacket pkt1 = { 0 };
-    AVPacket* packet = &pkt1;
-
-    while (mReadingPackets)
+    int result{ 0 };
+    std::map<int, int>::iterator it{ mOpenDecoders.find(mStreamIndex) };
+    if (it != mOpenDecoders.end())
     {
-        if (av_read_frame(mFileContext, packet) < 0)
+        if (Avcodec::reclaimDecodingThreads(it->second))
         {
-            LOG_DEBUG << "End of file.";
-            mEOF = true;
-            mPackets.push(PacketPtr());
-            break;
+            result = it->second;
         }
-        ASSERT_MORE_THAN_EQUALS_ZERO(packet->size);
-
-        if (packet->stream_index == mStreamIndex)
+        else
         {
-            PacketPtr p = boost::make_shared<Packet>(packet);
-            mPackets.push(p);
+            // The decoder has more threads than currently fit in the budget.
+            boost::mutex::scoped_lock lock(Avcodec::sMutex);
+            avcodec_close(getCodec());
         }
-        av_packet_unref(packet);
+        mOpenDecoders.erase(it);
     }
-    if (!mReadingPackets)
-    {
-        // Reading packets was explicitly stopped (as opposed to reading until end of file).
-        // Now we clear the packets fifo completely, then insert one empty packet.
-
-        // One new packet may be added when a pending push was unblocked by the flush
-        // in 'stopReadingPackets()'.
-        mPackets.flush();
-
-        // Insert one packet to signal the end of the packet stream. This unblocks
-        // any pending 'getNextPacket()' by returning a '0' packet.
-        mPackets.push(PacketPtr());
-    }
-    mReadingPackets = false; // Needed for any breaks above (implicit stop at end of file)
+    return result;
+}
 
-    VAR_DEBUG(this);
+void File::leaveDecoderOpen(int nThreads)
+{
+    ASSERT_MORE_THAN_ZERO(nThreads);
+    ASSERT_NONZERO(mFileContext);
+    ASSERT(avcodec_is_open(getCodec()));
+    // The decoder's (idle) threads no longer count for the budget. Otherwise,
+    // parked decoders would limit the threads of the decoders that are in use.
+    Avcodec::releaseDecodingThreads(nThreads);
+    mOpenDecoders[mStreamIndex] = nThreads;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -928,6 +931,7 @@ std::ostream& operator<<(std::ostream& os, const File& obj)
         << obj.mStreamIndex << '|'
         << obj.mMaxBufferSize << '|'
         << obj.mTwoInARow << '|'
+        << obj.mSeekTimestamp << '|'
         << obj.mFileContext;
     return os;
 }
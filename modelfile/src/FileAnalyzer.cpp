@@ -19,17 +19,23 @@
 
 #include "AudioFile.h"
 #include "Config.h"
+#include "FileMetaDataStore.h"
 #include "INode.h"
 #include "Project.h"
 #include "ProjectModification.h"
 #include "ProjectViewAddAsset.h"
 #include "ProjectView.h"
 #include "StatusBar.h"
+#include "UtilThread.h"
 #include "UtilWindow.h"
 #include "VideoFile.h"
 
 namespace model {
 
+/// Interval between updates of the progress dialog, when waiting for the
+/// probing threads.
+static const int sFileAnalyzerProgressInterval{ 100 };
+
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
 //////////////////////////////////////////////////////////////////////////
@@ -94,14 +100,31 @@ void FileAnalyzer::init()
             }
             else
 			{
-				FilePtr file = indexFile(filename);
-				if (file)
-				{
-					mNodes.emplace_back(file);
-				}
+				mNodes.emplace_back(nullptr); // Replaced with the file after probing (if the file can be opened).
+				Probe probe;
+				probe.Path = filename;
+				probe.Node.reset(mNodes.size() - 1);
+				mProbes.emplace_back(probe);
+			}
+		}
+	}
+
+	probeFiles();
+
+	// Merge the results in the order of the files, for a deterministic outcome.
+	for (const Probe& probe : mProbes)
+	{
+		if (probe.File)
+		{
+			addToStatistics(probe);
+			if (probe.Node)
+			{
+				mNodes[*probe.Node] = probe.File;
 			}
 		}
 	}
+	mNodes.erase(std::remove(mNodes.begin(), mNodes.end(), NodePtr()), mNodes.end());
+	mProbes.clear(); // Release files that are not part of mNodes.
 
 	if (mMostFrequentFrameRate == FrameRate(250000, 10427))
 	{
@@ -245,7 +268,9 @@ void FileAnalyzer::indexFolder(const wxFileName& dirName, bool recurse)
 
     for (const wxFileName& file : files)
     {
-        indexFile(file);
+        Probe probe;
+        probe.Path = file;
+        mProbes.emplace_back(probe);
     }
     if (recurse)
     {
@@ -256,52 +281,86 @@ void FileAnalyzer::indexFolder(const wxFileName& dirName, bool recurse)
     }
 }
 
-FilePtr FileAnalyzer::indexFile(const wxFileName& fileName)
+void FileAnalyzer::probeFiles()
 {
-    FilePtr file = boost::make_shared<File>(fileName);
+    VAR_INFO(mProbes.size());
+    util::thread::runParallel(mProbes.size(), "FileAnalyzer",
+        [this](size_t index) { probeFile(mProbes[index]); return true; },
+        [this] { updateProgressDialog(); }, // Keep the progress dialog going while waiting.
+        sFileAnalyzerProgressInterval);
+}
 
-    if (file->canBeOpened())
+void FileAnalyzer::probeFile(Probe& probe)
+{
+    FilePtr file = boost::make_shared<File>(probe.Path);
+    if (!file->canBeOpened())
+    {
+        return;
+    }
+    mNumberOfMediaFiles++;
+    if (file->getType() == FileType_Title)
+    {
+        // No frame/sample rate analysis required.
+    }
+    else if (boost::optional<FileProperties> properties = FileMetaDataStore::getProperties(probe.Path))
     {
-        mNumberOfMediaFiles++;
-        updateProgressDialog();
-        if (file->getType() == FileType_Title)
+        // Known file: no need to open the file.
+        if (file->hasVideo())
         {
-            // No frame/sample rate analysis required.
+            probe.VideoFrameRate.reset(FrameRate(properties->FrameRateNum, properties->FrameRateDen));
+            probe.VideoSize.reset(wxSize(properties->Width, properties->Height));
         }
-        else
+        if (file->hasAudio())
         {
-            if (file->hasVideo())
-            {
-                VideoFilePtr videofile = boost::make_shared<VideoFile>(fileName);
-                mFrameRateOccurrence[videofile->getFrameRate()] = mFrameRateOccurrence[videofile->getFrameRate()] + 1;
-                if (mFrameRateOccurrence[videofile->getFrameRate()] > mFrameRateOccurrence[mMostFrequentFrameRate])
-                {
-                    mMostFrequentFrameRate = videofile->getFrameRate();
-                }
-                wxSize size = videofile->getSize();
-                mVideoSizeOccurrence[size] = mVideoSizeOccurrence[size] + 1;
-                if (mVideoSizeOccurrence[size] > mVideoSizeOccurrence[mMostFrequentVideoSize])
-                {
-                    mMostFrequentVideoSize = size;
-                }
-            }
-            if (file->hasAudio())
-            {
-                AudioFilePtr audiofile = boost::make_shared<AudioFile>(fileName);
-                std::pair<int, int> fileAudioRate = std::make_pair(audiofile->getSampleRate(), audiofile->getChannels());
-                mAudioRateOccurrence[fileAudioRate]++;
-                if (mAudioRateOccurrence[fileAudioRate] > mAudioRateOccurrence[mMostFrequentAudioRate])
-                {
-                    mMostFrequentAudioRate = fileAudioRate;
-                }
-            }
+            probe.AudioRate.reset(std::make_pair(properties->SampleRate, properties->Channels));
         }
     }
     else
     {
-        file.reset();
+        if (file->hasVideo())
+        {
+            VideoFilePtr videofile = boost::make_shared<VideoFile>(probe.Path);
+            probe.VideoFrameRate.reset(videofile->getFrameRate());
+            probe.VideoSize.reset(videofile->getSize());
+        }
+        if (file->hasAudio())
+        {
+            AudioFilePtr audiofile = boost::make_shared<AudioFile>(probe.Path);
+            probe.AudioRate.reset(std::make_pair(audiofile->getSampleRate(), audiofile->getChannels()));
+        }
+    }
+    probe.File = file;
+}
+
+void FileAnalyzer::addToStatistics(const Probe& probe)
+{
+    if (probe.VideoFrameRate)
+    {
+        FrameRate frameRate{ *probe.VideoFrameRate };
+        mFrameRateOccurrence[frameRate] = mFrameRateOccurrence[frameRate] + 1;
+        if (mFrameRateOccurrence[frameRate] > mFrameRateOccurrence[mMostFrequentFrameRate])
+        {
+            mMostFrequentFrameRate = frameRate;
+        }
+    }
+    if (probe.VideoSize)
+    {
+        wxSize size{ *probe.VideoSize };
+        mVideoSizeOccurrence[size] = mVideoSizeOccurrence[size] + 1;
+        if (mVideoSizeOccurrence[size] > mVideoSizeOccurrence[mMostFrequentVideoSize])
+        {
+            mMostFrequentVideoSize = size;
+        }
+    }
+    if (probe.AudioRate)
+    {
+        std::pair<int, int> fileAudioRate{ *probe.AudioRate };
+        mAudioRateOccurrence[fileAudioRate]++;
+        if (mAudioRateOccurrence[fileAudioRate] > mAudioRateOccurrence[mMostFrequentAudioRate])
+        {
+            mMostFrequentAudioRate = fileAudioRate;
+        }
     }
-    return file;
 }
 
 void FileAnalyzer::updateProgressDialog()
@@ -309,7 +368,7 @@ void FileAnalyzer::updateProgressDialog()
     if (mDialog)
     {
         wxString progress;
-        progress << wxString::Format(_("Found %d file(s)"), mNumberOfMediaFiles);
+        progress << wxString::Format(_("Found %d file(s)"), mNumberOfMediaFiles.load());
         mDialog->Pulse(progress);
     }
 }
@@ -0,0 +1,190 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileContextCache.h"
+
+#include "FileInput.h"
+#include "UtilInitAvcodec.h"
+
+namespace model {
+
+/// Maximum (estimated) memory used by the cached contexts.
+static const size_t sFileContextCacheBudget{ 256 * 1024 * 1024 };
+
+/// Maximum number of cached contexts, regardless of their size.
+static const size_t sFileContextCacheMaximumEntries{ 32 };
+
+/// Estimated memory usage of a format context (probe data, stream info, I/O buffer).
+static const size_t sFileContextCacheContextSize{ 1024 * 1024 };
+
+/// Estimated number of frames held by an (idle) decoder, in addition to one frame per thread.
+static const size_t sFileContextCacheFramesPerDecoder{ 4 };
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FileContextCache::FileContextCache()
+{
+    VAR_DEBUG(this);
+}
+
+FileContextCache::~FileContextCache()
+{
+    VAR_DEBUG(*this);
+    std::list<Entry> entries;
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        entries.swap(mEntries);
+        mSize = 0;
+    }
+    for (Entry& entry : entries)
+    {
+        close(entry.Context, entry.Decoders);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE
+//////////////////////////////////////////////////////////////////////////
+
+// static
+AVFormatContext* FileContextCache::acquire(const wxFileName& path, OpenDecoders& decoders, int decoderStream)
+{
+    decoders.clear();
+    if (!exists()) { return nullptr; }
+
+    FileContextCache& cache{ get() };
+    wxString key{ path.GetLongPath() };
+    boost::mutex::scoped_lock lock(cache.mMutex);
+
+    auto selected = cache.mEntries.end();
+    for (auto it = cache.mEntries.begin(); it != cache.mEntries.end(); ++it)
+    {
+        if (it->Path != key) { continue; }
+        bool hasDecoder{ it->Decoders.find(decoderStream) != it->Decoders.end() };
+        if (decoderStream >= 0 ? hasDecoder : it->Decoders.empty())
+        {
+            selected = it; // Best match.
+        }
+        else if (selected == cache.mEntries.end())
+        {
+            selected = it;
+        }
+    }
+    if (selected == cache.mEntries.end())
+    {
+        return nullptr;
+    }
+
+    AVFormatContext* result{ selected->Context };
+    decoders = selected->Decoders;
+    cache.mSize -= selected->Size;
+    cache.mEntries.erase(selected);
+    VAR_DEBUG(key)(result)(decoders.size());
+    return result;
+}
+
+// static
+void FileContextCache::release(const wxFileName& path, AVFormatContext* context, const OpenDecoders& decoders)
+{
+    if (context == nullptr) { return; }
+    if (!exists())
+    {
+        close(context, decoders);
+        return;
+    }
+
+    FileContextCache& cache{ get() };
+    std::list<Entry> evicted;
+    {
+        boost::mutex::scoped_lock lock(cache.mMutex);
+        Entry entry;
+        entry.Path = path.GetLongPath();
+        entry.Context = context;
+        entry.Decoders = decoders;
+        entry.Size = estimateSize(context, decoders);
+        cache.mEntries.emplace_back(entry);
+        cache.mSize += entry.Size;
+
+        while (!cache.mEntries.empty() &&
+            (cache.mSize > sFileContextCacheBudget || cache.mEntries.size() > sFileContextCacheMaximumEntries))
+        {
+            cache.mSize -= cache.mEntries.front().Size;
+            evicted.splice(evicted.end(), cache.mEntries, cache.mEntries.begin());
+        }
+    }
+    // Close outside the lock, since closing decoders (joining their threads) takes time.
+    for (Entry& entry : evicted)
+    {
+        VAR_DEBUG(entry.Path)(entry.Size);
+        close(entry.Context, entry.Decoders);
+    }
+}
+
+// static
+void FileContextCache::close(AVFormatContext* context, const OpenDecoders& decoders)
+{
+    if (context == nullptr) { return; }
+    for (auto kvp : decoders)
+    {
+        ASSERT_LESS_THAN(kvp.first, static_cast<int>(context->nb_streams));
+        AVCodecContext* codec{ context->streams[kvp.first]->codec };
+        if (avcodec_is_open(codec))
+        {
+            boost::mutex::scoped_lock lock(Avcodec::sMutex);
+            avcodec_close(codec);
+        }
+        // NOT: Avcodec::releaseDecodingThreads(kvp.second); -- Done when the decoder was left open.
+    }
+    FileInput::close(&context);
+    ASSERT_ZERO(context);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+size_t FileContextCache::estimateSize(AVFormatContext* context, const OpenDecoders& decoders)
+{
+    size_t result{ sFileContextCacheContextSize };
+    for (auto kvp : decoders)
+    {
+        AVCodecContext* codec{ context->streams[kvp.first]->codec };
+        if (codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            size_t frame{ static_cast<size_t>(codec->width) * static_cast<size_t>(codec->height) * 3 / 2 }; // Typical: YUV 4:2:0
+            result += frame * (sFileContextCacheFramesPerDecoder + static_cast<size_t>(kvp.second));
+        }
+    }
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FileContextCache& obj)
+{
+    os  << &obj << '|'
+        << obj.mEntries.size() << '|'
+        << obj.mSize;
+    return os;
+}
+
+} // namespace
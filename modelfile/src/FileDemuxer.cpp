@@ -0,0 +1,577 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileDemuxer.h"
+
+#include "FileDemuxerPool.h"
+#include "FileIndex.h"
+#include "FileInput.h"
+
+namespace model {
+
+/// Maximum difference between the start positions of two consumers that share
+/// one demuxer. The demuxer seeks to a position this much before the requested
+/// position, which ensures that all consumers get the data they require.
+/// Any superfluous data is discarded by the decoding (VideoFile/AudioFile).
+static const int64_t sDemuxerJoinTolerance{ AV_TIME_BASE / 10 };
+
+/// Maximum number of packets retained for a stream without any consumer.
+static const size_t sDemuxerMaxRetainedPackets{ 200 };
+
+/// Hard limit for the number of packets buffered for a consumer, as a multiple
+/// of its buffer size (but never below sDemuxerMaxRetainedPackets). Reading is
+/// suspended once a consumer lags this much behind the other consumers of the
+/// same demuxer.
+static const size_t sDemuxerQueueLimitFactor{ 4 };
+
+/// Maximum number of packets read in one go by readPackets(). After that,
+/// the pool thread may service another (more urgent) demuxer.
+static const int sDemuxerBatchSize{ 16 };
+
+static boost::mutex sDemuxersMutex;
+static std::multimap<wxString, boost::weak_ptr<Demuxer>> sDemuxers;
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+Demuxer::Demuxer(const wxFileName& path, int64_t timestamp)
+    : mPath{ path }
+    , mTimestamp{ timestamp }
+{
+    VAR_DEBUG(this)(mPath)(mTimestamp);
+}
+
+Demuxer::~Demuxer()
+{
+    VAR_DEBUG(this);
+    // NOT: stop any reading. The pool holds a reference whilst reading.
+    FileContextCache::release(mPath, mContext, mDecoders);
+    mContext = nullptr;
+}
+
+// static
+DemuxerStreamPtr Demuxer::subscribe(const wxFileName& path, int streamIndex, int64_t timestamp, size_t maxBufferSize)
+{
+    DemuxerPtr demuxer{ nullptr };
+    wxString key{ path.GetLongPath() };
+    {
+        boost::mutex::scoped_lock lock(sDemuxersMutex);
+        auto range = sDemuxers.equal_range(key);
+        for (auto it = range.first; it != range.second; )
+        {
+            DemuxerPtr existing{ it->second.lock() };
+            if (!existing)
+            {
+                it = sDemuxers.erase(it);
+                continue;
+            }
+            if (existing->canJoin(streamIndex, timestamp))
+            {
+                demuxer = existing;
+                demuxer->join(streamIndex, maxBufferSize);
+                VAR_DEBUG(*demuxer)(streamIndex)(timestamp);
+                break;
+            }
+            ++it;
+        }
+        if (!demuxer)
+        {
+            demuxer = boost::make_shared<Demuxer>(path, timestamp);
+            demuxer->join(streamIndex, maxBufferSize);
+            sDemuxers.insert(std::make_pair(key, boost::weak_ptr<Demuxer>(demuxer)));
+            // Schedule reading here (instead of in the constructor) so that
+            // the demuxer is registered before any packets are read.
+            DemuxerPool::get().add(demuxer);
+        }
+    }
+    return boost::make_shared<DemuxerStream>(demuxer, streamIndex);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE FOR DEMUXERSTREAM
+//////////////////////////////////////////////////////////////////////////
+
+PacketPtr Demuxer::pop(int streamIndex)
+{
+    PacketPtr result{ nullptr };
+    bool full{ false };
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        ASSERT_MAP_CONTAINS(mQueues, streamIndex);
+        StreamQueue& queue{ mQueues[streamIndex] };
+        if (queue.Packets.empty() && !queue.Aborted && !mEOF)
+        {
+            // Consumer is starving: make this demuxer the most urgent one.
+            queue.Waiting = true;
+            lock.unlock();
+            notifyPool();
+            lock.lock();
+            while (queue.Packets.empty() && !queue.Aborted && !mEOF)
+            {
+                mConditionPacketAvailable.wait(lock);
+            }
+            queue.Waiting = false;
+        }
+        if (queue.Aborted || queue.Packets.empty())
+        {
+            return nullptr;
+        }
+        full = queue.Packets.size() >= queue.MaxBufferSize;
+        result = queue.Packets.front();
+        queue.Packets.pop_front();
+    }
+    if (full)
+    {
+        notifyPool();
+    }
+    return result;
+}
+
+void Demuxer::abort(int streamIndex)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        ASSERT_MAP_CONTAINS(mQueues, streamIndex);
+        mQueues[streamIndex].Aborted = true;
+    }
+    mConditionPacketAvailable.notify_all();
+}
+
+void Demuxer::setMaxBufferSize(int streamIndex, size_t maxBufferSize)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        ASSERT_MAP_CONTAINS(mQueues, streamIndex);
+        mQueues[streamIndex].MaxBufferSize = maxBufferSize;
+    }
+    notifyPool();
+}
+
+void Demuxer::unsubscribe(int streamIndex)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        ASSERT_MAP_CONTAINS(mQueues, streamIndex);
+        StreamQueue& queue{ mQueues[streamIndex] };
+        queue.Packets.clear();
+        queue.Subscribed = false;
+        queue.Joinable = false;
+    }
+    notifyPool();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE FOR DEMUXERPOOL
+//////////////////////////////////////////////////////////////////////////
+
+boost::optional<int64_t> Demuxer::getDeadline()
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    if (mEOF)
+    {
+        return boost::none;
+    }
+    if (!mStreamsKnown)
+    {
+        return -1; // Not opened yet. Consumers will be waiting for the first packets soon.
+    }
+    if (!packetRequired())
+    {
+        return boost::none;
+    }
+    boost::optional<int64_t> result{ boost::none };
+    for (auto& kvp : mQueues)
+    {
+        StreamQueue& queue{ kvp.second };
+        if (!queue.Subscribed || queue.Aborted || queue.Packets.size() >= queue.MaxBufferSize)
+        {
+            continue;
+        }
+        int64_t buffered{ 0 };
+        if (queue.Waiting)
+        {
+            buffered = -1;
+        }
+        else if (queue.Packets.size() >= 2)
+        {
+            int64_t first{ queue.Packets.front()->getPacket()->dts };
+            int64_t last{ queue.Packets.back()->getPacket()->dts };
+            if (first != AV_NOPTS_VALUE && last != AV_NOPTS_VALUE && last > first)
+            {
+                buffered = av_rescale_q(last - first, queue.TimeBase, AVRational{ 1, AV_TIME_BASE });
+            }
+        }
+        if (!result || buffered < *result)
+        {
+            result.reset(buffered);
+        }
+    }
+    return result;
+}
+
+bool Demuxer::readPackets()
+{
+    if (!mStreamsKnown) // Only changed by the (one) pool thread servicing this demuxer.
+    {
+        VAR_DEBUG(this);
+        bool opened{ open() };
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (!opened)
+            {
+                mEOF = true;
+            }
+            else
+            {
+                // From this point onwards, streams not in the list can no longer be joined.
+                for (unsigned int i = 0; i < mContext->nb_streams; ++i)
+                {
+                    if (mContext->streams[i]->discard != AVDISCARD_ALL)
+                    {
+                        mQueues[i]; // Default: joinable, not subscribed.
+                    }
+                }
+                for (auto& kvp : mQueues)
+                {
+                    if (kvp.first >= 0 && kvp.first < static_cast<int>(mContext->nb_streams))
+                    {
+                        kvp.second.TimeBase = mContext->streams[kvp.first]->time_base;
+                    }
+                }
+            }
+            mStreamsKnown = true;
+        }
+        mConditionPacketAvailable.notify_all();
+        if (!opened) { return false; }
+    }
+
+    AVPacket pkt1 = { 0 };
+    AVPacket* packet = &pkt1;
+
+    for (int i = 0; i < sDemuxerBatchSize; ++i)
+    {
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (!packetRequired())
+            {
+                break;
+            }
+        }
+
+        if (av_read_frame(mContext, packet) < 0)
+        {
+            LOG_DEBUG << "End of file.";
+            {
+                boost::mutex::scoped_lock lock(mMutex);
+                mEOF = true;
+            }
+            mConditionPacketAvailable.notify_all();
+            return false;
+        }
+        ASSERT_MORE_THAN_EQUALS_ZERO(packet->size);
+        restoreTimestamps(packet);
+
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            auto it = mQueues.find(packet->stream_index);
+            if (it != mQueues.end() && (it->second.Subscribed || it->second.Joinable))
+            {
+                StreamQueue& queue{ it->second };
+                queue.Packets.emplace_back(Packet::take(packet));
+                if (!queue.Subscribed && queue.Packets.size() > sDemuxerMaxRetainedPackets)
+                {
+                    // No consumer showed up in time.
+                    queue.Packets.clear();
+                    queue.Joinable = false;
+                    mContext->streams[packet->stream_index]->discard = AVDISCARD_ALL;
+                }
+            }
+        }
+        mConditionPacketAvailable.notify_all();
+        av_packet_unref(packet); // Does nothing if the packet was taken.
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+bool Demuxer::canJoin(int streamIndex, int64_t timestamp)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    if (std::abs(timestamp - mTimestamp) > sDemuxerJoinTolerance)
+    {
+        return false;
+    }
+    auto it = mQueues.find(streamIndex);
+    if (it == mQueues.end())
+    {
+        // No packets have been discarded for this stream yet, unless
+        // the demuxer has already started reading and this stream is
+        // not in the list of retained streams.
+        return !mStreamsKnown;
+    }
+    return !it->second.Subscribed && it->second.Joinable;
+}
+
+void Demuxer::join(int streamIndex, size_t maxBufferSize)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        StreamQueue& queue{ mQueues[streamIndex] };
+        ASSERT(!queue.Subscribed)(streamIndex);
+        ASSERT(queue.Joinable)(streamIndex);
+        queue.Subscribed = true;
+        queue.Aborted = false;
+        queue.MaxBufferSize = maxBufferSize;
+    }
+    notifyPool();
+}
+
+bool Demuxer::packetRequired() const
+{
+    // NOT: boost::mutex::scoped_lock lock(mMutex); -- Lock taken in calling method.
+    // Only stop reading if none of the consumers require data. Otherwise, one
+    // consumer with a full buffer (for instance, video) could block another
+    // consumer with an empty buffer (for instance, audio). However, the full
+    // buffer may not grow without bound: once it reaches its hard limit, reading
+    // waits until that (lagging) consumer has taken some packets.
+    bool result{ false };
+    for (const auto& kvp : mQueues)
+    {
+        const StreamQueue& queue{ kvp.second };
+        if (!queue.Subscribed || queue.Aborted)
+        {
+            continue;
+        }
+        if (queue.Packets.size() >= std::max(queue.MaxBufferSize * sDemuxerQueueLimitFactor, sDemuxerMaxRetainedPackets))
+        {
+            return false;
+        }
+        if (queue.Packets.size() < queue.MaxBufferSize)
+        {
+            result = true;
+        }
+    }
+    return result;
+}
+
+bool Demuxer::open()
+{
+    if (mTimestamp > 0)
+    {
+        // Do not open and probe the file again, but reposition a context that
+        // was opened before. When starting at the beginning, the file is always
+        // opened anew (no seeking at all). See File::moveTo.
+        mContext = FileContextCache::acquire(mPath, mDecoders);
+    }
+    if (mContext == nullptr && !openContext())
+    {
+        return false;
+    }
+
+    // Only audio and video packets are routed to consumers. Note that a reused
+    // context may still contain the discard settings of its previous user.
+    for (unsigned int i = 0; i < mContext->nb_streams; ++i)
+    {
+        AVMediaType type{ mContext->streams[i]->codec->codec_type };
+        mContext->streams[i]->discard = (type == AVMEDIA_TYPE_AUDIO || type == AVMEDIA_TYPE_VIDEO) ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+
+    // Seeking in video files benefits from an exact keyframe index,
+    // seeking in (variable bit rate) audio files from an exact packet index.
+    FileIndexPtr index{ FileIndex::require(mPath, mContext) };
+
+    // Do not seek if == 0, may mess up some files. See File::moveTo.
+    int64_t timestamp{ mTimestamp - sDemuxerJoinTolerance };
+    if (mTimestamp > 0 && timestamp > 0)
+    {
+        // Preferably, use the index for seeking exactly to the keyframe at or before the given position.
+        int seekStream{ index ? getSeekStream(*index) : -1 };
+        if (seekStream >= 0)
+        {
+            boost::optional<int64_t> pts{ index->seek(mContext, seekStream, timestamp) };
+            if (pts)
+            {
+                mRestoreStream = seekStream;
+                mRestorePts = *pts;
+                return true;
+            }
+        }
+
+        // First, try seeking to a keyframe at the given position.
+        int result{ avformat_seek_file(mContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), 0) };
+        if (result < 0)
+        {
+            // Second, try seeking to a keyframe before the given position.
+            result = avformat_seek_file(mContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), AVSEEK_FLAG_BACKWARD);
+            if (result < 0)
+            {
+                // Last resort, any frame will do.
+                result = avformat_seek_file(mContext, -1, std::numeric_limits<int64_t>::min(), timestamp, std::numeric_limits<int64_t>::max(), AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY);
+            }
+        }
+        if (result < 0)
+        {
+            VAR_WARNING(mTimestamp)(avcodecErrorString(result))(*this);
+            // Some files can be read (only) when starting at the beginning. Reopen the
+            // file to ensure reading starts at the beginning. Then the 'skip frames'
+            // and 'skip samples' algorithms in VideoFile/AudioFile will cause the
+            // initial (unwanted) data to be discarded.
+            closeContext();
+            return openContext();
+        }
+    }
+    return true;
+}
+
+bool Demuxer::openContext()
+{
+    wxString path{ mPath.GetLongPath() };
+    int result{ FileInput::open(&mContext, mPath, true) };
+    if (result != 0)
+    {
+        VAR_WARNING(path)(result)(avcodecErrorString(result));
+        mContext = nullptr;
+        return false;
+    }
+    // Required for having the same streams (indices) as the consumers (File).
+    result = avformat_find_stream_info(mContext, 0);
+    if (result < 0)
+    {
+        VAR_WARNING(path)(result)(avcodecErrorString(result));
+        FileInput::close(&mContext);
+        return false;
+    }
+    return true;
+}
+
+void Demuxer::closeContext()
+{
+    FileContextCache::close(mContext, mDecoders);
+    mContext = nullptr;
+    mDecoders.clear();
+}
+
+int Demuxer::getSeekStream(const FileIndex& index)
+{
+    std::vector<int> audio;
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        for (auto kvp : mQueues)
+        {
+            if (kvp.first < 0 || kvp.first >= static_cast<int>(mContext->nb_streams)) { continue; }
+            if (mContext->streams[kvp.first]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            {
+                audio.push_back(kvp.first);
+            }
+        }
+    }
+    // Video streams are positioned on a keyframe. Also when the video is not read
+    // (yet) by this demuxer, since another consumer (the VideoFile of the same clip)
+    // may join later on.
+    for (unsigned int i = 0; i < mContext->nb_streams; ++i)
+    {
+        if (mContext->streams[i]->discard != AVDISCARD_ALL &&
+            mContext->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            return index.hasStream(i) ? static_cast<int>(i) : -1;
+        }
+    }
+    for (int stream : audio)
+    {
+        if (index.hasStream(stream))
+        {
+            return stream;
+        }
+    }
+    return -1;
+}
+
+void Demuxer::restoreTimestamps(AVPacket* packet)
+{
+    if (packet->stream_index != mRestoreStream) { return; }
+    if (packet->pts != AV_NOPTS_VALUE || packet->duration <= 0)
+    {
+        // Timestamps are known again (or can not be derived anymore).
+        mRestoreStream = -1;
+        return;
+    }
+    packet->pts = mRestorePts;
+    if (packet->dts == AV_NOPTS_VALUE)
+    {
+        packet->dts = mRestorePts;
+    }
+    mRestorePts += packet->duration;
+}
+
+void Demuxer::notifyPool()
+{
+    if (DemuxerPool::exists())
+    {
+        DemuxerPool::get().notify();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const Demuxer& obj)
+{
+    os  << &obj << '|'
+        << obj.mPath << '|'
+        << obj.mTimestamp << '|'
+        << obj.mEOF << '|'
+        << obj.mQueues.size();
+    return os;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// DEMUXERSTREAM
+//////////////////////////////////////////////////////////////////////////
+
+DemuxerStream::DemuxerStream(DemuxerPtr demuxer, int streamIndex)
+    : mDemuxer{ demuxer }
+    , mStreamIndex{ streamIndex }
+{
+    ASSERT_NONZERO(mDemuxer);
+}
+
+DemuxerStream::~DemuxerStream()
+{
+    mDemuxer->unsubscribe(mStreamIndex);
+}
+
+PacketPtr DemuxerStream::pop()
+{
+    return mDemuxer->pop(mStreamIndex);
+}
+
+void DemuxerStream::abort()
+{
+    mDemuxer->abort(mStreamIndex);
+}
+
+void DemuxerStream::setMaxBufferSize(size_t maxBufferSize)
+{
+    mDemuxer->setMaxBufferSize(mStreamIndex, maxBufferSize);
+}
+
+} // namespace
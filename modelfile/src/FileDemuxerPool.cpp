@@ -0,0 +1,195 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileDemuxerPool.h"
+
+#include "FileDemuxer.h"
+#include "UtilThread.h"
+
+namespace model {
+
+/// Reading packets is I/O bound. A few threads suffice for keeping all
+/// consumers fed, and more threads only cause more disk seeking.
+static const unsigned int sDemuxerPoolMinimumThreads{ 2 };
+static const unsigned int sDemuxerPoolMaximumThreads{ 4 };
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+DemuxerPool::DemuxerPool()
+{
+    unsigned int nThreads{ std::min(sDemuxerPoolMaximumThreads, std::max(sDemuxerPoolMinimumThreads, boost::thread::hardware_concurrency() / 2)) };
+    VAR_INFO(nThreads);
+    for (unsigned int i = 0; i < nThreads; ++i)
+    {
+        mThreads.create_thread(std::bind(&DemuxerPool::thread, this));
+    }
+}
+
+DemuxerPool::~DemuxerPool()
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    mThreads.join_all();
+    mEntries.clear();
+    mTasks.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE FOR DEMUXER
+//////////////////////////////////////////////////////////////////////////
+
+void DemuxerPool::add(const DemuxerPtr& demuxer)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        Entry entry;
+        entry.Reader = demuxer;
+        mEntries.emplace_back(entry);
+        ++mChanges;
+    }
+    mCondition.notify_all();
+}
+
+void DemuxerPool::notify()
+{
+    {
+        // Taking the lock guarantees that the notification is not lost while
+        // a thread is determining which demuxer to service.
+        boost::mutex::scoped_lock lock(mMutex);
+        ++mChanges;
+    }
+    mCondition.notify_all();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BACKGROUND TASKS
+//////////////////////////////////////////////////////////////////////////
+
+void DemuxerPool::schedule(const std::function<bool()>& task)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mTasks.emplace_back(task);
+        ++mChanges;
+    }
+    mCondition.notify_all();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// THREADS
+//////////////////////////////////////////////////////////////////////////
+
+void DemuxerPool::thread()
+{
+    util::thread::setCurrentThreadName("DemuxerPool");
+
+    boost::mutex::scoped_lock lock(mMutex);
+    while (!mStop)
+    {
+        // Find the demuxer with the earliest deadline.
+        std::list<Entry>::iterator selected{ mEntries.end() };
+        DemuxerPtr demuxer{ nullptr };
+        std::vector<DemuxerPtr> candidates; // Released outside the lock, since that may destruct (close) a demuxer.
+        candidates.reserve(mEntries.size());
+        int64_t deadline{ std::numeric_limits<int64_t>::max() };
+        for (auto it = mEntries.begin(); it != mEntries.end(); )
+        {
+            DemuxerPtr candidate{ it->Reader.lock() };
+            if (!candidate)
+            {
+                ASSERT(!it->Busy);
+                it = mEntries.erase(it); // No more consumers.
+                continue;
+            }
+            if (!it->Busy)
+            {
+                boost::optional<int64_t> candidateDeadline{ candidate->getDeadline() };
+                if (candidateDeadline && *candidateDeadline < deadline)
+                {
+                    deadline = *candidateDeadline;
+                    selected = it;
+                    demuxer = candidate;
+                }
+            }
+            candidates.emplace_back(candidate);
+            ++it;
+        }
+
+        if (!demuxer)
+        {
+            if (!mTaskBusy && !mTasks.empty())
+            {
+                std::function<bool()> task{ mTasks.front() };
+                mTasks.pop_front();
+                mTaskBusy = true;
+                lock.unlock();
+                candidates.clear();
+                bool more{ task() };
+                lock.lock();
+                mTaskBusy = false;
+                if (more)
+                {
+                    mTasks.emplace_back(task); // Round robin between tasks.
+                }
+                lock.unlock();
+                task = nullptr; // Destruct outside the lock.
+                lock.lock();
+                continue;
+            }
+            unsigned int changes{ mChanges };
+            lock.unlock();
+            candidates.clear();
+            lock.lock();
+            if (changes == mChanges && !mStop)
+            {
+                // NOT: wait unconditionally. A notification may have been given while the lock was released.
+                mCondition.wait(lock);
+            }
+            continue;
+        }
+
+        // Move to the end of the list, for round robin servicing of demuxers with equal deadlines.
+        mEntries.splice(mEntries.end(), mEntries, selected);
+        selected->Busy = true;
+
+        bool more{ true };
+        {
+            lock.unlock();
+            candidates.clear();
+            more = demuxer->readPackets();
+            lock.lock();
+        }
+
+        selected->Busy = false;
+        if (!more)
+        {
+            mEntries.erase(selected);
+        }
+        lock.unlock();
+        demuxer.reset(); // Destruct (close file) outside the lock, if this was the last reference.
+        lock.lock();
+        ++mChanges;
+        mCondition.notify_all(); // Other threads may have skipped this demuxer because it was busy.
+    }
+}
+
+} // namespace
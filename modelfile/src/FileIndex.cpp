@@ -0,0 +1,507 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileIndex.h"
+
+#include "FileDemuxerPool.h"
+#include "FileInput.h"
+#include "FileLength.h"
+#include "FileMetaDataCache.h"
+#include "UtilBinaryStream.h"
+#include "UtilInitAvcodec.h"
+
+namespace model {
+
+/// Number of packets read by one background indexing step.
+static const int sFileIndexBatchSize{ 256 };
+
+/// Minimum distance (in AV_TIME_BASE units) between two indexed audio packets.
+/// Keeps the index (see FileMetaDataStore) small, even for files of several
+/// hours. After seeking, at most this amount of audio packets is skipped without decoding.
+static const int64_t sFileIndexAudioInterval{ AV_TIME_BASE / 4 };
+
+/// Amount of audio (in AV_TIME_BASE units) that is read before the requested
+/// position, when seeking via the index. Decoders need a few packets before
+/// producing correct output (mp3 bit reservoir, aac overlapping windows).
+static const int64_t sFileIndexAudioPreroll{ AV_TIME_BASE / 10 };
+
+static boost::mutex sFileIndexMutex;
+static std::set<wxString> sFileIndexPending; ///< Files for which the index is being built.
+
+/// Reads all packets of a file, in the background, in small batches
+/// (see DemuxerPool::schedule). Building stops (without storing anything)
+/// when the project is closed.
+struct FileIndexBuilder
+{
+    FileIndexBuilder(const wxFileName& path, bool determineLength)
+        : mPath(path)
+        , mIndex(boost::make_shared<FileIndex>())
+        , mDetermineLength(determineLength)
+    {
+    }
+
+    ~FileIndexBuilder()
+    {
+        if (mContext != nullptr)
+        {
+            FileInput::close(&mContext);
+        }
+        boost::mutex::scoped_lock lock(sFileIndexMutex);
+        sFileIndexPending.erase(mPath.GetLongPath());
+    }
+
+    /// \return false when done
+    bool step()
+    {
+        if (!FileMetaDataCache::exists())
+        {
+            return false; // Project closed.
+        }
+        if (mContext == nullptr)
+        {
+            wxString path{ mPath.GetLongPath() };
+            int result{ FileInput::open(&mContext, mPath) };
+            if (result != 0)
+            {
+                VAR_WARNING(path)(avcodecErrorString(result));
+                mContext = nullptr;
+                return false;
+            }
+            result = avformat_find_stream_info(mContext, 0);
+            if (result < 0)
+            {
+                VAR_WARNING(path)(avcodecErrorString(result));
+                return false;
+            }
+            if (mDetermineLength)
+            {
+                mLength.reset(FileLength(mContext));
+            }
+        }
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+        AVPacket pkt1 = { 0 };
+        AVPacket* packet = &pkt1;
+        for (int i = 0; i < sFileIndexBatchSize; ++i)
+        {
+            if (av_read_frame(mContext, packet) < 0)
+            {
+                VAR_INFO(mPath)(*mIndex);
+                if (FileMetaDataCache::get().getIndex(mPath) == nullptr)
+                {
+                    FileMetaDataCache::get().setIndex(mPath, mIndex);
+                }
+                if (mLength && mLength->get())
+                {
+                    VAR_INFO(mPath)(*mLength->get());
+                    FileMetaDataCache::get().setLength(mPath, *mLength->get());
+                }
+                return false;
+            }
+            mIndex->add(mContext, packet);
+            if (mLength)
+            {
+                mLength->add(packet);
+            }
+            av_packet_unref(packet);
+        }
+        return true;
+    }
+
+    wxFileName mPath;
+    AVFormatContext* mContext = nullptr;
+    boost::shared_ptr<FileIndex> mIndex;
+    bool mDetermineLength;
+    boost::optional<FileLength> mLength;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+// static
+FileIndexPtr FileIndex::require(const wxFileName& path, const AVFormatContext* context)
+{
+    if (!FileMetaDataCache::exists()) { return nullptr; }
+    FileIndexPtr result{ FileMetaDataCache::get().getIndex(path) };
+    if (result == nullptr)
+    {
+        boost::shared_ptr<FileIndex> index{ fromContainer(context) };
+        if (index != nullptr)
+        {
+            VAR_DEBUG(path)(*index);
+            FileMetaDataCache::get().setIndex(path, index);
+            result = index;
+        }
+        else
+        {
+            schedule(path);
+        }
+    }
+    return result;
+}
+
+// static
+boost::shared_ptr<FileIndex> FileIndex::fromContainer(const AVFormatContext* context)
+{
+    if ((context->iformat->flags & AVFMT_GENERIC_INDEX) != 0)
+    {
+        // The index entries of these formats are only added while reading
+        // packets, or are estimates (mp3 table of contents).
+        return nullptr;
+    }
+    boost::shared_ptr<FileIndex> result{ boost::make_shared<FileIndex>() };
+    for (unsigned int i = 0; i < context->nb_streams; ++i)
+    {
+        if (!isIndexed(context, i)) { continue; }
+        const AVStream* stream{ context->streams[i] };
+        if (stream->nb_index_entries == 0)
+        {
+            return nullptr; // Index not read yet (matroska cues at the end of the file) or no index at all.
+        }
+        bool audio{ stream->codec->codec_type == AVMEDIA_TYPE_AUDIO };
+        int64_t interval{ av_rescale_q(sFileIndexAudioInterval, AVRational{ 1, AV_TIME_BASE }, stream->time_base) };
+        Stream& indexStream{ result->mStreams[i] };
+        indexStream.TimeBaseNum = stream->time_base.num;
+        indexStream.TimeBaseDen = stream->time_base.den;
+        for (int j = 0; j < stream->nb_index_entries; ++j)
+        {
+            // The container index holds decoding timestamps, which for keyframes
+            // are at (or slightly before) the presentation timestamps.
+            const AVIndexEntry& entry{ stream->index_entries[j] };
+            if ((entry.flags & AVINDEX_KEYFRAME) == 0) { continue; }
+            if (!indexStream.Entries.empty() &&
+                entry.timestamp < indexStream.Entries.back().Pts + (audio ? interval : 1))
+            {
+                continue;
+            }
+            FileIndexEntry indexEntry;
+            indexEntry.Pts = entry.timestamp;
+            indexEntry.Position = entry.pos;
+            indexEntry.KeyFrame = true;
+            indexStream.Entries.emplace_back(indexEntry);
+        }
+        if (indexStream.Entries.empty())
+        {
+            return nullptr;
+        }
+    }
+    return result->mStreams.empty() ? nullptr : result;
+}
+
+// static
+void FileIndex::schedule(const wxFileName& path, bool determineLength)
+{
+    if (!FileMetaDataCache::exists() || !DemuxerPool::exists()) { return; }
+    if (FileMetaDataCache::get().getIndex(path) != nullptr &&
+        (!determineLength || FileMetaDataCache::get().getLength(path))) { return; }
+    {
+        boost::mutex::scoped_lock lock(sFileIndexMutex);
+        if (!sFileIndexPending.insert(path.GetLongPath()).second) { return; } // Already scheduled
+    }
+    boost::shared_ptr<FileIndexBuilder> builder{ boost::make_shared<FileIndexBuilder>(path, determineLength) };
+    DemuxerPool::get().schedule([builder] { return builder->step(); });
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BUILDING
+//////////////////////////////////////////////////////////////////////////
+
+void FileIndex::add(const AVFormatContext* context, const AVPacket* packet)
+{
+    ASSERT_LESS_THAN(packet->stream_index, static_cast<int>(context->nb_streams));
+    if (!isIndexed(context, packet->stream_index)) { return; }
+    AVStream* stream{ context->streams[packet->stream_index] };
+    bool audio{ stream->codec->codec_type == AVMEDIA_TYPE_AUDIO };
+    if (!audio && (packet->flags & AV_PKT_FLAG_KEY) == 0) { return; }
+
+    int64_t pts{ packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts };
+    if (pts == AV_NOPTS_VALUE) { return; }
+
+    Stream& indexStream{ mStreams[packet->stream_index] };
+    indexStream.TimeBaseNum = stream->time_base.num;
+    indexStream.TimeBaseDen = stream->time_base.den;
+
+    if (audio &&
+        !indexStream.Entries.empty() &&
+        pts < indexStream.Entries.back().Pts + av_rescale_q(sFileIndexAudioInterval, AVRational{ 1, AV_TIME_BASE }, stream->time_base))
+    {
+        return; // Audio packets are independently decodable: only limit the number of entries.
+    }
+
+    FileIndexEntry entry;
+    entry.Pts = pts;
+    entry.Position = packet->pos;
+    entry.KeyFrame = true;
+    if (indexStream.Entries.empty() || indexStream.Entries.back().Pts < pts)
+    {
+        indexStream.Entries.emplace_back(entry);
+    }
+    else
+    {
+        // Out of order (should not happen for keyframes, but be robust).
+        auto it = std::lower_bound(indexStream.Entries.begin(), indexStream.Entries.end(), pts, [](const FileIndexEntry& e, int64_t value) { return e.Pts < value; });
+        if (it == indexStream.Entries.end() || it->Pts != pts)
+        {
+            indexStream.Entries.insert(it, entry);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SEEKING
+//////////////////////////////////////////////////////////////////////////
+
+boost::optional<int64_t> FileIndex::seek(AVFormatContext* context, int streamIndex, int64_t timestamp) const
+{
+    auto it = mStreams.find(streamIndex);
+    if (it == mStreams.end() ||
+        streamIndex >= static_cast<int>(context->nb_streams) ||
+        it->second.Entries.empty())
+    {
+        return boost::none;
+    }
+    const Stream& indexStream{ it->second };
+    bool audio{ context->streams[streamIndex]->codec->codec_type == AVMEDIA_TYPE_AUDIO };
+    if (audio)
+    {
+        timestamp -= sFileIndexAudioPreroll;
+    }
+
+    AVRational timebase{ indexStream.TimeBaseNum, indexStream.TimeBaseDen };
+    const FileIndexEntry* found{ findKeyFrame(indexStream, av_rescale_q(timestamp, AVRational{ 1, AV_TIME_BASE }, timebase)) };
+    if (found == nullptr)
+    {
+        return boost::none; // Before first keyframe: the caller must read from the start.
+    }
+    const FileIndexEntry& keyframe{ *found };
+    bool byteSeek{ keyframe.Position >= 0 && (context->iformat->flags & AVFMT_NO_BYTE_SEEK) == 0 };
+
+    int result{ -1 };
+    if (audio && byteSeek)
+    {
+        // Position directly at the packet's byte offset. Seeking on a timestamp
+        // is not exact for audio formats without an index of their own (mp3).
+        // Since the packet's pts is known, the (possibly missing) timestamps of
+        // the packets read subsequently can be derived (see Demuxer::readPackets).
+        result = av_seek_frame(context, streamIndex, keyframe.Position, AVSEEK_FLAG_BYTE);
+        if (result >= 0)
+        {
+            return boost::optional<int64_t>(keyframe.Pts);
+        }
+    }
+
+    // Seek exactly to the keyframe's timestamp (in the stream's time base).
+    result = av_seek_frame(context, streamIndex, keyframe.Pts, AVSEEK_FLAG_BACKWARD);
+    if (result >= 0)
+    {
+        return boost::optional<int64_t>(keyframe.Pts);
+    }
+    if (!audio && byteSeek)
+    {
+        // Fallback: position directly at the keyframe's packet.
+        result = av_seek_frame(context, streamIndex, keyframe.Position, AVSEEK_FLAG_BYTE);
+        if (result >= 0)
+        {
+            return boost::optional<int64_t>(keyframe.Pts);
+        }
+    }
+    VAR_WARNING(timestamp)(keyframe.Pts)(keyframe.Position)(avcodecErrorString(result));
+    return boost::none;
+}
+
+bool FileIndex::hasStream(int streamIndex) const
+{
+    auto it = mStreams.find(streamIndex);
+    return it != mStreams.end() && !it->second.Entries.empty();
+}
+
+boost::optional<int64_t> FileIndex::getKeyFrame(int streamIndex, int64_t pts) const
+{
+    auto it = mStreams.find(streamIndex);
+    if (it == mStreams.end())
+    {
+        return boost::none;
+    }
+    const FileIndexEntry* found{ findKeyFrame(it->second, pts) };
+    if (found == nullptr)
+    {
+        return boost::none;
+    }
+    return boost::optional<int64_t>(found->Pts);
+}
+
+boost::optional<int64_t> FileIndex::getLastKeyFrame(int streamIndex) const
+{
+    auto it = mStreams.find(streamIndex);
+    if (it == mStreams.end() || it->second.Entries.empty())
+    {
+        return boost::none;
+    }
+    return boost::optional<int64_t>(it->second.Entries.back().Pts);
+}
+
+boost::optional<std::pair<int64_t, int64_t>> FileIndex::getByteRange(int64_t begin, int64_t end) const
+{
+    boost::optional<std::pair<int64_t, int64_t>> result;
+    for (const auto& kvp : mStreams)
+    {
+        const Stream& stream{ kvp.second };
+        if (stream.Entries.empty()) { continue; }
+        AVRational timebase{ stream.TimeBaseNum, stream.TimeBaseDen };
+        int64_t origin{ stream.Entries.front().Pts };
+        const FileIndexEntry* first{ findKeyFrame(stream, origin + av_rescale_q(begin, AVRational{ 1, AV_TIME_BASE }, timebase)) };
+        if (first == nullptr)
+        {
+            first = &stream.Entries.front();
+        }
+        if (first->Position < 0) { continue; }
+        int64_t last{ std::numeric_limits<int64_t>::max() };
+        int64_t endPts{ origin + av_rescale_q(end, AVRational{ 1, AV_TIME_BASE }, timebase) };
+        auto after = std::upper_bound(stream.Entries.begin(), stream.Entries.end(), endPts, [](int64_t value, const FileIndexEntry& e) { return value < e.Pts; });
+        if (after != stream.Entries.end() && after->Position >= 0)
+        {
+            last = after->Position;
+        }
+        if (!result)
+        {
+            result.reset(std::make_pair(first->Position, last));
+        }
+        else
+        {
+            result->first = std::min(result->first, first->Position);
+            result->second = std::max(result->second, last);
+        }
+    }
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+bool FileIndex::isIndexed(const AVFormatContext* context, int streamIndex)
+{
+    switch (context->streams[streamIndex]->codec->codec_type)
+    {
+    case AVMEDIA_TYPE_VIDEO:
+        return (context->streams[streamIndex]->disposition & AV_DISPOSITION_ATTACHED_PIC) == 0;
+    case AVMEDIA_TYPE_AUDIO:
+        for (unsigned int i = 0; i < context->nb_streams; ++i)
+        {
+            if (context->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+                (context->streams[i]->disposition & AV_DISPOSITION_ATTACHED_PIC) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+// static
+const FileIndexEntry* FileIndex::findKeyFrame(const Stream& stream, int64_t pts)
+{
+    auto it = std::upper_bound(stream.Entries.begin(), stream.Entries.end(), pts, [](int64_t value, const FileIndexEntry& e) { return value < e.Pts; });
+    if (it == stream.Entries.begin())
+    {
+        return nullptr;
+    }
+    return &(*(--it));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FileIndex& obj)
+{
+    os << &obj;
+    for (auto kvp : obj.mStreams)
+    {
+        os << '|' << kvp.first << ':' << kvp.second.Entries.size();
+    }
+    return os;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SERIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+void FileIndex::write(BinaryWriter& writer) const
+{
+    writer.write<uint32_t>(narrow_cast<uint32_t>(mStreams.size()));
+    for (auto kvp : mStreams)
+    {
+        writer.write<int32_t>(kvp.first);
+        writer.write<int32_t>(kvp.second.TimeBaseNum);
+        writer.write<int32_t>(kvp.second.TimeBaseDen);
+        writer.write<uint32_t>(narrow_cast<uint32_t>(kvp.second.Entries.size()));
+        for (const FileIndexEntry& entry : kvp.second.Entries)
+        {
+            writer.write<int64_t>(entry.Pts);
+            writer.write<int64_t>(entry.Position);
+            writer.write<uint8_t>(entry.KeyFrame ? 1 : 0);
+        }
+    }
+}
+
+// static
+boost::shared_ptr<FileIndex> FileIndex::read(BinaryReader& reader)
+{
+    boost::shared_ptr<FileIndex> result{ boost::make_shared<FileIndex>() };
+    uint32_t nStreams{ 0 };
+    if (!reader.read(nStreams)) { return nullptr; }
+    for (uint32_t i = 0; i < nStreams; ++i)
+    {
+        int32_t streamIndex{ 0 };
+        uint32_t nEntries{ 0 };
+        Stream stream;
+        if (!reader.read(streamIndex) ||
+            !reader.read(stream.TimeBaseNum) ||
+            !reader.read(stream.TimeBaseDen) ||
+            !reader.read(nEntries) ||
+            stream.TimeBaseNum <= 0 ||
+            stream.TimeBaseDen <= 0)
+        {
+            return nullptr;
+        }
+        for (uint32_t j = 0; j < nEntries; ++j)
+        {
+            FileIndexEntry entry;
+            uint8_t keyFrame{ 0 };
+            if (!reader.read(entry.Pts) ||
+                !reader.read(entry.Position) ||
+                !reader.read(keyFrame))
+            {
+                return nullptr;
+            }
+            entry.KeyFrame = (keyFrame != 0);
+            if (!stream.Entries.empty() && entry.Pts < stream.Entries.back().Pts)
+            {
+                return nullptr; // Corrupt data: the entries are sorted.
+            }
+            stream.Entries.emplace_back(entry);
+        }
+        result->mStreams[streamIndex] = stream;
+    }
+    return result;
+}
+
+} //namespace
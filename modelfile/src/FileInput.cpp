@@ -0,0 +1,319 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "FileInput.h"
+
+#include "UtilPath.h"
+#include "UtilReadOnlyFile.h"
+
+namespace model {
+
+/// Size of the buffer of each I/O context. Larger than avformat's default,
+/// which reduces the number of reads (and seeks within the buffer succeed more often).
+static const int sFileInputBufferSize{ 256 * 1024 };
+
+/// Amount of data following the read position, that the operating system is asked to read in advance.
+static const size_t sFileInputReadAhead{ 4 * 1024 * 1024 };
+
+/// Number of prefetched parts that is remembered per file, for the statistics.
+static const size_t sFileInputPrefetchedParts{ 16 };
+
+/// Number of files for which the prefetched parts are remembered, for the statistics.
+static const size_t sFileInputPrefetchedFiles{ 64 };
+
+/// State of one I/O context.
+struct FileInputReader
+{
+    boost::shared_ptr<const ReadOnlyFile> File;
+    wxString Key;           ///< Only set if reads are included in the statistics.
+    int64_t Position = 0;
+    int64_t PrefetchedUntil = 0;
+};
+
+static int readFileInput(void* opaque, uint8_t* buffer, int size)
+{
+    FileInputReader* reader{ static_cast<FileInputReader*>(opaque) };
+    if (reader->Position + size > reader->PrefetchedUntil ||
+        reader->Position < reader->PrefetchedUntil - static_cast<int64_t>(sFileInputReadAhead)) // After a seek back
+    {
+        reader->File->prefetch(reader->Position, sFileInputReadAhead);
+        reader->PrefetchedUntil = reader->Position + sFileInputReadAhead;
+    }
+    int n{ reader->File->read(reader->Position, buffer, size) };
+    if (n < 0)
+    {
+        return AVERROR(EIO);
+    }
+    if (n == 0)
+    {
+        return AVERROR_EOF; // Also if the file was truncated in the meantime.
+    }
+    if (!reader->Key.IsEmpty() && FileInput::exists())
+    {
+        FileInput::get().countRead(reader->Key, reader->Position, n);
+    }
+    reader->Position += n;
+    return n;
+}
+
+static int64_t seekFileInput(void* opaque, int64_t offset, int whence)
+{
+    FileInputReader* reader{ static_cast<FileInputReader*>(opaque) };
+    int64_t fileSize{ reader->File->getSize() };
+    int64_t position{ 0 };
+    switch (whence & ~AVSEEK_FORCE)
+    {
+    case AVSEEK_SIZE:   return fileSize;
+    case SEEK_SET:      position = offset;                      break;
+    case SEEK_CUR:      position = reader->Position + offset;   break;
+    case SEEK_END:      position = fileSize + offset;           break;
+    default:            return AVERROR(EINVAL);
+    }
+    if (position < 0 || position > fileSize)
+    {
+        return AVERROR(EINVAL);
+    }
+    reader->Position = position;
+    return position;
+}
+
+static void freeFileInput(AVIOContext* io)
+{
+    delete static_cast<FileInputReader*>(io->opaque);
+    av_freep(&io->buffer); // NOT the buffer given to avio_alloc_context: avformat may have replaced it.
+    av_freep(&io);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// STATISTICS
+//////////////////////////////////////////////////////////////////////////
+
+double FileInputStatistics::getHitRate() const
+{
+    return Reads == 0 ? 0.0 : static_cast<double>(Hits) / static_cast<double>(Reads);
+}
+
+std::ostream& operator<<(std::ostream& os, const FileInputStatistics& obj)
+{
+    os  << obj.Hits << '/'
+        << obj.Reads << '|'
+        << obj.getHitRate();
+    return os;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FileInput::FileInput()
+{
+    VAR_DEBUG(this);
+}
+
+FileInput::~FileInput()
+{
+    VAR_DEBUG(this);
+    // NOT: ASSERT(mOpened.empty()). Contexts that are still open keep their file open.
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE
+//////////////////////////////////////////////////////////////////////////
+
+// static
+int FileInput::open(AVFormatContext** context, const wxFileName& path, bool demuxing)
+{
+    ASSERT_ZERO(*context);
+    wxString name{ path.GetLongPath() };
+    wxString key{ getKey(path) };
+    boost::shared_ptr<const ReadOnlyFile> file{ exists() && !key.IsEmpty() ? get().openFile(path, key) : nullptr };
+    unsigned char* buffer{ file ? static_cast<unsigned char*>(av_malloc(sFileInputBufferSize)) : nullptr };
+    *context = buffer ? avformat_alloc_context() : nullptr;
+    if (*context == nullptr)
+    {
+        av_free(buffer);
+        return avformat_open_input(context, name, 0, 0);
+    }
+
+    FileInputReader* reader{ new FileInputReader() };
+    reader->File = file;
+    if (demuxing)
+    {
+        reader->Key = key;
+    }
+    AVIOContext* io{ avio_alloc_context(buffer, sFileInputBufferSize, 0, reader, &readFileInput, nullptr, &seekFileInput) };
+    if (io == nullptr)
+    {
+        delete reader;
+        av_free(buffer);
+        avformat_free_context(*context);
+        *context = nullptr;
+        return avformat_open_input(context, name, 0, 0);
+    }
+    (*context)->pb = io;
+    (*context)->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    int result{ avformat_open_input(context, name, 0, 0) };
+    if (result != 0)
+    {
+        // The format context has been freed by avformat_open_input, the I/O context has not.
+        ASSERT_ZERO(*context);
+        freeFileInput(io);
+    }
+    return result;
+}
+
+// static
+void FileInput::close(AVFormatContext** context)
+{
+    ASSERT_NONZERO(*context);
+    AVIOContext* io{ ((*context)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*context)->pb : nullptr };
+    avformat_close_input(context);
+    ASSERT_ZERO(*context);
+    if (io != nullptr)
+    {
+        freeFileInput(io);
+        if (exists())
+        {
+            get().removeClosedFiles();
+        }
+    }
+}
+
+// static
+void FileInput::prefetch(const util::path::FileIdentity& identity, int64_t offset, int64_t length)
+{
+    if (!exists() || offset < 0 || length <= 0 || identity.Size == 0) { return; }
+    wxString key{ identity.toString() };
+    FileInput& input{ get() };
+    boost::shared_ptr<const ReadOnlyFile> file{ input.openFile(wxFileName(identity.Path), key) };
+    if (!file) { return; }
+    length = std::min<int64_t>(length, file->getSize() - offset);
+    if (length <= 0) { return; }
+    // After closing (when the last reader of the file is closed) the data remains in the operating system's cache.
+    file->prefetch(offset, length);
+
+    boost::mutex::scoped_lock lock(input.mMutex);
+    auto order = std::find(input.mPrefetchedOrder.begin(), input.mPrefetchedOrder.end(), key);
+    if (order != input.mPrefetchedOrder.end())
+    {
+        input.mPrefetchedOrder.erase(order);
+    }
+    input.mPrefetchedOrder.push_back(key);
+    if (input.mPrefetchedOrder.size() > sFileInputPrefetchedFiles)
+    {
+        input.mPrefetched.erase(input.mPrefetchedOrder.front());
+        input.mPrefetchedOrder.pop_front();
+    }
+    std::deque<std::pair<int64_t, int64_t>>& parts{ input.mPrefetched[key] };
+    parts.emplace_back(offset, offset + length);
+    if (parts.size() > sFileInputPrefetchedParts)
+    {
+        parts.pop_front();
+    }
+}
+
+// static
+FileInputStatistics FileInput::getStatistics()
+{
+    if (!exists()) { return FileInputStatistics(); }
+    boost::mutex::scoped_lock lock(get().mMutex);
+    return get().mStatistics;
+}
+
+void FileInput::countRead(const wxString& key, int64_t offset, int64_t length)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    ++mStatistics.Reads;
+    auto it = mPrefetched.find(key);
+    if (it == mPrefetched.end()) { return; }
+    for (const std::pair<int64_t, int64_t>& part : it->second)
+    {
+        if (offset >= part.first && offset + length <= part.second)
+        {
+            ++mStatistics.Hits;
+            return;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+wxString FileInput::getKey(const wxFileName& path)
+{
+    boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(path) };
+    if (!identity || identity->Size == 0)
+    {
+        return "";
+    }
+    return identity->toString();
+}
+
+boost::shared_ptr<const ReadOnlyFile> FileInput::openFile(const wxFileName& path, const wxString& key)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    auto it = mOpened.find(key);
+    if (it != mOpened.end())
+    {
+        boost::shared_ptr<const ReadOnlyFile> opened{ it->second.lock() };
+        if (opened) { return opened; }
+        mOpened.erase(it);
+    }
+    boost::shared_ptr<const ReadOnlyFile> opened{ boost::make_shared<ReadOnlyFile>(path) };
+    if (!opened->isOpen() || opened->getSize() == 0)
+    {
+        VAR_WARNING(path)(opened->getSize());
+        return nullptr;
+    }
+    mOpened[key] = opened;
+    return opened;
+}
+
+void FileInput::removeClosedFiles()
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    for (auto it = mOpened.begin(); it != mOpened.end(); )
+    {
+        if (it->second.expired())
+        {
+            it = mOpened.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FileInput& obj)
+{
+    os  << &obj << '|'
+        << obj.mOpened.size() << '|'
+        << obj.mPrefetched.size() << '|'
+        << obj.mStatistics;
+    return os;
+}
+
+} //namespace
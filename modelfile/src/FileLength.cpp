@@ -0,0 +1,199 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileLength.h"
+
+#include "Convert.h"
+#include "UtilInitAvcodec.h"
+
+namespace model {
+
+/// Number of bytes at the end of a file that are read for estimating the length.
+static const int64_t sFileLengthTailSize{ 4 * 1024 * 1024 };
+
+/// Maximum number of packets read at the end of a file (in case positioning
+/// at the end silently failed).
+static const int sFileLengthTailPackets{ 10000 };
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FileLength::FileLength(const AVFormatContext* context)
+    : mContext(context)
+    , mMaximumPts(context->nb_streams, AV_NOPTS_VALUE) // Note: no {, since that'll cause the wrong size
+    , mVideoPackets(context->nb_streams, 0)
+{
+}
+
+// static
+boost::optional<pts> FileLength::estimate(AVFormatContext* context, const FileIndexPtr& index)
+{
+    FileLength length(context);
+    if (index != nullptr)
+    {
+        for (unsigned int i = 0; i < context->nb_streams; ++i)
+        {
+            boost::optional<int64_t> keyframe{ index->getLastKeyFrame(i) };
+            if (keyframe)
+            {
+                length.addPts(i, *keyframe);
+            }
+        }
+    }
+    length.readTail(context);
+
+    // Note: the packet counts are not used here, since only part of the packets was read.
+    boost::optional<pts> result{ length.getFromTimestamps() };
+    if (!result &&
+        context->bit_rate > 0 &&
+        context->pb != nullptr &&
+        avio_size(context->pb) > 0)
+    {
+        // Last resort. Inaccurate for files with a variable bit rate.
+        result.reset(Convert::rationaltimeToPts(rational64(sSecond, 1) * rational64(avio_size(context->pb) * 8, context->bit_rate)));
+    }
+    VAR_DEBUG(result);
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+void FileLength::add(const AVPacket* packet)
+{
+    ASSERT_LESS_THAN(packet->stream_index, static_cast<int>(mContext->nb_streams));
+    const AVStream* stream{ mContext->streams[packet->stream_index] };
+    if (stream->codec->codec_type != AVMEDIA_TYPE_VIDEO &&
+        stream->codec->codec_type != AVMEDIA_TYPE_AUDIO)
+    {
+        return; // Subtitle and data streams may have unrelated timestamps.
+    }
+    if (packet->pts != AV_NOPTS_VALUE)
+    {
+        addPts(packet->stream_index, packet->pts + std::max<int64_t>(packet->duration, 0));
+    }
+    if (stream->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+        (stream->disposition & AV_DISPOSITION_ATTACHED_PIC) == 0)
+    {
+        mVideoPackets[packet->stream_index]++;
+    }
+}
+
+boost::optional<pts> FileLength::get() const
+{
+    boost::optional<pts> result{ getFromTimestamps() };
+    if (!result)
+    {
+        // Fallback: use number of packets. May be too much, but then the user can still cut off the end of the clip.
+        pts packets{ *std::max_element(mVideoPackets.begin(), mVideoPackets.end()) };
+        if (packets > 0)
+        {
+            result.reset(packets);
+        }
+    }
+    return result;
+}
+
+// static
+pts FileLength::getFrameCount(const AVStream* stream, int64_t duration)
+{
+    ASSERT_DIFFERS(duration, AV_NOPTS_VALUE);
+    if (duration == 1)
+    {
+        // Stil image: disregard the timebase, since rounding errors
+        // (timebase of file different than project time base)
+        // may result in the outcome '0'.
+        return 1;
+    }
+    return Convert::rationaltimeToPts(rational64(sSecond, 1) * rational64(duration, 1) * rational64(stream->time_base.num, stream->time_base.den));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+void FileLength::addPts(int streamIndex, int64_t timestamp)
+{
+    ASSERT_LESS_THAN(streamIndex, static_cast<int>(mMaximumPts.size()));
+    if (mMaximumPts[streamIndex] == AV_NOPTS_VALUE ||
+        mMaximumPts[streamIndex] < timestamp)
+    {
+        mMaximumPts[streamIndex] = timestamp;
+    }
+}
+
+boost::optional<pts> FileLength::getFromTimestamps() const
+{
+    pts result{ 0 };
+    for (unsigned int i = 0; i < mContext->nb_streams; ++i)
+    {
+        int64_t duration{ mMaximumPts[i] };
+        if (duration == AV_NOPTS_VALUE) { continue; }
+        const AVStream* stream{ mContext->streams[i] };
+        if (stream->start_time != AV_NOPTS_VALUE &&
+            stream->start_time < duration)
+        {
+            duration -= stream->start_time;
+        }
+        result = std::max(result, getFrameCount(stream, duration));
+    }
+    if (result <= 0)
+    {
+        return boost::none;
+    }
+    return boost::optional<pts>(result);
+}
+
+void FileLength::readTail(AVFormatContext* context)
+{
+    if (context->pb == nullptr ||
+        (context->iformat->flags & AVFMT_NO_BYTE_SEEK) != 0)
+    {
+        return;
+    }
+    int64_t size{ avio_size(context->pb) };
+    if (size <= 0)
+    {
+        return;
+    }
+    int result{ av_seek_frame(context, -1, std::max<int64_t>(0, size - sFileLengthTailSize), AVSEEK_FLAG_BYTE) };
+    if (result >= 0)
+    {
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+        AVPacket pkt1 = { 0 };
+        AVPacket* packet = &pkt1;
+        for (int i = 0; i < sFileLengthTailPackets && av_read_frame(context, packet) >= 0; ++i)
+        {
+            add(packet);
+            av_packet_unref(packet);
+        }
+    }
+    else
+    {
+        VAR_DEBUG(size)(avcodecErrorString(result));
+    }
+
+    // Reset position to beginning again. Otherwise, first playback (without 'moveTo' first) will cause errors.
+    if (av_seek_frame(context, -1, 0, AVSEEK_FLAG_BYTE) < 0)
+    {
+        avformat_seek_file(context, -1, std::numeric_limits<int64_t>::min(), 0, std::numeric_limits<int64_t>::max(), 0);
+    }
+}
+
+} // namespace
@@ -19,6 +19,9 @@
 
 #include <boost/serialization/map.hpp>
 #include "AudioPeaks.h"
+#include "FileMetaDataStore.h"
+#include "FileValidator.h"
+#include "UtilPath.h"
 #include "UtilSerializeBoost.h"
 #include "UtilSerializeWxwidgets.h"
 
@@ -34,6 +37,8 @@ namespace model {
 
     wxDateTime LastModified;
     boost::optional<pts> Length = boost::none;
+    boost::shared_ptr<FileIndex> Index = nullptr; ///< Not stored (see FileMetaDataStore).
+    bool Validated = false; ///< True if LastModified has been checked in this session. Not stored.
 
     friend class boost::serialization::access;
     template<class Archive>
@@ -55,6 +60,7 @@ namespace model {
 //////////////////////////////////////////////////////////////////////////
 
 FileMetaDataCache::FileMetaDataCache()
+    : mMetaData(boost::make_shared<const MetaDataMap>())
 {
     VAR_DEBUG(this);
 }
@@ -70,25 +76,125 @@ FileMetaDataCache::~FileMetaDataCache()
 
 boost::optional<pts> FileMetaDataCache::getLength(const wxFileName& file)
 {
-    boost::mutex::scoped_lock lock(mMutex);
-    return getDataForFile(file)->Length;
+    FileMetaDataPtr data{ find(file) };
+    if (data && data->Length)
+    {
+        return data->Length;
+    }
+    boost::optional<pts> length{ FileMetaDataStore::getLength(file) }; // Maybe known from another project.
+    if (length)
+    {
+        change(file, [length](FileMetaData& data) { data.Length = length; });
+    }
+    return length;
 }
 
 void FileMetaDataCache::setLength(const wxFileName& file, const pts& length)
+{
+    change(file, [length](FileMetaData& data) { data.Length.reset(length); });
+    FileMetaDataStore::setLength(file, length);
+}
+
+FileIndexPtr FileMetaDataCache::getIndex(const wxFileName& file)
+{
+    FileMetaDataPtr data{ find(file) };
+    if (data && data->Index)
+    {
+        return data->Index;
+    }
+    FileIndexPtr index{ FileMetaDataStore::getIndex(file) }; // Maybe known from another project.
+    if (index != nullptr)
+    {
+        boost::shared_ptr<FileIndex> copy{ boost::make_shared<FileIndex>(*index) };
+        change(file, [copy](FileMetaData& data) { data.Index = copy; });
+    }
+    return index;
+}
+
+void FileMetaDataCache::setIndex(const wxFileName& file, const boost::shared_ptr<FileIndex>& index)
+{
+    change(file, [index](FileMetaData& data) { data.Index = index; });
+    FileMetaDataStore::setIndex(file, index);
+}
+
+void FileMetaDataCache::invalidate(const wxFileName& path)
 {
     boost::mutex::scoped_lock lock(mMutex);
-    getDataForFile(file)->Length.reset(length);
+    boost::shared_ptr<const MetaDataMap> metadata{ boost::atomic_load(&mMetaData) };
+    boost::shared_ptr<MetaDataMap> updated{ boost::make_shared<MetaDataMap>(*metadata) };
+    bool changed{ false };
+    for (auto& kvp : *updated)
+    {
+        if (kvp.second->Validated &&
+            (path.GetFullPath().IsEmpty() ||
+             util::path::equals(path, kvp.first) ||
+             util::path::isParentOf(path, kvp.first)))
+        {
+            FileMetaDataPtr data{ boost::make_shared<FileMetaData>(*kvp.second) };
+            data->Validated = false;
+            kvp.second = data;
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        VAR_DEBUG(path);
+        boost::atomic_store(&mMetaData, boost::shared_ptr<const MetaDataMap>(updated));
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
 // HELPER METHODS
 //////////////////////////////////////////////////////////////////////////
 
-FileMetaDataPtr FileMetaDataCache::getDataForFile(const wxFileName& file)
+FileMetaDataPtr FileMetaDataCache::find(const wxFileName& file)
+{
+    boost::shared_ptr<const MetaDataMap> metadata{ boost::atomic_load(&mMetaData) };
+    auto it = metadata->find(file);
+    if (it == metadata->end())
+    {
+        return nullptr; // NOT: insert an empty entry. Entries are only made when there is data to be stored.
+    }
+    if (it->second->Validated)
+    {
+        return it->second; // Fast path: no file system access, no locking.
+    }
+    if (FileValidator::isPending(file))
+    {
+        return it->second; // Directly after opening a project: trust the data until the file has been validated.
+    }
+
+    // First use in this session, or changed on disk.
+    boost::mutex::scoped_lock lock(mMutex);
+    metadata = boost::atomic_load(&mMetaData); // Another thread may have changed the data in the meantime.
+    FileMetaDataPtr data{ validate(*metadata, file) };
+    boost::shared_ptr<MetaDataMap> updated{ boost::make_shared<MetaDataMap>(*metadata) };
+    if (data)
+    {
+        (*updated)[file] = data;
+    }
+    else
+    {
+        updated->erase(file);
+    }
+    boost::atomic_store(&mMetaData, boost::shared_ptr<const MetaDataMap>(updated));
+    return data;
+}
+
+FileMetaDataPtr FileMetaDataCache::validate(const MetaDataMap& metadata, const wxFileName& file) const
 {
     // NOT: boost::mutex::scoped_lock lock(mMutex); -- Lock taken in calling method.
-    auto ret = mMetaData.insert(std::make_pair(file, boost::make_shared<FileMetaData>(file.GetModificationTime()))); // Inserts new item if no entry present yet.
-    FileMetaDataPtr data = ret.first->second;
+    auto it = metadata.find(file);
+    if (it == metadata.end())
+    {
+        return nullptr;
+    }
+    if (it->second->Validated)
+    {
+        return it->second;
+    }
+    FileMetaDataPtr data{ boost::make_shared<FileMetaData>(*it->second) };
+    data->Validated = true;
     if (file.Exists())
     {
         wxDateTime currentFileTime{ file.GetModificationTime() };
@@ -100,14 +206,26 @@ FileMetaDataPtr FileMetaDataCache::getDataForFile(const wxFileName& file)
         if (!currentFileTime.IsEqualTo(cachedFileTime))
         {
             VAR_INFO(file.GetLongPath())(currentFileTime)(cachedFileTime);
-            mMetaData.erase(ret.first);
-            return getDataForFile(file); // Will cause insert of new empty item.
+            return nullptr;
         }
     }
     // else: File deleted already return last known values?
     return data;
 }
 
+void FileMetaDataCache::change(const wxFileName& file, const std::function<void(FileMetaData&)>& method)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    boost::shared_ptr<const MetaDataMap> metadata{ boost::atomic_load(&mMetaData) };
+    FileMetaDataPtr existing{ validate(*metadata, file) };
+    FileMetaDataPtr data{ existing ? boost::make_shared<FileMetaData>(*existing) : boost::make_shared<FileMetaData>(file.GetModificationTime()) };
+    data->Validated = true;
+    method(*data);
+    boost::shared_ptr<MetaDataMap> updated{ boost::make_shared<MetaDataMap>(*metadata) };
+    (*updated)[file] = data;
+    boost::atomic_store(&mMetaData, boost::shared_ptr<const MetaDataMap>(updated));
+}
+
 //////////////////////////////////////////////////////////////////////////
 // LOGGING
 //////////////////////////////////////////////////////////////////////////
@@ -127,7 +245,17 @@ void FileMetaDataCache::serialize(Archive & ar, const unsigned int version)
 {
     try
     {
-        ar & BOOST_SERIALIZATION_NVP(mMetaData);
+        // The snapshot is serialized as a plain map, for compatibility with older files.
+        MetaDataMap metadata;
+        if (Archive::is_saving::value)
+        {
+            metadata = *boost::atomic_load(&mMetaData);
+        }
+        ar & boost::serialization::make_nvp("mMetaData", metadata);
+        if (Archive::is_loading::value)
+        {
+            boost::atomic_store(&mMetaData, boost::shared_ptr<const MetaDataMap>(boost::make_shared<MetaDataMap>(metadata)));
+        }
     }
     catch (boost::exception &e)                  { VAR_ERROR(boost::diagnostic_information(e)); throw; }
     catch (std::exception& e)                    { VAR_ERROR(e.what());                         throw; }
@@ -143,4 +271,4 @@ template void FileMetaData::serialize<boost::archive::xml_iarchive>(boost::archi
 } //namespace
 
 BOOST_CLASS_EXPORT_IMPLEMENT(model::FileMetaDataCache)
-BOOST_CLASS_VERSION(model::FileMetaData, 2)
\ No newline at end of file
+BOOST_CLASS_VERSION(model::FileMetaData, 3)
\ No newline at end of file
@@ -0,0 +1,400 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileMetaDataStore.h"
+
+#include "Config.h"
+#include "UtilBinaryStream.h"
+#include "UtilMemoryMappedFile.h"
+#include "UtilPath.h"
+
+namespace model {
+
+/// Identifies the file format. Files with another identification are ignored.
+static const char sFileMetaDataStoreMagic[]{ 'V', 'I', 'D', 'M', 'E', 'T', 'A', '\0' };
+static const uint32_t sFileMetaDataStoreVersion{ 1 };
+
+/// Maximum number of files in the cache. Least recently used files are removed first.
+static const size_t sFileMetaDataStoreMaximumEntries{ 20000 };
+
+static const uint8_t sFileMetaDataStoreHasLength{ 1 };
+static const uint8_t sFileMetaDataStoreHasProperties{ 2 };
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FileMetaDataStore::FileMetaDataStore()
+    : mPersistent(!Config::get().read<bool>(Config::sPathTestCxxMode)) // Tests must not depend on the results of earlier runs.
+    , mPath(util::path::getMediaCacheFilePath())
+{
+    VAR_DEBUG(this);
+    if (mPersistent)
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        load(mPath);
+    }
+}
+
+FileMetaDataStore::~FileMetaDataStore()
+{
+    VAR_DEBUG(*this);
+    if (mPersistent)
+    {
+        save(mPath);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+// static
+boost::optional<pts> FileMetaDataStore::getLength(const wxFileName& file, bool trusted)
+{
+    if (!exists()) { return boost::none; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, false, trusted) };
+    if (entry == nullptr) { return boost::none; }
+    return entry->Length;
+}
+
+// static
+void FileMetaDataStore::setLength(const wxFileName& file, pts length)
+{
+    if (!exists()) { return; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, true) };
+    if (entry == nullptr) { return; }
+    entry->Length.reset(length);
+}
+
+// static
+boost::optional<FileProperties> FileMetaDataStore::getProperties(const wxFileName& file, bool trusted)
+{
+    if (!exists()) { return boost::none; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, false, trusted) };
+    if (entry == nullptr) { return boost::none; }
+    return entry->Properties;
+}
+
+// static
+void FileMetaDataStore::setProperties(const wxFileName& file, const FileProperties& properties)
+{
+    if (!exists()) { return; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, true) };
+    if (entry == nullptr) { return; }
+    entry->Properties.reset(properties);
+}
+
+// static
+FileIndexPtr FileMetaDataStore::getIndex(const wxFileName& file)
+{
+    if (!exists()) { return nullptr; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, false) };
+    if (entry == nullptr) { return nullptr; }
+    if (entry->Index == nullptr && entry->IndexData != nullptr)
+    {
+        // Decoded upon first use only. Most indexes in the file are not used in a session.
+        BinaryReader reader(entry->IndexData, entry->IndexSize);
+        entry->Index = FileIndex::read(reader);
+        if (entry->Index == nullptr)
+        {
+            VAR_WARNING(file)(entry->IndexSize);
+        }
+        entry->IndexData = nullptr;
+        entry->IndexSize = 0;
+    }
+    return entry->Index;
+}
+
+// static
+void FileMetaDataStore::setIndex(const wxFileName& file, const FileIndexPtr& index)
+{
+    if (!exists()) { return; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, true) };
+    if (entry == nullptr) { return; }
+    entry->Index = index;
+    entry->IndexData = nullptr;
+    entry->IndexSize = 0;
+}
+
+// static
+wxString FileMetaDataStore::getPeaks(const wxFileName& file)
+{
+    if (!exists()) { return wxEmptyString; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, false) };
+    if (entry == nullptr) { return wxEmptyString; }
+    return entry->Peaks;
+}
+
+// static
+void FileMetaDataStore::setPeaks(const wxFileName& file, const wxString& location)
+{
+    if (!exists()) { return; }
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    Entry* entry{ store.find(file, true) };
+    if (entry == nullptr) { return; }
+    entry->Peaks = location;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST
+//////////////////////////////////////////////////////////////////////////
+
+// static
+void FileMetaDataStore::write(const wxFileName& file)
+{
+    ASSERT(exists());
+    get().save(file);
+}
+
+// static
+void FileMetaDataStore::read(const wxFileName& file)
+{
+    ASSERT(exists());
+    FileMetaDataStore& store{ get() };
+    boost::mutex::scoped_lock lock(store.mMutex);
+    store.load(file);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+FileMetaDataStore::Entry* FileMetaDataStore::find(const wxFileName& file, bool create, bool trusted)
+{
+    // NOT: boost::mutex::scoped_lock lock(mMutex); -- Lock taken in calling method.
+    if (trusted)
+    {
+        ASSERT(!create);
+        auto it = mEntries.find(file.GetLongPath());
+        if (it == mEntries.end())
+        {
+            return nullptr;
+        }
+        it->second.LastUsed = static_cast<int64_t>(wxDateTime::Now().GetTicks());
+        return &(it->second);
+    }
+    if (!file.FileExists())
+    {
+        return nullptr;
+    }
+    boost::optional<util::path::FileIdentity> identity{ util::path::getIdentity(file) };
+    if (!identity)
+    {
+        return nullptr; // File removed just now.
+    }
+    int64_t fileSize{ identity->Size };
+    int64_t fileModified{ identity->Modified };
+
+    wxString key{ identity->Path };
+    auto it = mEntries.find(key);
+    if (it != mEntries.end() &&
+        (it->second.Size != fileSize || it->second.Modified != fileModified))
+    {
+        VAR_INFO(key)(fileSize)(fileModified)(it->second.Size)(it->second.Modified);
+        mEntries.erase(it);
+        it = mEntries.end();
+    }
+    if (it == mEntries.end())
+    {
+        if (!create)
+        {
+            return nullptr;
+        }
+        Entry entry;
+        entry.Size = fileSize;
+        entry.Modified = fileModified;
+        it = mEntries.insert(std::make_pair(key, entry)).first;
+    }
+    it->second.LastUsed = static_cast<int64_t>(wxDateTime::Now().GetTicks());
+    return &(it->second);
+}
+
+void FileMetaDataStore::load(const wxFileName& path)
+{
+    // NOT: boost::mutex::scoped_lock lock(mMutex); -- Lock taken in calling method.
+    mEntries.clear();
+    mFile.reset(new MemoryMappedFile(path));
+    if (mFile->getData() == nullptr)
+    {
+        mFile.reset();
+        return; // No cache yet.
+    }
+
+    BinaryReader reader(mFile->getData(), mFile->getSize());
+    uint32_t version{ 0 };
+    uint32_t count{ 0 };
+    if (mFile->getSize() < sizeof(sFileMetaDataStoreMagic) ||
+        memcmp(mFile->getData(), sFileMetaDataStoreMagic, sizeof(sFileMetaDataStoreMagic)) != 0 ||
+        !reader.skip(sizeof(sFileMetaDataStoreMagic)) ||
+        !reader.read(version) ||
+        version != sFileMetaDataStoreVersion ||
+        !reader.read(count))
+    {
+        LOG_WARNING << "Ignoring media cache " << path.GetLongPath() << " (unknown format).";
+        mFile.reset();
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        wxString key;
+        Entry entry;
+        uint8_t flags{ 0 };
+        pts length{ 0 };
+        FileProperties properties;
+        uint32_t indexSize{ 0 };
+        bool ok{
+            reader.read(key) &&
+            reader.read(entry.Size) &&
+            reader.read(entry.Modified) &&
+            reader.read(entry.LastUsed) &&
+            reader.read(flags) &&
+            reader.read(length) &&
+            reader.read(properties.VideoStream) &&
+            reader.read(properties.AudioStream) &&
+            reader.read(properties.MaximumStartPts) &&
+            reader.read(properties.FrameRateNum) &&
+            reader.read(properties.FrameRateDen) &&
+            reader.read(properties.Width) &&
+            reader.read(properties.Height) &&
+            reader.read(properties.SampleRate) &&
+            reader.read(properties.Channels) &&
+            reader.read(entry.Peaks) &&
+            reader.read(indexSize) };
+        if (ok && indexSize > 0)
+        {
+            entry.IndexData = reader.getCurrent();
+            entry.IndexSize = indexSize;
+            ok = reader.skip(indexSize);
+        }
+        if (!ok)
+        {
+            LOG_WARNING << "Ignoring media cache " << path.GetLongPath() << " (truncated at entry " << i << ").";
+            mEntries.clear();
+            mFile.reset();
+            return;
+        }
+        if ((flags & sFileMetaDataStoreHasLength) != 0)
+        {
+            entry.Length.reset(length);
+        }
+        if ((flags & sFileMetaDataStoreHasProperties) != 0)
+        {
+            entry.Properties.reset(properties);
+        }
+        mEntries[key] = entry;
+    }
+    VAR_INFO(*this);
+}
+
+void FileMetaDataStore::save(const wxFileName& path)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+
+    std::vector<std::map<wxString, Entry>::const_iterator> entries;
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+    {
+        entries.emplace_back(it);
+    }
+    std::sort(entries.begin(), entries.end(), [](std::map<wxString, Entry>::const_iterator e1, std::map<wxString, Entry>::const_iterator e2) { return e1->second.LastUsed > e2->second.LastUsed; });
+    if (entries.size() > sFileMetaDataStoreMaximumEntries)
+    {
+        entries.resize(sFileMetaDataStoreMaximumEntries);
+    }
+
+    std::vector<char> buffer;
+    BinaryWriter writer(buffer);
+    writer.write(sFileMetaDataStoreMagic, sizeof(sFileMetaDataStoreMagic));
+    writer.write<uint32_t>(sFileMetaDataStoreVersion);
+    writer.write<uint32_t>(narrow_cast<uint32_t>(entries.size()));
+    for (std::map<wxString, Entry>::const_iterator it : entries)
+    {
+        const Entry& entry{ it->second };
+        FileProperties properties{ entry.Properties ? *entry.Properties : FileProperties() };
+        writer.write(it->first);
+        writer.write<int64_t>(entry.Size);
+        writer.write<int64_t>(entry.Modified);
+        writer.write<int64_t>(entry.LastUsed);
+        writer.write<uint8_t>((entry.Length ? sFileMetaDataStoreHasLength : 0) | (entry.Properties ? sFileMetaDataStoreHasProperties : 0));
+        writer.write<pts>(entry.Length ? *entry.Length : 0);
+        writer.write<int>(properties.VideoStream);
+        writer.write<int>(properties.AudioStream);
+        writer.write<int64_t>(properties.MaximumStartPts);
+        writer.write<int>(properties.FrameRateNum);
+        writer.write<int>(properties.FrameRateDen);
+        writer.write<int>(properties.Width);
+        writer.write<int>(properties.Height);
+        writer.write<int>(properties.SampleRate);
+        writer.write<int>(properties.Channels);
+        writer.write(entry.Peaks);
+        if (entry.Index != nullptr)
+        {
+            std::vector<char> index;
+            BinaryWriter indexWriter(index);
+            entry.Index->write(indexWriter);
+            writer.write<uint32_t>(narrow_cast<uint32_t>(index.size()));
+            writer.write(index.data(), index.size());
+        }
+        else
+        {
+            // Not decoded in this session: copy as is.
+            writer.write<uint32_t>(narrow_cast<uint32_t>(entry.IndexSize));
+            writer.write(entry.IndexData, entry.IndexSize);
+        }
+    }
+    mEntries.clear();
+    mFile.reset(); // Unmap before replacing the file.
+
+    // A crash while writing does not corrupt the existing cache.
+    if (!util::path::writeAtomically(path, [&buffer](wxFile& file) { return file.Write(buffer.data(), buffer.size()) == buffer.size(); }))
+    {
+        LOG_WARNING << "Could not write media cache " << path.GetLongPath() << '.';
+        return;
+    }
+    VAR_INFO(path)(entries.size())(buffer.size());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FileMetaDataStore& obj)
+{
+    os  << &obj << '|'
+        << obj.mPersistent << '|'
+        << obj.mPath << '|'
+        << obj.mEntries.size();
+    return os;
+}
+
+} // namespace
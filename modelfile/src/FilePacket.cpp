@@ -17,26 +17,90 @@
 
 #include "FilePacket.h"
 
+#include "UtilRingBuffer.h"
+
 namespace model {
 
+/// Maximum number of unused Packet objects kept for reuse. Sufficient for
+/// the buffers of several files being played simultaneously.
+static const size_t sPacketPoolSize{ 1024 };
+
+/// Unused packets. Packets are taken by the demuxer threads, and returned
+/// by the decoding threads, thus both sides may be used by multiple threads.
+class PacketPool
+{
+public:
+
+    PacketPool()
+        : mPackets(sPacketPoolSize)
+    {
+    }
+
+    ~PacketPool()
+    {
+        Packet* packet{ nullptr };
+        while (mPackets.tryPop(packet))
+        {
+            delete packet;
+        }
+    }
+
+    Packet* get()
+    {
+        Packet* result{ nullptr };
+        if (!mPackets.tryPop(result))
+        {
+            result = new Packet();
+        }
+        return result;
+    }
+
+    void put(Packet* packet)
+    {
+        if (!mPackets.tryPush(packet))
+        {
+            delete packet; // Pool full
+        }
+    }
+
+private:
+
+    RingBuffer<Packet*, RingBufferProducers::Multiple> mPackets;
+};
+
+static PacketPool sPacketPool;
+
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
 //////////////////////////////////////////////////////////////////////////
 
-Packet::Packet(AVPacket* packet)
-    :	mPacket(new AVPacket())
+// static
+PacketPtr Packet::take(AVPacket* packet)
 {
-    int retval = av_copy_packet(mPacket,packet);
-    ASSERT_MORE_THAN_EQUALS_ZERO(retval)(avcodecErrorString(retval));;
+    Packet* result{ sPacketPool.get() };
+    if (packet->buf != nullptr)
+    {
+        av_packet_move_ref(result->mPacket, packet); // No copy of the data.
+    }
+    else
+    {
+        // Data not reference counted (owned by the demuxer). Make a reference counted copy.
+        int retval{ av_packet_ref(result->mPacket, packet) };
+        ASSERT_MORE_THAN_EQUALS_ZERO(retval)(avcodecErrorString(retval));
+        av_packet_unref(packet);
+    }
+    return PacketPtr(result);
+}
+
+Packet::Packet()
+    :	mPacket(av_packet_alloc())
+{
+    ASSERT_NONZERO(mPacket);
 }
 
 Packet::~Packet()
 {
-    if (mPacket->data)
-    {
-        av_packet_unref(mPacket);
-    }
-    delete mPacket;
+    av_packet_free(&mPacket); // Also unreferences any data
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -53,4 +117,22 @@ int Packet::getSizeInBytes()
     return mPacket->size;
 }
 
-} // namespace
+//////////////////////////////////////////////////////////////////////////
+// REFERENCE COUNTING
+//////////////////////////////////////////////////////////////////////////
+
+void intrusive_ptr_add_ref(Packet* packet)
+{
+    packet->mReferences.fetch_add(1, std::memory_order_relaxed);
+}
+
+void intrusive_ptr_release(Packet* packet)
+{
+    if (packet->mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        av_packet_unref(packet->mPacket);
+        sPacketPool.put(packet);
+    }
+}
+
+} // namespace
@@ -0,0 +1,239 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "FilePrefetcher.h"
+
+#include "ClipInterval.h"
+#include "Convert.h"
+#include "File.h"
+#include "FileDemuxerPool.h"
+#include "FileIndex.h"
+#include "FileInput.h"
+#include "FileMetaDataCache.h"
+#include "Sequence.h"
+#include "Track.h"
+#include "UtilPath.h"
+
+namespace model {
+
+/// Amount of playback time (in milliseconds) for which the data is prefetched.
+static const milliseconds sFilePrefetchInterval{ 8000 };
+
+/// Maximum amount of data prefetched for one clip, per update. Avoids
+/// filling the (operating system's) cache with data that is evicted again
+/// before it is used, for very high bitrate files.
+static const int64_t sFilePrefetchMaximumBytes{ 128 * 1024 * 1024 };
+
+/// Part of a file that must be prefetched.
+struct FilePrefetchPart
+{
+    wxFileName Path;
+    pts Begin = 0;  ///< Start position (in the file, with 1:1 speed).
+    pts End = 0;    ///< End position (idem).
+};
+
+/// Requests that must be handled in the background.
+struct FilePrefetcherWork
+{
+    boost::mutex Mutex;
+    std::deque<FilePrefetchPart> Parts;     ///< Not handled yet.
+    bool Scheduled = false;                 ///< True if a background task is handling the parts.
+    bool ForgetFiles = false;               ///< True if the files must be determined again.
+    std::map<wxString, boost::optional<util::path::FileIdentity>> Files; ///< Determined once, instead of for every part. Only accessed by the background task.
+
+    /// Handle one part. Called repeatedly by the background task.
+    /// \return true if more parts may have to be handled.
+    bool step()
+    {
+        FilePrefetchPart part;
+        {
+            boost::mutex::scoped_lock lock(Mutex);
+            if (ForgetFiles)
+            {
+                Files.clear();
+                ForgetFiles = false;
+            }
+            if (Parts.empty())
+            {
+                Scheduled = false;
+                return false;
+            }
+            part = Parts.front();
+            Parts.pop_front();
+        }
+        prefetch(part);
+        return true;
+    }
+
+    void prefetch(const FilePrefetchPart& part)
+    {
+        wxString name{ part.Path.GetFullPath() };
+        auto it = Files.find(name);
+        if (it == Files.end())
+        {
+            it = Files.emplace(name, util::path::getIdentity(part.Path)).first;
+        }
+        if (!it->second || !FileMetaDataCache::exists()) { return; }
+        const util::path::FileIdentity& file{ *(it->second) };
+
+        boost::optional<std::pair<int64_t, int64_t>> range;
+        // NOT: file->getLength() and friends. The file is in use by the playback threads.
+        FileIndexPtr index{ FileMetaDataCache::get().getIndex(part.Path) };
+        if (index)
+        {
+            range = index->getByteRange(Convert::ptsToMicroseconds(part.Begin), Convert::ptsToMicroseconds(part.End));
+        }
+        if (!range)
+        {
+            // Index not available (yet). Estimate the part of the file, assuming a constant bit rate.
+            boost::optional<pts> length{ FileMetaDataCache::get().getLength(part.Path) };
+            if (!length || *length <= 0 || file.Size <= 0) { return; }
+            range.reset(std::make_pair(
+                file.Size * std::max<pts>(part.Begin - 1, 0) / *length,     // -1: Margin for the keyframe before the position.
+                file.Size * std::min<pts>(part.End + 1, *length) / *length));
+        }
+        int64_t length{ std::min(range->second - range->first, sFilePrefetchMaximumBytes) };
+        FileInput::prefetch(file, range->first, length);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FilePrefetcher::FilePrefetcher(const SequencePtr& sequence)
+    : mSequence(sequence)
+    , mWork(boost::make_shared<FilePrefetcherWork>())
+{
+    VAR_DEBUG(this);
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+    VAR_DEBUG(this);
+    boost::mutex::scoped_lock lock(mWork->Mutex);
+    mWork->Parts.clear(); // A running background task stops after the current part.
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INTERFACE
+//////////////////////////////////////////////////////////////////////////
+
+void FilePrefetcher::update(pts position, bool forward)
+{
+    ASSERT(wxThread::IsMain());
+    pts interval{ Convert::timeToPts(sFilePrefetchInterval) };
+    if (mPrefetched && forward == mForward)
+    {
+        std::pair<pts, pts> prefetched{ *mPrefetched };
+        if (position >= prefetched.first && position < prefetched.second)
+        {
+            // Extend once half of the prefetched data has been used.
+            pts remaining{ forward ? prefetched.second - position : position - prefetched.first };
+            if (remaining > interval / 2) { return; }
+            if (forward)
+            {
+                prefetch(prefetched.second, position + interval, false);
+                mPrefetched.reset(std::make_pair(position, position + interval));
+            }
+            else
+            {
+                prefetch(position - interval, prefetched.first, false);
+                mPrefetched.reset(std::make_pair(position - interval, position + 1));
+            }
+            return;
+        }
+    }
+    mForward = forward;
+    std::pair<pts, pts> required{ forward ? std::make_pair(position, position + interval) : std::make_pair(position - interval, position + 1) };
+    prefetch(required.first, required.second, true);
+    mPrefetched.reset(required);
+}
+
+void FilePrefetcher::reset()
+{
+    mPrefetched.reset();
+    boost::mutex::scoped_lock lock(mWork->Mutex);
+    mWork->ForgetFiles = true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+void FilePrefetcher::prefetch(pts begin, pts end, bool restart)
+{
+    if (!DemuxerPool::exists()) { return; }
+    begin = std::max<pts>(begin, 0);
+    std::vector<FilePrefetchPart> parts;
+    for (TrackPtr track : mSequence->getTracks())
+    {
+        if (begin >= end) { break; }
+        for (IClipPtr clip : track->getClips())
+        {
+            pts left{ clip->getLeftPts() };
+            pts right{ clip->getRightPts() };
+            if (right <= begin) { continue; }
+            if (left >= end) { break; }
+            ClipIntervalPtr interval{ boost::dynamic_pointer_cast<ClipInterval>(clip) };
+            if (!interval) { continue; } // Empty clips and transitions (the clips adjacent to a transition are prefetched anyway).
+            FilePtr file{ interval->getFile() };
+            if (!file) { continue; }
+            if (file->getType() != FileType_Video && file->getType() != FileType_Audio) { continue; }
+            pts from{ interval->getOffset() + std::max(begin, left) - left };
+            pts to{ interval->getOffset() + std::min(end, right) - left };
+            FilePrefetchPart part;
+            part.Path = file->getPath();
+            part.Begin = Convert::positionToNormalSpeed(from, interval->getSpeed());
+            part.End = Convert::positionToNormalSpeed(to, interval->getSpeed()) + 1;
+            parts.emplace_back(part);
+        }
+    }
+
+    bool schedule{ false };
+    {
+        boost::mutex::scoped_lock lock(mWork->Mutex);
+        if (restart)
+        {
+            mWork->Parts.clear(); // Not needed anymore.
+        }
+        mWork->Parts.insert(mWork->Parts.end(), parts.begin(), parts.end());
+        schedule = !mWork->Scheduled && !mWork->Parts.empty();
+        mWork->Scheduled = mWork->Scheduled || schedule;
+    }
+    if (schedule)
+    {
+        boost::shared_ptr<FilePrefetcherWork> work{ mWork };
+        DemuxerPool::get().schedule([work] { return work->step(); });
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FilePrefetcher& obj)
+{
+    os  << &obj << '|'
+        << obj.mForward << '|'
+        << obj.mPrefetched << '|'
+        << obj.mWork->Parts.size();
+    return os;
+}
+
+} //namespace
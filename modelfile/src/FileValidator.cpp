@@ -0,0 +1,202 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FileValidator.h"
+
+#include "AutoFolder.h"
+#include "File.h"
+#include "FileMetaDataCache.h"
+#include "FileMetaDataStore.h"
+#include "Project.h"
+#include "UtilThread.h"
+
+namespace model {
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+FileValidator::FileValidator()
+{
+    ASSERT(wxThread::IsMain());
+    collect(Project::get().getRoot());
+    VAR_INFO(mQueue.size());
+    if (!mQueue.empty())
+    {
+        mActive = true;
+        mThread.reset(new boost::thread(std::bind(&FileValidator::thread, this)));
+    }
+}
+
+FileValidator::~FileValidator()
+{
+    VAR_DEBUG(this);
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mStop = true;
+    }
+    if (mThread)
+    {
+        mThread->join();
+    }
+    mActive = false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+// static
+bool FileValidator::isPending(const wxFileName& path)
+{
+    if (!exists()) { return false; }
+    FileValidator& validator{ get() };
+    if (!validator.mActive) { return false; }
+    boost::mutex::scoped_lock lock(validator.mMutex);
+    return validator.mPending.find(path.GetFullPath()) != validator.mPending.end();
+}
+
+// static
+void FileValidator::prioritize(const wxFileName& path)
+{
+    if (!isPending(path)) { return; }
+    FileValidator& validator{ get() };
+    boost::mutex::scoped_lock lock(validator.mMutex);
+    validator.mPriority.emplace_back(path.GetFullPath());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST
+//////////////////////////////////////////////////////////////////////////
+
+void FileValidator::waitUntilDone()
+{
+    ASSERT(!wxThread::IsMain());
+    boost::mutex::scoped_lock lock(mMutex);
+    while (mActive)
+    {
+        mCondition.wait(lock);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+void FileValidator::collect(const NodePtr& node)
+{
+    if (node->isA<AutoFolder>())
+    {
+        node->check(); // Update the folder contents (in the background).
+    }
+    FilePtr file{ boost::dynamic_pointer_cast<File>(node) };
+    if (file)
+    {
+        wxString path{ file->getPath().GetFullPath() }; // NOT: GetLongPath: that accesses the file system.
+        if (mPending.insert(path).second)
+        {
+            mQueue.emplace_back(path);
+        }
+    }
+    for (NodePtr child : node->getChildren())
+    {
+        collect(child);
+    }
+}
+
+void FileValidator::thread()
+{
+    util::thread::setCurrentThreadName("FileValidator");
+    while (true)
+    {
+        wxString path;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (!mPriority.empty() && mPending.find(mPriority.front()) == mPending.end())
+            {
+                mPriority.pop_front(); // Validated already
+            }
+            while (mPriority.empty() && !mQueue.empty() && mPending.find(mQueue.front()) == mPending.end())
+            {
+                mQueue.pop_front(); // Validated already (was prioritized)
+            }
+            if (mStop || (mPriority.empty() && mQueue.empty()))
+            {
+                break;
+            }
+            std::deque<wxString>& queue{ mPriority.empty() ? mQueue : mPriority };
+            path = queue.front();
+            queue.pop_front();
+            mPending.erase(path); // From now on, lookups validate the cached data themselves.
+        }
+
+        if (!validate(wxFileName(path)))
+        {
+            VAR_WARNING(path);
+            util::thread::RunInMain([path]
+            {
+                if (FileValidator::exists())
+                {
+                    FileValidator::get().handleInvalid(path);
+                }
+            });
+        }
+    }
+    boost::mutex::scoped_lock lock(mMutex);
+    mPending.clear();
+    mActive = false;
+    mCondition.notify_all();
+}
+
+bool FileValidator::validate(const wxFileName& path) const
+{
+    if (!path.FileExists() || !path.IsFileReadable())
+    {
+        return false;
+    }
+    if (FileMetaDataStore::getProperties(path, true) && !FileMetaDataStore::getProperties(path))
+    {
+        return false; // The trusted data was outdated.
+    }
+    if (FileMetaDataCache::exists())
+    {
+        // Validate the project's data here, instead of upon the first use in the main thread.
+        FileMetaDataCache::get().getLength(path);
+    }
+    return true;
+}
+
+void FileValidator::handleInvalid(const wxString& path)
+{
+    ASSERT(wxThread::IsMain());
+    for (NodePtr node : Project::get().getRoot()->findPath(path))
+    {
+        node->check(); // Removes the file (or updates its auto folder), or reads the changed meta data.
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LOGGING
+//////////////////////////////////////////////////////////////////////////
+
+std::ostream& operator<<(std::ostream& os, const FileValidator& obj)
+{
+    os << &obj << '|' << obj.mActive << '|' << obj.mQueue.size() << '|' << obj.mPriority.size();
+    return os;
+}
+
+} // namespace
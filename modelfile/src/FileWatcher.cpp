@@ -19,10 +19,12 @@
 
 #include "AutoFolder.h"
 #include "File.h"
+#include "FileMetaDataCache.h"
 #include "Project.h"
 #include "ProjectEvent.h"
 #include "NodeEvent.h"
 #include "UtilPath.h"
+#include "UtilThread.h"
 #include "UtilVector.h"
 #include "Window.h"
 
@@ -39,10 +41,12 @@ FileWatcher::FileWatcher()
     gui::Window::get().Bind(model::EVENT_ADD_NODE,     &FileWatcher::onProjectAssetAdded,    this);
     gui::Window::get().Bind(model::EVENT_ADD_NODES,    &FileWatcher::onProjectAssetsAdded,   this);
     gui::Window::get().Bind(model::EVENT_REMOVE_NODE,  &FileWatcher::onProjectAssetRemoved,  this);
+    gui::Window::get().Bind(model::EVENT_REMOVE_NODES, &FileWatcher::onProjectAssetsRemoved, this);
     gui::Window::get().Bind(model::EVENT_RENAME_NODE,  &FileWatcher::onProjectAssetRenamed,  this);
 
     start();
     watchAll(Project::get().getRoot());
+    index(Project::get().getRoot());
 }
 
 FileWatcher::~FileWatcher()
@@ -52,9 +56,12 @@ FileWatcher::~FileWatcher()
     gui::Window::get().Unbind(model::EVENT_ADD_NODE,       &FileWatcher::onProjectAssetAdded,    this);
     gui::Window::get().Unbind(model::EVENT_ADD_NODES,      &FileWatcher::onProjectAssetsAdded,   this);
     gui::Window::get().Unbind(model::EVENT_REMOVE_NODE,    &FileWatcher::onProjectAssetRemoved,  this);
+    gui::Window::get().Unbind(model::EVENT_REMOVE_NODES,   &FileWatcher::onProjectAssetsRemoved, this);
     gui::Window::get().Unbind(model::EVENT_RENAME_NODE,    &FileWatcher::onProjectAssetRenamed,  this);
 
     mWatches.clear();
+    mPaths.clear();
+    mPendingChecks.clear();
     stop();
 }
 
@@ -98,23 +105,31 @@ void FileWatcher::onChange(wxFileSystemWatcherEvent& event)
         // - Second, modify events are given while the file contents is updated.
         {
             wxFileName changedPath = event.GetPath();
-            model::NodePtrs nodes = model::Project::get().getRoot()->findPath(changedPath.GetLongPath());
-            if (!nodes.empty())
+            if (FileMetaDataCache::exists())
             {
-                // Existing file: update
-                for ( model::NodePtr node : nodes )
-                {
-                    node->check();
-                }
+                // For warnings (lost events) the path is empty, causing all files to be validated again.
+                FileMetaDataCache::get().invalidate(changedPath);
             }
-            else
+            model::NodePtrs nodes = findPath(changedPath);
+            if (nodes.empty())
             {
                 changedPath.SetFullName(""); // Take the folder (this is probably a file that has just been created)
-                model::NodePtrs nodes = model::Project::get().getRoot()->findPath(changedPath.GetLongPath());
-                for ( model::NodePtr node : nodes )
+                nodes = findPath(changedPath);
+            }
+            if (!nodes.empty())
+            {
+                if (mPendingChecks.empty())
                 {
-                    node->check();
+                    // Handle all events that arrive in the meantime in one batch.
+                    util::thread::RunInMain([]
+                    {
+                        if (FileWatcher::exists())
+                        {
+                            FileWatcher::get().checkPending();
+                        }
+                    });
                 }
+                mPendingChecks.insert(nodes.begin(), nodes.end());
             }
             break;
         }
@@ -132,6 +147,7 @@ void FileWatcher::onChange(wxFileSystemWatcherEvent& event)
 void FileWatcher::onProjectAssetAdded(model::EventAddNode &event)
 {
     watch( event.getValue().getChild() );
+    index( event.getValue().getChild() );
     event.Skip();
 }
 
@@ -140,6 +156,7 @@ void FileWatcher::onProjectAssetsAdded(model::EventAddNodes &event)
     for ( model::NodePtr node : event.getValue().getChildren() )
     {
         watch( node );
+        index( node );
     }
     event.Skip();
 }
@@ -147,20 +164,32 @@ void FileWatcher::onProjectAssetsAdded(model::EventAddNodes &event)
 void FileWatcher::onProjectAssetRemoved(model::EventRemoveNode &event)
 {
     unwatch( event.getValue().getChild() );
+    unindex( event.getValue().getChild() );
     event.Skip();
 }
 
 void FileWatcher::onProjectAssetsRemoved(model::EventRemoveNodes &event)
 {
+    // Upon removal the children no longer have a parent. Children of an auto folder
+    // were never watched themselves (the auto folder is), see requiredWatchPath().
+    bool watched{ !event.getValue().getParent()->isA<model::AutoFolder>() };
     for ( model::NodePtr node : event.getValue().getChildren() )
     {
-        unwatch( node );
+        if (watched)
+        {
+            unwatch( node );
+        }
+        unindex( node );
     }
     event.Skip();
 }
 
 void FileWatcher::onProjectAssetRenamed(model::EventRenameNode &event)
 {
+    // Nodes that correspond to a file/dir on disk derive their name from their
+    // path. Still, re-index to keep the index in sync with the tree in any case.
+    unindex( event.getValue().getNode() );
+    index( event.getValue().getNode() );
     event.Skip();
 }
 
@@ -199,6 +228,64 @@ void FileWatcher::watchAll(const model::NodePtr& node)
     }
 }
 
+void FileWatcher::index(const model::NodePtr& node)
+{
+    model::IPathPtr pathOnDisk = boost::dynamic_pointer_cast<model::IPath>(node);
+    if (pathOnDisk)
+    {
+        mPaths[util::path::toPath(pathOnDisk->getPath())].insert(node);
+    }
+    for (model::NodePtr child : node->getChildren())
+    {
+        index(child);
+    }
+}
+
+void FileWatcher::unindex(const model::NodePtr& node)
+{
+    model::IPathPtr pathOnDisk = boost::dynamic_pointer_cast<model::IPath>(node);
+    if (pathOnDisk)
+    {
+        MapPathToNodes::iterator it = mPaths.find(util::path::toPath(pathOnDisk->getPath()));
+        if (it != mPaths.end())
+        {
+            it->second.erase(node);
+            if (it->second.empty())
+            {
+                mPaths.erase(it);
+            }
+        }
+    }
+    mPendingChecks.erase(node);
+    for (model::NodePtr child : node->getChildren())
+    {
+        unindex(child);
+    }
+}
+
+model::NodePtrs FileWatcher::findPath(const wxFileName& path) const
+{
+    model::NodePtrs result;
+    MapPathToNodes::const_iterator it = mPaths.find(util::path::toPath(path));
+    if (it != mPaths.end())
+    {
+        result.assign(it->second.begin(), it->second.end());
+    }
+    return result;
+}
+
+void FileWatcher::checkPending()
+{
+    ASSERT(wxThread::IsMain());
+    NodeSet nodes;
+    std::swap(nodes, mPendingChecks); // check() may cause new events
+    VAR_DEBUG(nodes.size());
+    for ( model::NodePtr node : nodes )
+    {
+        node->check();
+    }
+}
+
 void FileWatcher::watch(const model::NodePtr& node)
 {
     boost::optional<wxString> requiresWatch = requiredWatchPath(node);
@@ -28,6 +28,17 @@ namespace model {
 
 struct IndexAutoFolderWork;
 
+/// State of one directory entry, as seen during the last indexing of a folder.
+struct AutoFolderEntry
+{
+    wxFileOffset Size = 0;
+    time_t Modified = 0;
+
+    bool operator==(const AutoFolderEntry& other) const { return Size == other.Size && Modified == other.Modified; }
+    bool operator!=(const AutoFolderEntry& other) const { return !(*this == other); }
+};
+typedef std::map<wxString, AutoFolderEntry> AutoFolderEntries;
+
 class AutoFolder
     :   public Folder
     ,   public IPath
@@ -52,7 +63,12 @@ public:
 
     NodePtrs findPath(const wxString& path) override;
     bool mustBeWatched(const wxString& path) override;
-    void check(bool immediately = false) override; ///< Update the autofolder children. The folder is synced with the filesystem.
+    /// Update the autofolder children. The folder is synced with the filesystem.
+    /// \param immediately if false, the update is done in the background, and
+    ///        postponed until no more check() calls arrive for a short while.
+    ///        Thus, a burst of file system events (for instance, a camera ingest
+    ///        writing many files) results in only one update.
+    void check(bool immediately = false) override;
 
     //////////////////////////////////////////////////////////////////////////
     // IPATH
@@ -65,6 +81,9 @@ public:
 
     void handleWorkDone(boost::shared_ptr<IndexAutoFolderWork> work, bool immediately);
 
+    /// Called when no more check() calls arrived during the debounce interval.
+    void onDebounceTimer(wxTimerEvent& event);
+
     //////////////////////////////////////////////////////////////////////////
     // ATTRIBUTES
     //////////////////////////////////////////////////////////////////////////
@@ -84,6 +103,14 @@ private:
     wxFileName mPath;
     boost::shared_ptr<IndexAutoFolderWork> mCurrentUpdate;
     bool mUpdateAgain; ///< True if an update event was received while an update was already scheduled. To avoid a new file being found twice, no two updates are scheduled simultaneously.
+    AutoFolderEntries mEntries; ///< Directory contents as seen during the last update. Only entries that differ from these are probed again. Not serialized: after loading, all non-child entries are probed once.
+    std::unique_ptr<wxTimer> mDebounce = nullptr; ///< Postpones background updates until a burst of check() calls has ended. Created upon first use, in the main thread.
+
+    //////////////////////////////////////////////////////////////////////////
+    // HELPER METHODS
+    //////////////////////////////////////////////////////////////////////////
+
+    void scheduleUpdate();
 
     //////////////////////////////////////////////////////////////////////////
     // SERIALIZATION
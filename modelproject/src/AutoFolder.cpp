@@ -24,12 +24,16 @@
 #include "UtilPath.h"
 #include "UtilSerializeBoost.h"
 #include "UtilSerializeWxwidgets.h"
+#include "UtilThread.h"
 #include "UtilVector.h"
 #include "Worker.h"
 #include "WorkEvent.h"
 
 namespace model {
 
+/// Time (in ms) that must pass without any check() call, before a background update is started.
+static const int sAutoFolderDebounceInterval{ 500 };
+
 //////////////////////////////////////////////////////////////////////////
 // WORK OBJECT FOR INDEXING A FOLDER
 //////////////////////////////////////////////////////////////////////////
@@ -39,10 +43,11 @@ struct IndexAutoFolderWork
 {
     // Here, all access to folder must be done, not in the worker thread.
     // Rationale: all access to model objects must be done in the main thread!
-    explicit IndexAutoFolderWork(const AutoFolderPtr& folder)
+    IndexAutoFolderWork(const AutoFolderPtr& folder, const AutoFolderEntries& entries)
         : worker::Work(std::bind(&IndexAutoFolderWork::indexFiles,this))
         , mFolder(folder)
         , mPath(folder->getPath())
+        , mPreviousEntries(entries)
     {
         ASSERT(mPath.IsDir() && mPath.IsAbsolute())(mPath);
         for ( NodePtr child : mFolder->getChildren() )
@@ -71,31 +76,50 @@ struct IndexAutoFolderWork
             ASSERT(dir.IsOpened());
             wxString nodename;
 
-            wxArrayString allfiles;
-            size_t count = wxDir::GetAllFiles(mPath.GetLongPath(), &allfiles, wxEmptyString, wxDIR_FILES);
-            showProgressBar(count);
-            int progress = 0;
-
-            // Find all files
+            // List the folder once, and only probe the entries that are new or
+            // changed since the previous update. Entries that were probed before
+            // (and could not be opened) are skipped, unless they changed since.
+            std::vector<wxFileName> probes;
+            std::set<wxString> existing(mRemove.begin(), mRemove.end());
             for (bool cont = dir.GetFirst(&nodename,wxEmptyString,wxDIR_FILES); cont; cont = dir.GetNext(&nodename))
             {
                 if (isAborted()) { return; }
-                if (UtilVector<wxString>(mRemove).hasElement(nodename)) // Existing element. Do not remove
+                wxFileName filename(mPath.GetLongPath(), nodename);
+                AutoFolderEntry entry;
+                wxStructStat status;
+                if (wxStat(filename.GetLongPath(), &status) == 0)
+                {
+                    entry.Size = status.st_size;
+                    entry.Modified = status.st_mtime;
+                }
+                mEntries[nodename] = entry;
+
+                if (existing.find(nodename) != existing.end()) // Existing element. Do not remove. Changes are handled by the file node itself.
                 {
                     UtilVector<wxString>(mRemove).removeElements({ nodename });
                 }
-                else // New element. Add
+                else
+                {
+                    AutoFolderEntries::const_iterator previous{ mPreviousEntries.find(nodename) };
+                    if (previous == mPreviousEntries.end() || previous->second != entry) // New or changed element.
+                    {
+                        probes.emplace_back(filename);
+                    }
+                }
+            }
+
+            VAR_DEBUG(mEntries.size())(probes.size());
+            if (!probes.empty())
+            {
+                showProgressBar(narrow_cast<int>(probes.size()));
+                std::vector<model::FilePtr> files{ probeFiles(probes, pathname) };
+                for (model::FilePtr file : files)
                 {
-                    wxFileName filename(mPath.GetLongPath(), nodename);
-                    // TRANSLATORS: %s == Directory which is indexed
-                    showProgressText(wxString::Format(_("Updating %s"), pathname + nodename));
-                    model::FilePtr file = boost::make_shared<model::File>(filename);
-                    if (file->canBeOpened())
+                    if (file)
                     {
-                        mAdd.emplace_back(file);
+                        mAdd.emplace_back(file); // Directory order is kept.
                     }
                 }
-                showProgress(++progress);
             }
 
             if (wxThread::IsMain())
@@ -115,10 +139,34 @@ struct IndexAutoFolderWork
         }
     }
 
+    /// Open the given files, using multiple threads (opening a file is
+    /// dominated by waiting for the disk).
+    /// \return for each given file, the opened file or nullptr if it could not be opened.
+    std::vector<model::FilePtr> probeFiles(const std::vector<wxFileName>& probes, const wxString& pathname)
+    {
+        std::vector<model::FilePtr> result(probes.size());
+        std::atomic<int> progress{ 0 };
+        util::thread::runParallel(probes.size(), "IndexFiles", [this, &probes, &pathname, &result, &progress](size_t index)
+        {
+            if (isAborted()) { return false; }
+            // TRANSLATORS: %s == Directory which is indexed
+            showProgressText(wxString::Format(_("Updating %s"), pathname + probes[index].GetFullName()));
+            model::FilePtr file = boost::make_shared<model::File>(probes[index]);
+            if (file->canBeOpened())
+            {
+                result[index] = file;
+            }
+            showProgress(++progress);
+            return true;
+        });
+        return result;
+    }
+
     AutoFolderPtr mFolder;                 ///< Folder to be indexed
     bool mDirExists = false;               ///< true if the dir could be opened, false if not (then, assume that it was removed)
     wxFileName mPath;                      ///< Path to the folder to be indexed
-    std::vector<wxString> mCurrentEntries; ///< All entries known when the work was scheduled
+    AutoFolderEntries mPreviousEntries;    ///< All entries known when the work was scheduled
+    AutoFolderEntries mEntries;            ///< When done, holds all entries currently in the folder
     NodePtrs mAdd;                         ///< When done, holds the list of nodes that must be added
     std::vector<wxString> mRemove;         ///< All entries to be removed when indexing is done
 };
@@ -149,6 +197,11 @@ AutoFolder::AutoFolder(const wxFileName& path)
 AutoFolder::~AutoFolder()
 {
     VAR_DEBUG(this);
+    if (mDebounce)
+    {
+        mDebounce->Stop();
+        mDebounce->Unbind(wxEVT_TIMER, &AutoFolder::onDebounceTimer, this);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -181,24 +234,22 @@ void AutoFolder::check(bool immediately)
     ASSERT_IMPLIES(getParent(), !getParent()->isA<model::AutoFolder>());
     if (immediately)
     {
-        boost::shared_ptr<IndexAutoFolderWork>  work = boost::make_shared<IndexAutoFolderWork>(boost::dynamic_pointer_cast<AutoFolder>(self()));
+        if (mDebounce)
+        {
+            mDebounce->Stop(); // Pending update no longer required.
+        }
+        boost::shared_ptr<IndexAutoFolderWork>  work = boost::make_shared<IndexAutoFolderWork>(boost::dynamic_pointer_cast<AutoFolder>(self()), mEntries);
         work->indexFiles();
         handleWorkDone(work,true);
     }
     else
     {
-        if (mCurrentUpdate)
-        {
-            mUpdateAgain = true; // When mCurrentUpdate is finished, another will be scheduled.
-            VAR_DEBUG(mPath)(mUpdateAgain);
-        }
-        else
+        if (!mDebounce)
         {
-            VAR_DEBUG(mPath);
-            mCurrentUpdate = boost::make_shared<IndexAutoFolderWork>(boost::dynamic_pointer_cast<AutoFolder>(self()));
-            mCurrentUpdate->Bind(worker::EVENT_WORK_DONE, &AutoFolder::onWorkDone, this); // No unbind: work object is destroyed when done
-            worker::VisibleWorker::get().schedule(mCurrentUpdate);
+            mDebounce = std::make_unique<wxTimer>();
+            mDebounce->Bind(wxEVT_TIMER, &AutoFolder::onDebounceTimer, this);
         }
+        mDebounce->StartOnce(sAutoFolderDebounceInterval); // Restarts the timer if it was running already.
     }
     return;
 }
@@ -222,6 +273,12 @@ void AutoFolder::onWorkDone(worker::WorkDoneEvent& event)
     handleWorkDone(work,false);
 }
 
+void AutoFolder::onDebounceTimer(wxTimerEvent& event)
+{
+    ASSERT(wxThread::IsMain());
+    scheduleUpdate();
+}
+
 void AutoFolder::handleWorkDone(boost::shared_ptr<IndexAutoFolderWork> work, bool immediately)
 {
     if (!work->mDirExists)
@@ -242,6 +299,8 @@ void AutoFolder::handleWorkDone(boost::shared_ptr<IndexAutoFolderWork> work, boo
     }
     else
     {
+        mEntries = work->mEntries;
+
         if (!work->mAdd.empty())
         {
             addChildren(work->mAdd); // Add all at once, for better performance (less UI updates)
@@ -274,7 +333,7 @@ void AutoFolder::handleWorkDone(boost::shared_ptr<IndexAutoFolderWork> work, boo
 
         if (mUpdateAgain)
         {
-            check();
+            scheduleUpdate();
         }
     }
     mUpdateAgain = false;
@@ -300,6 +359,27 @@ wxString AutoFolder::getSequenceName() const
     return util::path::toName(mPath);
 }
 
+//////////////////////////////////////////////////////////////////////////
+// HELPER METHODS
+//////////////////////////////////////////////////////////////////////////
+
+void AutoFolder::scheduleUpdate()
+{
+    ASSERT(wxThread::IsMain());
+    if (mCurrentUpdate)
+    {
+        mUpdateAgain = true; // When mCurrentUpdate is finished, another will be scheduled.
+        VAR_DEBUG(mPath)(mUpdateAgain);
+    }
+    else
+    {
+        VAR_DEBUG(mPath);
+        mCurrentUpdate = boost::make_shared<IndexAutoFolderWork>(boost::dynamic_pointer_cast<AutoFolder>(self()), mEntries);
+        mCurrentUpdate->Bind(worker::EVENT_WORK_DONE, &AutoFolder::onWorkDone, this); // No unbind: work object is destroyed when done
+        worker::VisibleWorker::get().schedule(mCurrentUpdate);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // SERIALIZATION
 //////////////////////////////////////////////////////////////////////////
@@ -175,7 +175,7 @@ std::istream& Project::LoadObject(std::istream& istream)
         ar & boost::serialization::make_nvp(sView.c_str(),IView::getView());
         EventOpenProject event(false);
         IView::getView().ProcessModelEvent(event);
-        mRoot->check();
+        // NOT: mRoot->check(); -- Opening the files is avoided. They are validated in the background (FileValidator), started via the open event.
     }
     catch (boost::exception &e)
     {
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "File.h"
+#include "FileIndex.h"
 #include "IVideo.h"
 
 namespace model {
@@ -84,6 +85,11 @@ private:
     VideoFramePtr mDeliveredFrame;  ///< The most recently returned frame in getNext. The pts value stored in this frame is the pts in the input time base (thus, the timebase of the file, and not the timebase of the project).
     SwsContext* mSwsContext;        ///< Software scaling context
     pts mVideoPacketPts;            ///< (input) pts value for most recent packet fed into the decoder.
+    pts mDecodedPts;                ///< (input) pts value of the most recently decoded frame, also if that frame was skipped. AV_NOPTS_VALUE if unknown.
+    FileIndexPtr mIndex;            ///< Keyframe index, used for dropping packets when skipping frames. nullptr if not (yet) available.
+    int mDecodingThreads;           ///< Number of threads claimed from the global decoding thread budget (0 if not decoding).
+    int mLowres;                    ///< Decoding is done at 1/2^mLowres of the full resolution (0: full resolution).
+    wxSize mCodecSize;              ///< Full resolution size of the video. Note that when decoding with lowres, the codec holds the reduced size.
 
     //////////////////////////////////////////////////////////////////////////
     // HELPER METHODS
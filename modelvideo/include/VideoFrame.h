@@ -17,14 +17,14 @@
 
 #pragma once
 
-#include "UtilFifo.h"
+#include "UtilRingBuffer.h"
 #include "UtilRTTI.h"
 
 namespace model {
 
 class VideoCompositionParameters;
 
-typedef Fifo<VideoFramePtr> FifoVideo;
+typedef RingBuffer<VideoFramePtr, RingBufferProducers::Multiple> FifoVideo; ///< Multiple: the audio buffer thread may insert the end marker upon errors.
 
 /// Division of functionality between VideoFrame and VideoFrameLayer:
 /// VideoFrame holds
@@ -19,6 +19,7 @@
 
 #include "Track.h"
 #include "IVideo.h"
+#include "VideoCompositionParameters.h"
 
 namespace model {
 
@@ -62,6 +63,13 @@ protected:
 
 private:
 
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    VideoFramePtr mLookaheadFrame = nullptr;    ///< First frame of the next clip, retrieved in advance.
+    VideoCompositionParameters mLookaheadParameters; ///< Parameters used for retrieving mLookaheadFrame.
+
     //////////////////////////////////////////////////////////////////////////
     // SERIALIZATION
     //////////////////////////////////////////////////////////////////////////
@@ -21,6 +21,7 @@
 #include "VideoFile.h"
 
 #include "Convert.h"
+#include "FileMetaDataCache.h"
 #include "Node.h"
 #include "Properties.h"
 #include "UtilInitAvcodec.h"
@@ -56,6 +57,11 @@ VideoFile::VideoFile()
     ,   mDeliveredFrame()
     ,   mSwsContext(0)
     ,   mVideoPacketPts(AV_NOPTS_VALUE)
+    ,   mDecodedPts(AV_NOPTS_VALUE)
+    ,   mIndex(nullptr)
+    ,   mDecodingThreads(0)
+    ,   mLowres(0)
+    ,   mCodecSize(0,0)
 {
     VAR_DEBUG(*this);
 }
@@ -66,6 +72,11 @@ VideoFile::VideoFile(const wxFileName& path)
     ,   mDeliveredFrame()
     ,   mSwsContext(0)
     ,   mVideoPacketPts(AV_NOPTS_VALUE)
+    ,   mDecodedPts(AV_NOPTS_VALUE)
+    ,   mIndex(nullptr)
+    ,   mDecodingThreads(0)
+    ,   mLowres(0)
+    ,   mCodecSize(0,0)
 {
     VAR_DEBUG(*this);
 }
@@ -76,6 +87,11 @@ VideoFile::VideoFile(const VideoFile& other)
     ,   mDeliveredFrame()
     ,   mSwsContext(0)
     ,   mVideoPacketPts(AV_NOPTS_VALUE)
+    ,   mDecodedPts(AV_NOPTS_VALUE)
+    ,   mIndex(nullptr)
+    ,   mDecodingThreads(0)
+    ,   mLowres(0)
+    ,   mCodecSize(0,0)
 {
     VAR_DEBUG(*this);
 }
@@ -100,6 +116,7 @@ void VideoFile::moveTo(pts position)
     stopDecodingVideo();
 
     mDeliveredFrame.reset();
+    mDecodedPts = AV_NOPTS_VALUE;
 
     File::moveTo(position); // NOTE: This uses the pts in 'project' timebase units
 }
@@ -111,6 +128,7 @@ void VideoFile::clean()
     stopDecodingVideo();
 
     mDeliveredFrame.reset();
+    mDecodedPts = AV_NOPTS_VALUE;
 
     File::clean();
 }
@@ -133,7 +151,7 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
 
     ASSERT_ZERO(codec->refcounted_frames); // for new version of avcodec, see avcodec_decode_video2 docs
 
-    wxSize codecSize(codec->width,getCodec()->height);
+    wxSize codecSize{ mLowres > 0 ? mCodecSize : wxSize(codec->width, codec->height) };
     rational64 dummy;
     // The true ensures that the bounding box is filled. This guarantees that - for plain video clips - the resulting
     // frames completely fill the bounding box, regardless of the chosen scaling for the preview window. When using false
@@ -141,7 +159,7 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
     // the two frames when showing a 'push' transition.
     //
     // Resizing such that 'everything fits' inside the bounding box is already done in VideoClip.
-    wxSize size(Convert::sizeInBoundingBox(wxSize(codec->width,codec->height),parameters.getBoundingBox(), dummy, true));
+    wxSize size(Convert::sizeInBoundingBox(codecSize, parameters.getBoundingBox(), dummy, true));
     static const int sMinimumFrameSize = 10;        // I had issues when generating smaller bitmaps. To avoid these, always
     size.x = std::max(size.x,sMinimumFrameSize);    // use a minimum framesize. The region of interest in videoclips will ensure
     size.y = std::max(size.y,sMinimumFrameSize);    // that any excess data is cut off.
@@ -195,6 +213,41 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
 
     pts decodedFramePts = AV_NOPTS_VALUE;
 
+    if (parameters.getSkip() &&
+        parameters.hasPts() &&
+        mDecodedPts != AV_NOPTS_VALUE &&
+        frameTimeOk(mDecodedPts))
+    {
+        // Catching up: the decoder is already at (or beyond) the required position.
+        // Nothing needs to be decoded for this (skipped) frame.
+        VideoFramePtr skipFrame{ boost::make_shared<VideoSkipFrame>(parameters) };
+        skipFrame->setPts(mDecodedPts);
+        return skipFrame;
+    }
+
+    // When catching up, avoid decoding frames that are not needed:
+    // - Non-reference frames are not decoded at all.
+    // - If there is a keyframe between the current and the required position,
+    //   all packets before that keyframe are dropped without decoding.
+    codec->skip_frame = parameters.getSkip() ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    int64_t dropUntil{ AV_NOPTS_VALUE };
+    if (parameters.getSkip() &&
+        parameters.hasPts() &&
+        mIndex != nullptr)
+    {
+        int64_t required{ boost::rational_cast<int64_t>(rational64(Convert::ptsToTime(parameters.getPts())) / (rational64(inputTimeBase) * 1000)) };
+        if (stream->start_time != AV_NOPTS_VALUE)
+        {
+            required += stream->start_time;
+        }
+        boost::optional<int64_t> keyframe{ mIndex->getKeyFrame(stream->index, required) };
+        if (keyframe && (mVideoPacketPts == AV_NOPTS_VALUE || *keyframe > mVideoPacketPts))
+        {
+            dropUntil = *keyframe;
+        }
+    }
+    int nDropped{ 0 };
+
     VideoFramePtr result = mDeliveredFrame;
     if (!result || !frameTimeOk(result->getPts()))
     {
@@ -207,6 +260,26 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
         {
             AVPacket* nextToBeDecodedPacket = 0;
             PacketPtr packet = getNextPacket();
+            if (packet && dropUntil != AV_NOPTS_VALUE)
+            {
+                AVPacket* candidate{ packet->getPacket() };
+                int64_t candidatePts{ candidate->pts != AV_NOPTS_VALUE ? candidate->pts : candidate->dts };
+                if ((candidate->flags & AV_PKT_FLAG_KEY) == 0 ||
+                    candidatePts == AV_NOPTS_VALUE ||
+                    candidatePts < dropUntil)
+                {
+                    ++nDropped;
+                    continue;
+                }
+                // Keyframe reached. Decoding restarts here: discard any decoder state
+                // referring to the dropped packets.
+                dropUntil = AV_NOPTS_VALUE;
+                if (nDropped > 0)
+                {
+                    VAR_DEBUG(nDropped)(candidatePts);
+                    avcodec_flush_buffers(codec);
+                }
+            }
             if (packet)
             {
                 nextToBeDecodedPacket = packet->getPacket();
@@ -267,6 +340,7 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
                     decodedFramePts = AV_NOPTS_VALUE;
                     VAR_WARNING(*this)(decodedFramePts); // Could not deduce pts value.
                 }
+                mDecodedPts = decodedFramePts;
 
                 if (!frameTimeOk(decodedFramePts))
                 {
@@ -301,8 +375,9 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
         if (parameters.getSkip())
         {
             // Output frame is not required, only advancement of position in file.
-            // Note that decoding is required to determine proper frame pts values
-            // (and thus determine proper advancenment of position in file).
+            // Note that decoding (of the reference frames) is required to determine
+            // proper frame pts values (and thus determine proper advancement of position
+            // in file).
             result = boost::make_shared<VideoSkipFrame>(parameters);
         }
         else
@@ -312,14 +387,15 @@ VideoFramePtr VideoFile::getNextVideo(const VideoCompositionParameters& paramete
             int bufferSize = av_image_get_buffer_size(AV_PIX_FMT_RGB24, size.GetWidth(), size.GetHeight(), 1);
             boost::uint8_t * buffer = static_cast<boost::uint8_t*>(av_malloc(bufferSize * sizeof(uint8_t)));
             av_image_fill_arrays(pScaledFrame->data, pScaledFrame->linesize, buffer, AV_PIX_FMT_RGB24, size.GetWidth(), size.GetHeight(), 1);
-            mSwsContext = sws_getCachedContext(mSwsContext,codec->width,
-                codec->height,
+            // Use the decoded frame's size, which is reduced when decoding with lowres.
+            mSwsContext = sws_getCachedContext(mSwsContext,pDecodedFrame->width,
+                pDecodedFrame->height,
                 codec->pix_fmt,
                 size.GetWidth(),
                 size.GetHeight(),
                 AV_PIX_FMT_RGB24,
                 SWS_BICUBIC, 0, 0, 0);
-            sws_scale(mSwsContext,pDecodedFrame->data,pDecodedFrame->linesize,0,codec->height,pScaledFrame->data,pScaledFrame->linesize);
+            sws_scale(mSwsContext,pDecodedFrame->data,pDecodedFrame->linesize,0,pDecodedFrame->height,pScaledFrame->data,pScaledFrame->linesize);
 
             result =
                 boost::make_shared<VideoFrame>(parameters,
@@ -373,6 +449,10 @@ wxSize VideoFile::getSize()
         // File could not be opened (deleted?)
         return  Properties::get().getVideoSize();
     }
+    if (mLowres > 0)
+    {
+        return mCodecSize;
+    }
     return wxSize(codec->width, codec->height);
 }
 
@@ -399,42 +479,116 @@ void VideoFile::startDecodingVideo(const VideoCompositionParameters& parameters)
 
     if (!canBeOpened()) { return; } // File could not be opened (deleted?)
 
-    boost::mutex::scoped_lock lock(Avcodec::sMutex);
-
     mDecodingVideo = true;
 
     AVCodecContext* avctx = getCodec();
-    avctx->opaque = this; // Store address to be able to access this object from the avcodec callbacks
-    avctx->get_buffer2 = avcodec_get_buffer;
 
     AVCodec *videoCodec = avcodec_find_decoder(avctx->codec_id);
     ASSERT_NONZERO(videoCodec);
 
-    avctx->workaround_bugs = 1; // Taken from ffplay.c
-    avctx->error_concealment = 3; // Taken from ffplay.c
+    ASSERT_ZERO(mLowres);
+    mCodecSize = wxSize(avctx->width, avctx->height);
+    bool fast{ !parameters.getOptimizeForQuality() };
+    AVDiscard skipLoopFilter{ AVDISCARD_DEFAULT };
 
-    if (!parameters.getOptimizeForQuality())
+    if (fast)
     {
-        avctx->flags |= CODEC_FLAG_EMU_EDGE;
-        avctx->flags2 |= CODEC_FLAG2_FAST;
+        wxSize box{ parameters.getBoundingBox() };
+        if (box.x > 0 && box.y > 0 &&
+            box.x * 2 <= mCodecSize.x &&
+            box.y * 2 <= mCodecSize.y)
+        {
+            // The preview is much smaller than the video. Any artifacts caused by
+            // skipping the loop filter are not visible after scaling down. Furthermore,
+            // decode at reduced resolution, if the codec supports it, but never at a
+            // size smaller than the bounding box. Note that if the bounding box is
+            // enlarged during decoding, the reduced resolution is kept until the
+            // next moveTo.
+            skipLoopFilter = AVDISCARD_ALL;
+            while (mLowres < videoCodec->max_lowres &&
+                (mCodecSize.x >> (mLowres + 1)) >= box.x &&
+                (mCodecSize.y >> (mLowres + 1)) >= box.y)
+            {
+                ++mLowres;
+            }
+        }
+    }
 
-        switch(getCodec()->codec_id)
+    ASSERT_ZERO(mDecodingThreads);
+    int openDecoderThreads{ takeOpenDecoder() };
+    if (openDecoderThreads > 0)
+    {
+        // The decoder was left open, either before the last moveTo, or by another
+        // file object for the same path (via the FileContextCache). That decoder
+        // can be reused if it was opened with the same settings. Note that the
+        // loop filter setting is evaluated per frame, thus it may differ.
+        if (mLowres == 0 &&
+            fast == ((avctx->flags2 & CODEC_FLAG2_FAST) != 0))
         {
-        case AV_CODEC_ID_H264:
-            av_opt_set((void*)getCodec()->priv_data, "profile", "baseline", 0);
-            av_opt_set((void*)getCodec()->priv_data, "preset", "ultrafast", 0);
-            av_opt_set((void*)getCodec()->priv_data, "tune", "zerolatency,fastdecode", 0);
-            av_opt_set((void*)getCodec()->priv_data, "x264opts", "rc-lookahead=0", 0);
-            break;
-        default:
-            break;
+            mDecodingThreads = openDecoderThreads;
+            avcodec_flush_buffers(avctx); // Discard any frames pending from the previous use.
+        }
+        else
+        {
+            {
+                boost::mutex::scoped_lock lock(Avcodec::sMutex);
+                avcodec_close(avctx);
+            }
+            Avcodec::releaseDecodingThreads(openDecoderThreads);
         }
     }
 
-    avctx->flags &= ~CODEC_FLAG_TRUNCATED; // Do not set this, causes bad frames
+    avctx->opaque = this; // Store address to be able to access this object from the avcodec callbacks
+    avctx->get_buffer2 = avcodec_get_buffer;
+    avctx->skip_loop_filter = skipLoopFilter;
+
+    if (mDecodingThreads == 0)
+    {
+        avctx->workaround_bugs = 1; // Taken from ffplay.c
+        avctx->error_concealment = 3; // Taken from ffplay.c
+        avctx->lowres = mLowres;
+
+        if (fast)
+        {
+            avctx->flags |= CODEC_FLAG_EMU_EDGE;
+            avctx->flags2 |= CODEC_FLAG2_FAST;
+
+            switch(getCodec()->codec_id)
+            {
+            case AV_CODEC_ID_H264:
+                av_opt_set((void*)getCodec()->priv_data, "profile", "baseline", 0);
+                av_opt_set((void*)getCodec()->priv_data, "preset", "ultrafast", 0);
+                av_opt_set((void*)getCodec()->priv_data, "tune", "zerolatency,fastdecode", 0);
+                av_opt_set((void*)getCodec()->priv_data, "x264opts", "rc-lookahead=0", 0);
+                break;
+            default:
+                break;
+            }
+        }
+        else
+        {
+            avctx->flags2 &= ~CODEC_FLAG2_FAST; // The codec context may have been used for preview decoding before.
+        }
 
-    int result = avcodec_open2(avctx, videoCodec, 0);
-    ASSERT_MORE_THAN_EQUALS_ZERO(result)(avcodecErrorString(result));
+        avctx->flags &= ~CODEC_FLAG_TRUNCATED; // Do not set this, causes bad frames
+
+        // Use frame and slice threading. Note that thread_safe_callbacks is not set,
+        // which causes avcodec to call avcodec_get_buffer from the thread that calls
+        // avcodec_decode_video2 (when the packet starting the frame is submitted).
+        // Thus, mVideoPacketPts still holds the pts of the packet starting the frame.
+        // Frame threading increases the decoder delay with (thread_count - 1) frames.
+        // These frames are extracted at the end of the file by feeding '0' packets.
+        mDecodingThreads = Avcodec::claimDecodingThreads();
+        avctx->thread_count = mDecodingThreads;
+        avctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+        int result{ 0 };
+        {
+            boost::mutex::scoped_lock lock(Avcodec::sMutex);
+            result = avcodec_open2(avctx, videoCodec, 0);
+        }
+        ASSERT_MORE_THAN_EQUALS_ZERO(result)(avcodecErrorString(result));
+    }
 
     AVStream* stream = getStream();
     ASSERT_NONZERO(stream);
@@ -447,6 +601,8 @@ void VideoFile::startDecodingVideo(const VideoCompositionParameters& parameters)
 
     mVideoPacketPts = stream->cur_dts;
 
+    mIndex = FileMetaDataCache::get().getIndex(getPath());
+
     VAR_DEBUG(this)(getCodec());
 }
 
@@ -456,8 +612,27 @@ void VideoFile::stopDecodingVideo()
 
     if (mDecodingVideo)
     {
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
-        avcodec_close(getCodec());
+        if (mLowres == 0)
+        {
+            // Keep the decoder (and its threads) for the next startDecodingVideo,
+            // after a moveTo or by another file object for the same path.
+            leaveDecoderOpen(mDecodingThreads);
+        }
+        else
+        {
+            {
+                boost::mutex::scoped_lock lock(Avcodec::sMutex);
+                avcodec_close(getCodec());
+            }
+            Avcodec::releaseDecodingThreads(mDecodingThreads);
+
+            // Restore the full resolution size, required for getSize().
+            getCodec()->lowres = 0;
+            getCodec()->width = mCodecSize.x;
+            getCodec()->height = mCodecSize.y;
+            mLowres = 0;
+        }
+        mDecodingThreads = 0;
     }
     if (mSwsContext != 0)
     {
@@ -484,7 +659,9 @@ bool VideoFile::useStream(const AVMediaType& type) const
 std::ostream& operator<<(std::ostream& os, const VideoFile& obj)
 {
     os  << static_cast<const File&>(obj) << '|'
-        << obj.mDecodingVideo;
+        << obj.mDecodingVideo << '|'
+        << obj.mDecodingThreads << '|'
+        << obj.mLowres;
     return os;
 }
 
@@ -48,6 +48,7 @@ VideoTrack* VideoTrack::clone() const
 VideoTrack::~VideoTrack()
 {
     VAR_DEBUG(this);
+    lookahead_cancel(); // Before the members used by the lookahead thread are destructed.
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -58,6 +59,7 @@ void VideoTrack::clean()
 {
     VAR_DEBUG(this);
     Track::clean();
+    mLookaheadFrame.reset(); // Release the frame's memory
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -67,21 +69,58 @@ void VideoTrack::clean()
 VideoFramePtr VideoTrack::getNextVideo(const VideoCompositionParameters& parameters)
 {
     VideoFramePtr videoFrame;
+    VideoFramePtr preparedFrame; // First frame of the current clip, retrieved in advance.
 
     while (!videoFrame && !iterate_atEnd())
     {
         model::IVideoPtr video = boost::dynamic_pointer_cast<IVideo>(iterate_get());
         model::IClipPtr clip = boost::dynamic_pointer_cast<IClip>(iterate_get());
-        videoFrame = video->getNextVideo(VideoCompositionParameters(parameters).adjustPts(-clip->getLeftPts()));
+        VideoCompositionParameters clipParameters{ VideoCompositionParameters(parameters).adjustPts(-clip->getLeftPts()) };
+        if (preparedFrame && mLookaheadParameters == clipParameters)
+        {
+            videoFrame = preparedFrame;
+        }
+        else
+        {
+            if (preparedFrame)
+            {
+                // Retrieved with different parameters (for instance, the preview was resized).
+                clip->moveTo(0);
+            }
+            videoFrame = video->getNextVideo(clipParameters);
+        }
+        preparedFrame.reset();
         if (!videoFrame)
         {
             iterate_next();
             if (!iterate_atEnd())
             {
-                iterate_get()->moveTo(0);
+                if (lookahead_finish(iterate_get()))
+                {
+                    preparedFrame = mLookaheadFrame;
+                }
+                mLookaheadFrame.reset();
+                if (!preparedFrame)
+                {
+                    iterate_get()->moveTo(0);
+                }
             }
         }
     }
+
+    if (videoFrame && parameters.hasPts())
+    {
+        lookahead_start(parameters.getPts(), [this, parameters](const IClipPtr& clip)
+        {
+            // Always prepare a 'non skip' frame. If the first frame of the next clip
+            // must be skipped, the clip is moved again. That is cheap, since then the
+            // file has been opened already.
+            VideoCompositionParameters lookaheadParameters{ VideoCompositionParameters(parameters).setSkip(false).setPts(0) };
+            clip->moveTo(0);
+            mLookaheadFrame = boost::dynamic_pointer_cast<IVideo>(clip)->getNextVideo(lookaheadParameters);
+            mLookaheadParameters = lookaheadParameters;
+        });
+    }
     return videoFrame;
 }
 
@@ -39,6 +39,8 @@ class AudioKeyFrame;
 class AudioTrack;
 class AutoFolder;
 class ClipInterval;
+class Demuxer;
+class DemuxerStream;
 class EmptyChunk;
 class EmptyClip;
 class EmptyFile;
@@ -80,6 +82,8 @@ typedef boost::shared_ptr<AutoFolder> AutoFolderPtr;
 typedef boost::shared_ptr<ClipInterval> ClipIntervalPtr;
 typedef boost::shared_ptr<const IClip> ConstIClipPtr;
 typedef boost::shared_ptr<const Track> ConstTrackPtr;
+typedef boost::shared_ptr<Demuxer> DemuxerPtr;
+typedef boost::shared_ptr<DemuxerStream> DemuxerStreamPtr;
 typedef boost::shared_ptr<EmptyChunk> EmptyChunkPtr;
 typedef boost::shared_ptr<EmptyClip> EmptyClipPtr;
 typedef boost::shared_ptr<EmptyFile> EmptyFilePtr;
@@ -95,7 +99,7 @@ typedef boost::shared_ptr<IPath> IPathPtr;
 typedef boost::shared_ptr<IVideo> IVideoPtr;
 typedef boost::shared_ptr<KeyFrame> KeyFramePtr;
 typedef boost::shared_ptr<MoveParameter> MoveParameterPtr;
-typedef boost::shared_ptr<Packet> PacketPtr;
+typedef boost::intrusive_ptr<Packet> PacketPtr; // Intrusive: packets are recycled, see Packet
 typedef boost::shared_ptr<Properties> PropertiesPtr;
 typedef boost::shared_ptr<Sequence> SequencePtr;
 typedef boost::shared_ptr<Track> TrackPtr;
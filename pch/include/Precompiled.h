@@ -53,18 +53,22 @@ extern "C" {
 #include <cstddef>
 #include <cstdio>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <istream>
+#include <list>
 #include <map>
 #include <memory>
 #include <ostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <boost/archive/archive_exception.hpp>
 #include <boost/archive/xml_iarchive.hpp>
@@ -75,6 +79,7 @@ extern "C" {
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/exception/all.hpp>
 #include <boost/icl/interval_set.hpp>
+#include <boost/intrusive_ptr.hpp>
 #include <boost/limits.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/mpl/list.hpp>
@@ -148,6 +153,7 @@ extern "C" {
 #include <wx/gbsizer.h>
 #include <wx/gdicmn.h>
 #include <wx/graphics.h>
+#include <wx/hashmap.h>
 #include <wx/headercol.h>
 #include <wx/html/htmlwin.h>
 #include <wx/headerctrl.h>
@@ -22,6 +22,7 @@
 
 namespace model {
     class AudioCompositionParameters;
+    class FilePrefetcher;
     class VideoCompositionParameters;
 }
 
@@ -113,6 +114,9 @@ private:
 
     boost::optional< std::pair<pts, pts> > mRange = boost::none;
 
+    /// Reads the data of the clips that will be played next from disk, in advance.
+    std::unique_ptr<model::FilePrefetcher> mPrefetcher;
+
     //////////////////////////////////////////////////////////////////////////
     // AUDIO
     //////////////////////////////////////////////////////////////////////////
@@ -21,6 +21,8 @@
 #include "Config.h"
 #include "Convert.h"
 #include "Dialog.h"
+#include "FileInput.h"
+#include "FilePrefetcher.h"
 #include "Properties.h"
 #include "Sequence.h"
 #include "UtilException.h"
@@ -65,6 +67,7 @@ VideoDisplay::VideoDisplay(wxWindow *parent, model::SequencePtr sequence)
     , mVideoFrames(200)
     , mWidth(200)
     , mHeight(100)
+    , mPrefetcher(std::make_unique<model::FilePrefetcher>(sequence))
 {
     VAR_DEBUG(this);
     mSpeed = std::min(sMaximumSpeed, std::max(sMinimumSpeed, Config::get().read<int>(Config::sPathPreviewDefaultPlaybackSpeed)));
@@ -133,6 +136,10 @@ void VideoDisplay::play()
         // audio packets and is therefore initialized before starting the thread.
         mStartPts = (mCurrentVideoFrame ? mCurrentVideoFrame->getPts() : 0);
 
+        // The sequence may have been edited since the previous playback.
+        mPrefetcher->reset();
+        mPrefetcher->update(mStartPts);
+
         // Start buffering ASAP
         try
         {
@@ -283,6 +290,7 @@ void VideoDisplay::stop()
         mPlaying = false;
         GetEventHandler()->QueueEvent(new PlaybackActiveEvent(false));
 
+        VAR_INFO(model::FileInput::getStatistics()); // Prefetch hit rate
         LOG_DEBUG << "Playback stopped";
     }
 }
@@ -301,6 +309,7 @@ void VideoDisplay::moveTo(pts position)
     // otherwise the Track::moveTo() can interfere with Track::getNext...() when
     // changing the iterator.
     mSequence->moveTo(position);
+    mPrefetcher->update(position, !mCurrentVideoFrame || position >= mCurrentVideoFrame->getPts()); // Scrubbing backwards: prefetch the data before the position.
     GetEventHandler()->QueueEvent(new PlaybackPositionEvent(position));
 
     updateParameters(); // Update, for instance, show bounding box.
@@ -476,8 +485,7 @@ bool VideoDisplay::audioRequested(void *buffer, const unsigned long& frames, dou
                 LOG_DEBUG << "Abort";
                 return false;
             }
-            int chunks = mAudioChunks.getSize(); // lock 1
-            if (chunks == 0)
+            if (!mAudioChunks.tryPop(mCurrentAudioChunk)) // Never blocks (nor locks) in the audio callback
             {
                 // When there is no new chunk, do not block, but return silence.
                 memset(out,0,remainingSamples * model::AudioChunk::sBytesPerSample); // * 2: bytes vs int16
@@ -485,7 +493,6 @@ bool VideoDisplay::audioRequested(void *buffer, const unsigned long& frames, dou
                 return true;
             }
 
-            mCurrentAudioChunk = mAudioChunks.pop(); // lock 2
             if (!mCurrentAudioChunk)
             {
                 LOG_INFO << "End";
@@ -592,15 +599,11 @@ void VideoDisplay::showNextFrame()
 
         VAR_WARNING(mVideoFrames.getSize())(mStartTime)(mAudioLatency)(elapsed)(next)(sleep)(mStartPts)(videoFrame->getPts());
 
-        int skip = mSkipFrames.load();
-        if (skip == 0)
-        {
-            mSkipFrames.store(5);
-        }
-        else
-        {
-            mSkipFrames.store(skip * 2);
-        }
+        // Skip (without decoding, see VideoFile) as many frames as required
+        // for catching up, plus one for the frame that is being decoded
+        // whilst skipping.
+        int behind{ static_cast<int>(-sleep / (model::Convert::ptsToTime(1) * mSpeedFactor)) };
+        mSkipFrames.store(std::max(mSkipFrames.load(), behind + 1));
 
         sleep = model::Convert::ptsToTime(1);
     }
@@ -622,6 +625,8 @@ void VideoDisplay::showNextFrame()
         // which is not desired for 'user initiated moves'.
         GetEventHandler()->QueueEvent(new PlaybackPositionEvent(videoFrame->getPts()));
 
+        mPrefetcher->update(videoFrame->getPts());
+
         Refresh(false);
     }
     mVideoTimer.StartOnce(sleep);
@@ -19,6 +19,7 @@
 
 #include "AutoFolder.h"
 #include "File.h"
+#include "FileValidator.h"
 #include "Folder.h"
 #include "INode.h"
 #include "NodeEvent.h"
@@ -155,6 +156,12 @@ void ProjectViewModel::GetValue( wxVariant &variant, const wxDataViewItem &wxIte
     ASSERT_LESS_THAN_EQUALS(col,GetColumnCount());
 
     model::NodePtr node = model::INode::Ptr(static_cast<model::NodeId>(wxItem.GetID()));
+    if (node->isA<model::File>())
+    {
+        // Only called for visible items. Directly after opening a project,
+        // visible files are validated first.
+        model::FileValidator::prioritize(boost::dynamic_pointer_cast<model::File>(node)->getPath());
+    }
     switch (col)
     {
     case sNameColumn:
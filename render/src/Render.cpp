@@ -571,13 +571,10 @@ void RenderWork::generate()
         //////////////////////////////////////////////////////////////////////////
 
         ASSERT(!(context->flags & AVFMT_NOFILE))(context);
+        if (avio_open(&context->pb, filename.c_str(), AVIO_FLAG_WRITE) < 0)
         {
-            boost::mutex::scoped_lock lock(Avcodec::sMutex);
-            if (avio_open(&context->pb, filename.c_str(), AVIO_FLAG_WRITE) < 0)
-            {
-                VAR_ERROR(filename);
-                throw EncodingError(_("Failed to open file"));
-            }
+            VAR_ERROR(filename);
+            throw EncodingError(_("Failed to open file"));
         }
 
         fileOpened = true;
@@ -963,7 +960,6 @@ void RenderWork::generate()
 
     if (fileOpened)
     {
-        boost::mutex::scoped_lock lock(Avcodec::sMutex);
         avio_close(context->pb);
     }
 
@@ -17,6 +17,10 @@
 
 #pragma once
 
+namespace model {
+class FileIndex;
+}
+
 namespace test {
 
 /// Create sequence with one file each time and then execute the given action.
@@ -30,4 +34,9 @@ void ExecuteOnAllFiles(wxString pathToFiles, std::function<void()> action, bool
 /// \param action action to execute after opening the sequence with the file (parameter is clip number)
 void AddClipsAndExecute(wxString pathToFiles, std::function<void(int)> action);
 
+/// Build the index of a file by reading all its packets (in the calling thread).
+/// \param path media file
+/// \return index of the file
+boost::shared_ptr<model::FileIndex> BuildFileIndex(const wxFileName& path);
+
 } // namespace
@@ -23,4 +23,8 @@ namespace test {
 
 void ASSERT_WATCHED_PATHS_COUNT(int n);
 
+/// Wait until the files of the opened project have been validated, and the
+/// results (for instance, removal of missing files) have been handled.
+void WaitForFileValidation();
+
 } // namespace
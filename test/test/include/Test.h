@@ -122,6 +122,7 @@
 #include "VideoTransitionFactory.h"
 #include "VideoView.h"
 #include "ViewMap.h"
+#include "FileValidator.h"
 #include "FileWatcher.h"
 #include "Window.h"
 #include "Worker.h"
@@ -17,6 +17,9 @@
 
 #include "Test.h"
 
+#include "FileIndex.h"
+#include "FileInput.h"
+
 namespace test {
 
 void ExecuteOnAllFiles(wxString pathToFiles, std::function<void()> action, bool wait)
@@ -116,4 +119,21 @@ void AddClipsAndExecute(wxString pathToFiles, std::function<void(int)> action)
     }
 }
 
+boost::shared_ptr<model::FileIndex> BuildFileIndex(const wxFileName& path)
+{
+    boost::shared_ptr<model::FileIndex> result{ boost::make_shared<model::FileIndex>() };
+    AVFormatContext* context{ nullptr };
+    ASSERT_ZERO(model::FileInput::open(&context, path))(path);
+    ASSERT_MORE_THAN_EQUALS_ZERO(avformat_find_stream_info(context, 0))(path);
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+    AVPacket packet = { 0 };
+    while (av_read_frame(context, &packet) >= 0)
+    {
+        result->add(context, &packet);
+        av_packet_unref(&packet);
+    }
+    model::FileInput::close(&context);
+    return result;
+}
+
 } // namespace
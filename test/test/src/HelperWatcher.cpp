@@ -30,4 +30,11 @@ void ASSERT_WATCHED_PATHS_COUNT(int n)
     ASSERT_EQUALS(currentWatchedPathsCount,n);
 }
 
+void WaitForFileValidation()
+{
+    WaitForIdle;
+    model::FileValidator::get().waitUntilDone();
+    WaitForIdle; // Handle the results in the main thread.
+}
+
 } // namespace
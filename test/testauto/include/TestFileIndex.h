@@ -0,0 +1,45 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "Test.h"
+
+namespace test
+{
+
+class TestFileIndex : public CxxTest::TestSuite // Must be on same line as class definition. Otherwise 'No tests defined error
+    ,   public SuiteCreator<TestFileIndex>
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // TEST CASES
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Only the video keyframes are indexed, seeking positions on these keyframes.
+    void testVideoFile();
+
+    /// The audio is indexed. The embedded cover image is not.
+    void testAudioFile();
+
+    /// Containers with an index of their own are not read entirely.
+    void testContainerIndex();
+};
+
+}
+using namespace test;
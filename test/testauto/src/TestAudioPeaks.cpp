@@ -0,0 +1,101 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TestAudioPeaks.h"
+
+#include "AudioPeaks.h"
+
+namespace test {
+
+/// \return peak with the given minimum, maximum, and negative and positive RMS values
+static model::AudioPeak makePeak(sample minimum, sample maximum, sample negative, sample positive)
+{
+    return model::AudioPeak({ { minimum, maximum }, { negative, positive } });
+}
+
+/// \return peaks with the given values
+static model::AudioPeaks makePeaks(std::initializer_list<model::AudioPeak> peaks)
+{
+    model::AudioPeaks result;
+    result.assign(peaks.begin(), peaks.end());
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST CASES
+//////////////////////////////////////////////////////////////////////////
+
+void TestAudioPeaks::testReduce()
+{
+    StartTestSuite();
+    {
+        StartTest("Empty");
+        ASSERT(model::AudioPeaks().reduce().empty());
+    }
+    {
+        StartTest("One peak is kept as is");
+        model::AudioPeaks peaks{ makePeaks({ makePeak(-100, 200, -30, 40) }) };
+        ASSERT_EQUALS(peaks.reduce(), peaks);
+    }
+    {
+        StartTest("Even number of peaks");
+        model::AudioPeaks peaks{ makePeaks({
+            makePeak(-100, 200, -3, 3),
+            makePeak(-300, 100, -4, 4),
+            makePeak(-10, 20, 0, 100),
+            makePeak(-20, 10, -4, 0) }) };
+        ASSERT_EQUALS(peaks.reduce(), makePeaks({
+            makePeak(-300, 200, -3, 3),     // RMS of 3 and 4 is 3.53: truncated, the sign is kept.
+            makePeak(-20, 20, -2, 70) }));  // RMS of 0 and -4 is -2.82, of 100 and 0 is 70.71.
+    }
+    {
+        StartTest("Odd number of peaks: the last peak is kept as is");
+        model::AudioPeaks peaks{ makePeaks({
+            makePeak(-100, 200, -3, 3),
+            makePeak(-300, 100, -4, 4),
+            makePeak(-10, 20, -5, 6) }) };
+        ASSERT_EQUALS(peaks.reduce(), makePeaks({
+            makePeak(-300, 200, -3, 3),
+            makePeak(-10, 20, -5, 6) }));
+    }
+    {
+        StartTest("Extreme values do not overflow");
+        sample minimum{ std::numeric_limits<sample>::min() };
+        sample maximum{ std::numeric_limits<sample>::max() };
+        model::AudioPeaks peaks{ makePeaks({
+            makePeak(minimum, maximum, minimum, maximum),
+            makePeak(minimum, maximum, minimum, maximum) }) };
+        ASSERT_EQUALS(peaks.reduce(), makePeaks({ makePeak(minimum, maximum, minimum, maximum) }));
+    }
+    {
+        StartTest("Reducing repeatedly ends with one peak");
+        model::AudioPeaks peaks{ makePeaks({
+            makePeak(-1, 1, -1, 1),
+            makePeak(-2, 2, -2, 2),
+            makePeak(-3, 3, -3, 3),
+            makePeak(-4, 4, -4, 4),
+            makePeak(-5, 5, -5, 5) }) };
+        for (size_t size : { 3, 2, 1 })
+        {
+            peaks = peaks.reduce();
+            ASSERT_EQUALS(peaks.size(), size);
+        }
+        ASSERT_EQUALS(peaks.front().first, std::make_pair<sample, sample>(-5, 5));
+    }
+}
+
+} // namespace
@@ -136,7 +136,7 @@ void TestExceptions::testRemovedFileInProjectViewBeforeOpening()
     StartTest("Load document");
     gui::Dialog::get().setConfirmation(); // A confirmation for the dialog showing that the removed file is deleted from project
     WindowTriggerMenu(wxID_FILE1); // Load document 1 from the file history, this is the file that was saved before. This mechanism avoids the open dialog.
-    WaitForIdle;
+    WaitForFileValidation(); // The removed file is detected in the background
 }
 
 void TestExceptions::testRemovedFolderInProjectViewBeforeOpening()
@@ -0,0 +1,211 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TestFileIndex.h"
+
+#include "FileIndex.h"
+#include "FileInput.h"
+
+namespace test {
+
+/// \return opened (and probed) context for the given file
+static AVFormatContext* openContext(const wxFileName& path)
+{
+    AVFormatContext* result{ nullptr };
+    ASSERT_ZERO(model::FileInput::open(&result, path))(path);
+    ASSERT_MORE_THAN_EQUALS_ZERO(avformat_find_stream_info(result, 0))(path);
+    return result;
+}
+
+/// Read packets until a packet of the given stream is found.
+/// \return pts (dts if there is no pts), byte offset, and keyframe flag of the packet
+static std::tuple<int64_t, int64_t, bool> readPacket(AVFormatContext* context, int streamIndex)
+{
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+    AVPacket packet = { 0 };
+    while (av_read_frame(context, &packet) >= 0)
+    {
+        if (packet.stream_index == streamIndex)
+        {
+            std::tuple<int64_t, int64_t, bool> result{ packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts, packet.pos, (packet.flags & AV_PKT_FLAG_KEY) != 0 };
+            av_packet_unref(&packet);
+            return result;
+        }
+        av_packet_unref(&packet);
+    }
+    FATAL("No packet found");
+    return std::make_tuple(0, 0, false);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST CASES
+//////////////////////////////////////////////////////////////////////////
+
+void TestFileIndex::testVideoFile()
+{
+    StartTestSuite();
+    wxFileName path{ getTestFilesPath().GetLongPath(), "00.avi" };
+    boost::shared_ptr<model::FileIndex> index{ BuildFileIndex(path) };
+    AVFormatContext* context{ openContext(path) };
+    int video{ av_find_best_stream(context, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) };
+    int audio{ av_find_best_stream(context, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) };
+    ASSERT_MORE_THAN_EQUALS_ZERO(video);
+    AVRational timebase{ context->streams[video]->time_base };
+
+    StartTest("Indexed streams");
+    ASSERT(index->hasStream(video));
+    if (audio >= 0)
+    {
+        ASSERT(!index->hasStream(audio)); // Positioning is done via the video keyframes.
+    }
+
+    StartTest("Keyframes");
+    boost::optional<int64_t> last{ index->getLastKeyFrame(video) };
+    ASSERT(last);
+    boost::optional<int64_t> first{ index->getKeyFrame(video, *last) };
+    while (first && index->getKeyFrame(video, *first - 1)) { first = index->getKeyFrame(video, *first - 1); }
+    ASSERT(first);
+    ASSERT(!index->getKeyFrame(video, *first - 1));
+    ASSERT_EQUALS(index->getKeyFrame(video, std::numeric_limits<int64_t>::max()), last);
+    int64_t step{ std::max<int64_t>((*last - *first) / 20, 1) };
+    for (int64_t pts{ *first }; pts <= *last; pts += step)
+    {
+        boost::optional<int64_t> keyframe{ index->getKeyFrame(video, pts) };
+        ASSERT(keyframe)(pts);
+        ASSERT_LESS_THAN_EQUALS(*keyframe, pts);
+        ASSERT_EQUALS(index->getKeyFrame(video, *keyframe), keyframe);
+    }
+
+    StartTest("Seeking positions on the keyframe at or before the position");
+    std::map<int64_t, int64_t> positions; ///< Byte offset of each keyframe seeked to.
+    for (int64_t pts{ *first }; pts <= *last; pts += step)
+    {
+        boost::optional<int64_t> keyframe{ index->getKeyFrame(video, pts) };
+        boost::optional<int64_t> seeked{ index->seek(context, video, av_rescale_q(pts, timebase, AVRational{ 1, AV_TIME_BASE })) };
+        ASSERT_EQUALS(seeked, keyframe)(pts);
+        std::tuple<int64_t, int64_t, bool> packet{ readPacket(context, video) };
+        ASSERT_EQUALS(std::get<0>(packet), *keyframe)(pts);
+        ASSERT(std::get<2>(packet))(pts);
+        positions[*keyframe] = std::get<1>(packet);
+    }
+
+    StartTest("Byte ranges start at the keyframe before the interval");
+    boost::optional<std::pair<int64_t, int64_t>> previous;
+    for (int64_t pts{ *first }; pts <= *last; pts += step)
+    {
+        int64_t begin{ av_rescale_q(pts - *first, timebase, AVRational{ 1, AV_TIME_BASE }) };
+        boost::optional<std::pair<int64_t, int64_t>> range{ index->getByteRange(begin, begin + AV_TIME_BASE) };
+        ASSERT(range)(pts);
+        ASSERT_LESS_THAN(range->first, range->second)(pts);
+        boost::optional<int64_t> keyframe{ index->getKeyFrame(video, *first + av_rescale_q(begin, AVRational{ 1, AV_TIME_BASE }, timebase)) };
+        ASSERT(keyframe);
+        ASSERT_MAP_CONTAINS(positions, *keyframe);
+        ASSERT_EQUALS(range->first, positions[*keyframe])(pts);
+        if (previous)
+        {
+            ASSERT_LESS_THAN_EQUALS(previous->first, range->first)(pts);
+            ASSERT_LESS_THAN_EQUALS(previous->second, range->second)(pts);
+        }
+        previous = range;
+    }
+    boost::optional<std::pair<int64_t, int64_t>> all{ index->getByteRange(0, 24LL * 3600 * AV_TIME_BASE) };
+    ASSERT(all);
+    ASSERT_EQUALS(all->second, std::numeric_limits<int64_t>::max()); // Until the end of the file.
+
+    model::FileInput::close(&context);
+}
+
+void TestFileIndex::testAudioFile()
+{
+    StartTestSuite();
+    wxFileName path{ getTestFilesPath("filetypes_formats_audio").GetLongPath(), "Dawn_AnotherDay_EmbeddedCoverImage_IncompleteEndPacket.mp3" };
+    boost::shared_ptr<model::FileIndex> index{ BuildFileIndex(path) };
+    AVFormatContext* context{ openContext(path) };
+    int audio{ av_find_best_stream(context, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) };
+    ASSERT_MORE_THAN_EQUALS_ZERO(audio);
+    AVRational timebase{ context->streams[audio]->time_base };
+
+    StartTest("Indexed streams");
+    ASSERT(index->hasStream(audio));
+    for (unsigned int i = 0; i < context->nb_streams; ++i)
+    {
+        if (context->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            ASSERT_NONZERO(context->streams[i]->disposition & AV_DISPOSITION_ATTACHED_PIC);
+            ASSERT(!index->hasStream(i)); // Cover image
+        }
+    }
+
+    StartTest("Seeking positions on an indexed packet before the position");
+    boost::optional<int64_t> last{ index->getLastKeyFrame(audio) };
+    ASSERT(last);
+    int64_t step{ std::max<int64_t>(*last / 10, 1) };
+    for (int64_t pts{ step }; pts <= *last; pts += step)
+    {
+        int64_t timestamp{ av_rescale_q(pts, timebase, AVRational{ 1, AV_TIME_BASE }) };
+        boost::optional<int64_t> seeked{ index->seek(context, audio, timestamp) };
+        if (!seeked) { continue; } // Within the preroll of the first packet.
+        ASSERT_LESS_THAN_EQUALS(*seeked, pts);
+        ASSERT_EQUALS(index->getKeyFrame(audio, *seeked), seeked);
+    }
+
+    StartTest("Byte ranges");
+    boost::optional<std::pair<int64_t, int64_t>> previous;
+    for (int64_t begin{ 0 }; begin < av_rescale_q(*last, timebase, AVRational{ 1, AV_TIME_BASE }); begin += AV_TIME_BASE)
+    {
+        boost::optional<std::pair<int64_t, int64_t>> range{ index->getByteRange(begin, begin + AV_TIME_BASE) };
+        ASSERT(range)(begin);
+        ASSERT_LESS_THAN(range->first, range->second)(begin);
+        if (previous)
+        {
+            ASSERT_LESS_THAN_EQUALS(previous->first, range->first)(begin);
+        }
+        previous = range;
+    }
+
+    model::FileInput::close(&context);
+}
+
+void TestFileIndex::testContainerIndex()
+{
+    StartTestSuite();
+    {
+        StartTest("Container with index");
+        wxFileName path{ getTestFilesPath().GetLongPath(), "00.avi" };
+        AVFormatContext* context{ openContext(path) };
+        int video{ av_find_best_stream(context, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) };
+        int audio{ av_find_best_stream(context, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) };
+        boost::shared_ptr<model::FileIndex> index{ model::FileIndex::fromContainer(context) };
+        ASSERT_NONZERO(index)(path);
+        ASSERT(index->hasStream(video));
+        if (audio >= 0)
+        {
+            ASSERT(!index->hasStream(audio));
+        }
+        ASSERT(index->getByteRange(0, AV_TIME_BASE));
+        model::FileInput::close(&context);
+    }
+    {
+        StartTest("Container without index");
+        wxFileName path{ getTestFilesPath("filetypes_formats_audio").GetLongPath(), "Dawn_AnotherDay_EmbeddedCoverImage_IncompleteEndPacket.mp3" };
+        AVFormatContext* context{ openContext(path) };
+        ASSERT_ZERO(model::FileIndex::fromContainer(context))(path); // Built by reading the file (see FileIndex::schedule).
+        model::FileInput::close(&context);
+    }
+}
+
+} // namespace
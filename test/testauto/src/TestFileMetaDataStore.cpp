@@ -0,0 +1,180 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TestFileMetaDataStore.h"
+
+#include "FileIndex.h"
+#include "FileMetaDataStore.h"
+
+namespace test {
+
+/// Replace the given file with the first part of its contents.
+static void truncateFile(const wxFileName& path, size_t size)
+{
+    std::vector<char> data(size);
+    {
+        wxFile file(path.GetLongPath(), wxFile::read);
+        ASSERT(file.IsOpened());
+        ASSERT_EQUALS(file.Read(data.data(), size), static_cast<ssize_t>(size));
+    }
+    wxFile file(path.GetLongPath(), wxFile::write);
+    ASSERT(file.IsOpened());
+    ASSERT_EQUALS(file.Write(data.data(), size), size);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST CASES
+//////////////////////////////////////////////////////////////////////////
+
+void TestFileMetaDataStore::testSaveAndLoad()
+{
+    StartTestSuite();
+    RandomTempDirPtr tempDir{ RandomTempDir::generate() };
+    wxFileName storeFile{ tempDir->getFileName().GetLongPath(), "media.cache" };
+    wxFileName media{ getListOfInputPathsAsFileNames().front() };
+    boost::shared_ptr<model::FileIndex> index{ BuildFileIndex(media) };
+    model::FileMetaDataStore::read(wxFileName(tempDir->getFileName().GetLongPath(), "missing.cache")); // Remove all entries.
+
+    model::FileProperties properties;
+    properties.VideoStream = 0;
+    properties.AudioStream = 1;
+    properties.MaximumStartPts = 1000;
+    properties.FrameRateNum = 30000;
+    properties.FrameRateDen = 1001;
+    properties.Width = 720;
+    properties.Height = 576;
+    properties.SampleRate = 44100;
+    properties.Channels = 2;
+
+    model::FileMetaDataStore::setLength(media, 1234);
+    model::FileMetaDataStore::setProperties(media, properties);
+    model::FileMetaDataStore::setPeaks(media, "peaks");
+    model::FileMetaDataStore::setIndex(media, index);
+
+    StartTest("Writing removes the entries");
+    model::FileMetaDataStore::write(storeFile);
+    ASSERT(storeFile.FileExists());
+    ASSERT(!model::FileMetaDataStore::getLength(media));
+
+    StartTest("Reading restores the entries");
+    model::FileMetaDataStore::read(storeFile);
+    ASSERT_EQUALS(model::FileMetaDataStore::getLength(media), boost::optional<pts>(1234));
+    boost::optional<model::FileProperties> stored{ model::FileMetaDataStore::getProperties(media) };
+    ASSERT(stored);
+    ASSERT_EQUALS(stored->VideoStream, properties.VideoStream);
+    ASSERT_EQUALS(stored->AudioStream, properties.AudioStream);
+    ASSERT_EQUALS(stored->MaximumStartPts, properties.MaximumStartPts);
+    ASSERT_EQUALS(stored->FrameRateNum, properties.FrameRateNum);
+    ASSERT_EQUALS(stored->FrameRateDen, properties.FrameRateDen);
+    ASSERT_EQUALS(stored->Width, properties.Width);
+    ASSERT_EQUALS(stored->Height, properties.Height);
+    ASSERT_EQUALS(stored->SampleRate, properties.SampleRate);
+    ASSERT_EQUALS(stored->Channels, properties.Channels);
+    ASSERT_EQUALS(model::FileMetaDataStore::getPeaks(media), "peaks");
+
+    StartTest("Reading restores the index");
+    model::FileIndexPtr storedIndex{ model::FileMetaDataStore::getIndex(media) };
+    ASSERT_NONZERO(storedIndex);
+    for (int64_t begin{ 0 }; begin < 10 * AV_TIME_BASE; begin += AV_TIME_BASE / 2)
+    {
+        ASSERT_EQUALS(storedIndex->getByteRange(begin, begin + AV_TIME_BASE), index->getByteRange(begin, begin + AV_TIME_BASE))(begin);
+    }
+
+    StartTest("Entries of a changed file are not used");
+    model::FileMetaDataStore::write(storeFile);
+    model::FileMetaDataStore::read(storeFile);
+    ASSERT(!model::FileMetaDataStore::getLength(wxFileName(tempDir->getFileName().GetLongPath(), "unknown.avi")));
+    wxFileName copy{ tempDir->getFileName().GetLongPath(), media.GetFullName() };
+    ASSERT(wxCopyFile(media.GetLongPath(), copy.GetLongPath(), false));
+    model::FileMetaDataStore::setLength(copy, 1234);
+    ASSERT_EQUALS(model::FileMetaDataStore::getLength(copy), boost::optional<pts>(1234));
+    {
+        wxFile file(copy.GetLongPath(), wxFile::write_append);
+        ASSERT(file.IsOpened());
+        ASSERT(file.Write("changed"));
+    }
+    ASSERT(!model::FileMetaDataStore::getLength(copy));
+
+    model::FileMetaDataStore::read(wxFileName(tempDir->getFileName().GetLongPath(), "missing.cache")); // Release the mapping, which allows removing the folder.
+}
+
+void TestFileMetaDataStore::testTruncatedAndCorruptFile()
+{
+    StartTestSuite();
+    RandomTempDirPtr tempDir{ RandomTempDir::generate() };
+    wxFileName storeFile{ tempDir->getFileName().GetLongPath(), "media.cache" };
+    wxFileName media{ getListOfInputPathsAsFileNames().front() };
+
+    auto writeStore = [storeFile, media]
+    {
+        model::FileMetaDataStore::setLength(media, 1234);
+        model::FileMetaDataStore::setIndex(media, BuildFileIndex(media));
+        model::FileMetaDataStore::write(storeFile);
+        model::FileMetaDataStore::read(storeFile);
+        ASSERT_EQUALS(model::FileMetaDataStore::getLength(media), boost::optional<pts>(1234));
+        model::FileMetaDataStore::write(storeFile);
+    };
+
+    StartTest("Missing file");
+    model::FileMetaDataStore::read(wxFileName(tempDir->getFileName().GetLongPath(), "missing.cache")); // Also removes all entries, thus 'media' is the only stored file below.
+    ASSERT(!model::FileMetaDataStore::getLength(media));
+
+    StartTest("Empty file");
+    writeStore();
+    truncateFile(storeFile, 0);
+    model::FileMetaDataStore::read(storeFile);
+    ASSERT(!model::FileMetaDataStore::getLength(media));
+
+    for (int fraction : { 2, 4, 8 })
+    {
+        StartTest(wxString::Format("File truncated to 1/%d", fraction));
+        writeStore();
+        truncateFile(storeFile, static_cast<size_t>(storeFile.GetSize().GetValue() / fraction));
+        model::FileMetaDataStore::read(storeFile);
+        ASSERT(!model::FileMetaDataStore::getLength(media));
+        ASSERT_ZERO(model::FileMetaDataStore::getIndex(media));
+    }
+
+    StartTest("File with unknown identification");
+    writeStore();
+    {
+        wxFile file(storeFile.GetLongPath(), wxFile::read_write);
+        ASSERT(file.IsOpened());
+        ASSERT(file.Write("X"));
+    }
+    model::FileMetaDataStore::read(storeFile);
+    ASSERT(!model::FileMetaDataStore::getLength(media));
+
+    StartTest("Corrupt index");
+    writeStore();
+    {
+        // The index is the last part of the (only) entry.
+        size_t size{ static_cast<size_t>(storeFile.GetSize().GetValue()) };
+        wxFile file(storeFile.GetLongPath(), wxFile::read_write);
+        ASSERT(file.IsOpened());
+        ASSERT_EQUALS(file.Seek(size - 16), static_cast<wxFileOffset>(size - 16));
+        std::vector<char> garbage(16, '\xff');
+        ASSERT_EQUALS(file.Write(garbage.data(), garbage.size()), garbage.size());
+    }
+    model::FileMetaDataStore::read(storeFile);
+    ASSERT_EQUALS(model::FileMetaDataStore::getLength(media), boost::optional<pts>(1234)); // The other data is still usable.
+    model::FileMetaDataStore::getIndex(media); // NOT: ASSERT_ZERO. Not all corruptions can be detected. Reading must not crash.
+
+    model::FileMetaDataStore::read(wxFileName(tempDir->getFileName().GetLongPath(), "missing.cache")); // Release the mapping, which allows removing the folder.
+}
+
+} // namespace
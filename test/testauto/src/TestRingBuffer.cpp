@@ -0,0 +1,198 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TestRingBuffer.h"
+
+#include "UtilFifo.h"
+#include "UtilRingBuffer.h"
+
+namespace test {
+
+/// Number of elements passed between the threads for measuring throughput.
+static const int sRingBufferThroughputCount{ 1000000 };
+
+/// Number of round trips for measuring latency.
+static const int sRingBufferLatencyCount{ 10000 };
+
+/// \return number of microseconds elapsed since the given time
+static int64_t elapsedMicroseconds(const boost::posix_time::ptime& start)
+{
+    return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+}
+
+/// Push a sequence of numbers in one thread, and pop them in another thread.
+/// \return elapsed time in microseconds
+template <typename QUEUE>
+int64_t measureThroughput(QUEUE& queue)
+{
+    boost::posix_time::ptime start{ boost::posix_time::microsec_clock::universal_time() };
+    boost::thread producer([&queue]
+    {
+        for (int i = 1; i <= sRingBufferThroughputCount; ++i) { queue.push(i); }
+    });
+    int previous{ 0 };
+    for (int i = 1; i <= sRingBufferThroughputCount; ++i)
+    {
+        int value{ queue.pop() };
+        ASSERT_EQUALS(value, previous + 1);
+        previous = value;
+    }
+    producer.join();
+    return elapsedMicroseconds(start);
+}
+
+/// Pass one element back and forth between two threads.
+/// \return average round trip time in nanoseconds
+template <typename QUEUE>
+int64_t measureLatency(QUEUE& request, QUEUE& reply)
+{
+    boost::posix_time::ptime start{ boost::posix_time::microsec_clock::universal_time() };
+    boost::thread echo([&request, &reply]
+    {
+        for (int i = 0; i < sRingBufferLatencyCount; ++i) { reply.push(request.pop()); }
+    });
+    for (int i = 0; i < sRingBufferLatencyCount; ++i)
+    {
+        request.push(i);
+        ASSERT_EQUALS(reply.pop(), i);
+    }
+    echo.join();
+    return elapsedMicroseconds(start) * 1000 / sRingBufferLatencyCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TEST CASES
+//////////////////////////////////////////////////////////////////////////
+
+void TestRingBuffer::testOrderAndFlush()
+{
+    StartTestSuite();
+    {
+        StartTest("Elements are returned in order");
+        RingBuffer<int> buffer(3);
+        for (int round = 0; round < 5; ++round) // Wrap around a few times
+        {
+            buffer.push(1);
+            buffer.push(2);
+            ASSERT_EQUALS(buffer.getSize(), 2);
+            ASSERT_EQUALS(buffer.pop(), 1);
+            buffer.push(3);
+            ASSERT_EQUALS(buffer.pop(), 2);
+            ASSERT_EQUALS(buffer.pop(), 3);
+            ASSERT_ZERO(buffer.getSize());
+        }
+    }
+    {
+        StartTest("Full and empty buffer");
+        RingBuffer<int> buffer(2);
+        int value{ 0 };
+        ASSERT(!buffer.tryPop(value));
+        ASSERT(buffer.tryPush(1));
+        ASSERT(buffer.tryPush(2));
+        ASSERT(!buffer.tryPush(3));
+        ASSERT(buffer.tryPop(value));
+        ASSERT_EQUALS(value, 1);
+    }
+    {
+        StartTest("Buffer with only one slot");
+        RingBuffer<int, RingBufferProducers::Multiple> buffer(1);
+        int value{ 0 };
+        for (int round = 0; round < 3; ++round)
+        {
+            ASSERT(buffer.tryPush(round));
+            ASSERT(!buffer.tryPush(round + 1));
+            ASSERT_EQUALS(buffer.getSize(), 1);
+            ASSERT(buffer.tryPop(value));
+            ASSERT_EQUALS(value, round);
+            ASSERT(!buffer.tryPop(value));
+        }
+    }
+    {
+        StartTest("Flush unblocks a blocked producer");
+        RingBuffer<int> buffer(1);
+        buffer.push(1);
+        boost::thread producer([&buffer] { buffer.push(2); });
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        buffer.flush();
+        producer.join();
+        ASSERT_EQUALS(buffer.pop(), 2);
+        ASSERT_ZERO(buffer.getSize());
+    }
+    {
+        StartTest("Push unblocks a blocked consumer");
+        RingBuffer<int> buffer(1);
+        int value{ 0 };
+        boost::thread consumer([&buffer, &value] { value = buffer.pop(); });
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        buffer.push(5);
+        consumer.join();
+        ASSERT_EQUALS(value, 5);
+    }
+}
+
+void TestRingBuffer::testMultipleProducers()
+{
+    StartTestSuite();
+    const int nProducers{ 4 };
+    const int nElements{ 100000 };
+    RingBuffer<int, RingBufferProducers::Multiple> buffer(64);
+    boost::thread_group producers;
+    for (int p = 0; p < nProducers; ++p)
+    {
+        producers.create_thread([&buffer, p, nElements]
+        {
+            for (int i = 0; i < nElements; ++i) { buffer.push(p * nElements + i); }
+        });
+    }
+    std::vector<int> last(nProducers, -1);
+    for (int i = 0; i < nProducers * nElements; ++i)
+    {
+        int value{ buffer.pop() };
+        int producer{ value / nElements };
+        ASSERT_MORE_THAN(value, last[producer]); // Order per producer is kept
+        last[producer] = value;
+    }
+    producers.join_all();
+    ASSERT_ZERO(buffer.getSize());
+}
+
+void TestRingBuffer::testPerformance()
+{
+    StartTestSuite();
+    {
+        StartTest("Throughput");
+        Fifo<int> fifo(200);
+        RingBuffer<int> spsc(200);
+        RingBuffer<int, RingBufferProducers::Multiple> mpsc(200);
+        int64_t fifoTime{ measureThroughput(fifo) };
+        int64_t spscTime{ measureThroughput(spsc) };
+        int64_t mpscTime{ measureThroughput(mpsc) };
+        LOG_WARNING << "Throughput for " << sRingBufferThroughputCount << " elements (us): Fifo " << fifoTime << ", RingBuffer (single producer) " << spscTime << ", RingBuffer (multiple producers) " << mpscTime;
+    }
+    {
+        StartTest("Latency");
+        Fifo<int> fifoRequest(1);
+        Fifo<int> fifoReply(1);
+        RingBuffer<int> spscRequest(1);
+        RingBuffer<int> spscReply(1);
+        int64_t fifoLatency{ measureLatency(fifoRequest, fifoReply) };
+        int64_t spscLatency{ measureLatency(spscRequest, spscReply) };
+        LOG_WARNING << "Average round trip (ns): Fifo " << fifoLatency << ", RingBuffer " << spscLatency;
+    }
+}
+
+} // namespace
@@ -87,7 +87,19 @@ struct RenderPeaksWork
 
             result->SetRGB(wxRect{ 0, origin, mSize.x, 1 }, 87, 120, 74);
 
-            model::AudioPeaks peaks = mAudioClipClone->getPeaks(mParameters);
+            pts length{ mAudioClipClone->getLength() }; // Before getPeaks(), which may maximize the clone.
+            int totalPixels = Zoom::ptsToPixels(length, mZoom);
+
+            // Use the lowest resolution that still has at least one peak per pixel.
+            // Zoomed out, drawing a long clip then does not require iterating
+            // over all peaks of the clip.
+            int level{ 0 };
+            while (totalPixels > 0 && ((length * model::AudioClip::sPeaksPerPts) >> (level + 1)) >= totalPixels)
+            {
+                ++level;
+            }
+
+            model::AudioPeaks peaks = mAudioClipClone->getPeaks(mParameters, level);
             int nPeaks = peaks.size();
 
             if (nPeaks > 0)
@@ -97,8 +109,7 @@ struct RenderPeaksWork
                 ASSERT_LESS_THAN_EQUALS(peak.first.first, peak.first.second);
                 ASSERT_LESS_THAN_EQUALS(peak.second.first, peak.second.second);
 
-                int totalPeaks = mAudioClipClone->getLength() * model::AudioClip::sPeaksPerPts;
-                int totalPixels = Zoom::ptsToPixels(totalPeaks / model::AudioClip::sPeaksPerPts, mZoom);
+                int totalPeaks = narrow_cast<int>(((length * model::AudioClip::sPeaksPerPts) + (1 << level) - 1) >> level);
 
                 for (int x{ 0 }; x < mSize.x && !isAborted(); ++x)
                 {
@@ -22,6 +22,8 @@
 #include "Config.h"
 #include "Drag.h"
 #include "EmptyClip.h"
+#include "File.h"
+#include "FileValidator.h"
 #include "PositionInfo.h"
 #include "Selection.h"
 #include "SequenceView.h"
@@ -184,6 +186,10 @@ void ClipView::draw(wxDC& dc, const wxRegion& region, const wxPoint& offset) con
             // During some operations the resulting view may be of '0' size.
             if (!mBitmap || mBitmap->GetSize() != size)
             {
+                if (model::FilePtr file{ mClip->getFile() })
+                {
+                    model::FileValidator::prioritize(file->getPath()); // Directly after opening a project, visible files are validated first.
+                }
                 mBitmap.reset(wxBitmap(size));
                 draw(*mBitmap, !getDrag().isActive(), true);
             }
@@ -100,6 +100,8 @@ public:
     // CONFIG PATHS
     //////////////////////////////////////////////////////////////////////////
 
+    static const wxString sPathAudioCacheEnabled; ///< Decode used audio files into (large) cache files. See model::AudioCache.
+    static const wxString sPathAudioCacheSize; ///< Maximum size (in MB) of all audio cache files together.
     static const wxString sPathAudioDefaultNumberOfChannels;
     static const wxString sPathAudioDefaultSampleRate;
     static const wxString sPathDebugIncludeScreenShotInDump;
@@ -144,6 +146,7 @@ public:
     static const wxString sPathVideoDefaultHeight;
     static const wxString sPathVideoDefaultScaling;
     static const wxString sPathVideoDefaultWidth;
+    static const wxString sPathVideoDecodingThreads; ///< Total number of threads used for video decoding (shared by all opened files). 0 - use the number of cores.
     static const wxString sPathVideoOverruleFourCC; ///< Used to overrule the FourCC for encoding MPEG4 formy Car DVD player (only swallows MPEG4 labeled with XVID)
     static const wxString sPathWorkspaceLanguage;
     static const wxString sPathWorkspaceH;
@@ -0,0 +1,101 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+/// Appends values to a byte buffer, in a compact binary format.
+/// Numbers are stored in the machine's native byte order. Thus, the data is
+/// only intended for caching data on the machine that created it.
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::vector<char>& buffer)
+        : mBuffer(buffer)
+    {
+    }
+
+    template <typename TYPE>
+    void write(const TYPE& value)
+    {
+        static_assert(std::is_arithmetic<TYPE>::value, "Only numbers can be written directly.");
+        write(reinterpret_cast<const char*>(&value), sizeof(TYPE));
+    }
+
+    /// Write the string (UTF-8), preceded by its length.
+    void write(const wxString& value)
+    {
+        wxScopedCharBuffer utf8{ value.utf8_str() };
+        write<uint32_t>(narrow_cast<uint32_t>(utf8.length()));
+        write(utf8.data(), utf8.length());
+    }
+
+    void write(const char* data, size_t size)
+    {
+        mBuffer.insert(mBuffer.end(), data, data + size);
+    }
+
+private:
+    std::vector<char>& mBuffer;
+};
+
+/// Reads values that were written with BinaryWriter. All read methods
+/// return false (and leave the value unchanged) if the data is exhausted.
+/// Thus, corrupt or truncated data never causes reading outside the data.
+class BinaryReader
+{
+public:
+    BinaryReader(const char* data, size_t size)
+        : mData(data)
+        , mRemaining(size)
+    {
+    }
+
+    template <typename TYPE>
+    bool read(TYPE& value)
+    {
+        static_assert(std::is_arithmetic<TYPE>::value, "Only numbers can be read directly.");
+        if (mRemaining < sizeof(TYPE)) { return false; }
+        memcpy(&value, mData, sizeof(TYPE)); // Data may be unaligned.
+        return skip(sizeof(TYPE));
+    }
+
+    bool read(wxString& value)
+    {
+        uint32_t length{ 0 };
+        if (!read(length) || mRemaining < length) { return false; }
+        value = wxString::FromUTF8(mData, length);
+        return skip(length);
+    }
+
+    bool skip(size_t size)
+    {
+        if (mRemaining < size) { return false; }
+        mData += size;
+        mRemaining -= size;
+        return true;
+    }
+
+    /// \return position of the next value to be read
+    const char* getCurrent() const
+    {
+        return mData;
+    }
+
+private:
+    const char* mData;
+    size_t mRemaining;
+};
@@ -51,15 +51,39 @@ public:
     // LOCKING
     //////////////////////////////////////////////////////////////////////////
 
-    /// This mutex is needed to ensure that several non-thread-safe avcodec
-    /// methods are never executed in parallel:
-    /// - av_open_input_file
-    /// - av_close_input_file
-    /// - av_find_stream_info
-    /// - avcodec_open
-    /// - avcodec_close
+    /// This mutex is needed to ensure that avcodec_open2 and avcodec_close are
+    /// never executed in parallel (for any codec context).
+    ///
+    /// All other avformat/avcodec calls only access one AVFormatContext or
+    /// AVCodecContext, and are guarded by the owner of that context (for instance,
+    /// File uses a mutex per opened file). Any codec opening done within avcodec
+    /// itself (for instance, in avformat_find_stream_info) is serialized via the
+    /// lock manager that is registered in init().
     static boost::mutex sMutex;
 
+    //////////////////////////////////////////////////////////////////////////
+    // DECODING THREADS
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Claim a number of threads from the global decoding thread budget. The
+    /// budget is shared by all opened decoders. At least one thread is always
+    /// returned (then, no additional decoder threads are used).
+    /// \return number of threads to be used for AVCodecContext::thread_count
+    static int claimDecodingThreads();
+
+    /// Return threads, previously claimed via claimDecodingThreads(), to the budget.
+    /// \param nThreads value returned by claimDecodingThreads()
+    static void releaseDecodingThreads(int nThreads);
+
+    /// Claim the threads of a decoder that was opened before, and of which the
+    /// threads were returned to the budget in the meantime (see File::leaveDecoderOpen).
+    /// \param nThreads thread count of the decoder
+    /// \return false if the budget does not allow that many threads (then nothing is claimed)
+    static bool reclaimDecodingThreads(int nThreads);
+
+    /// \return total number of decoding threads that may be used simultaneously
+    static int getDecodingThreadBudget();
+
     //////////////////////////////////////////////////////////////////////////
     // LOGGING
     //////////////////////////////////////////////////////////////////////////
@@ -74,6 +98,11 @@ public:
     static char* sFixedBuffer;
     static int sLevel;
 
+    static boost::mutex sDecodingThreadsMutex;
+    static const int sMaximumThreadsPerDecoder;
+    static int sDecodingThreadsInUse;
+    static int sDecodersActive;
+
 private:
 
     //////////////////////////////////////////////////////////////////////////
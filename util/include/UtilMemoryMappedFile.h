@@ -0,0 +1,63 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+/// Read-only memory mapping of a complete file. Only the parts of the file
+/// that are actually accessed are read from disk (by the operating system).
+///
+/// Only for files that are written by the application itself (and replaced
+/// atomically). Accessing a mapping of a file that is truncated by another
+/// process crashes the application (see ReadOnlyFile).
+class MemoryMappedFile
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Map the given file. If the file does not exist or can't be mapped,
+    /// the object is created, but getData() returns nullptr.
+    explicit MemoryMappedFile(const wxFileName& path);
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+    virtual ~MemoryMappedFile();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    /// \return start of the file's contents, nullptr if the file is not mapped.
+    const char* getData() const;
+
+    /// \return size of the file in bytes (0 if the file is not mapped).
+    size_t getSize() const;
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    const char* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _MSC_VER
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = nullptr;
+#endif
+};
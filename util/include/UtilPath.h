@@ -17,6 +17,8 @@
 
 #pragma once
 
+class wxFile;
+
 namespace util { namespace path {
 
 /// Expand path such that ~1 etc. on windows is expanded.
@@ -51,6 +53,31 @@ wxFileName toFileName(const wxString& path);
 /// \param filename given file
 time_t lastModifiedTime(const wxFileName& filename);
 
+/// Identifies the contents of a file on disk. Data derived from a file (for
+/// instance, in one of the caches) is only used if the file's identity is
+/// unchanged: a changed file gets another size and/or modification time.
+struct FileIdentity
+{
+    wxString Path;
+    int64_t Size = 0;
+    int64_t Modified = 0;   ///< Modification time (ticks).
+
+    /// \return key (path|size|modified) for data derived from the file's contents
+    wxString toString() const;
+};
+
+/// \return identity of the given file, boost::none if the file can not be accessed
+boost::optional<FileIdentity> getIdentity(const wxFileName& file);
+
+/// Write a file such that it is either complete or absent. The data is first
+/// written to a separate file, which then replaces the given file. Thus, a
+/// crash (or error) whilst writing never leaves a partially written file.
+/// The folder of the file is created, if required.
+/// \param file file to be created or replaced
+/// \param write called for writing the data into the (opened, empty) file. Return false upon errors.
+/// \return true if the file was written completely
+bool writeAtomically(const wxFileName& file, const std::function<bool(wxFile&)>& write);
+
 bool equals(const wxFileName& f1, const wxFileName& f2 ); ///< \return true if the two paths indicate the same file/folder on disk
 bool equals(const wxString& f1,   const wxFileName& f2 ); ///< \return true if the two paths indicate the same file/folder on disk
 bool equals(const wxFileName& f1, const wxString& f2 );   ///< \return true if the two paths indicate the same file/folder on disk
@@ -83,6 +110,15 @@ wxFileName getResourcesPath();
 /// \return the path where the config (ini) file resides
 wxFileName getConfigFilePath();
 
+/// \return the path of the cache file holding media file meta data (shared by all projects)
+wxFileName getMediaCacheFilePath();
+
+/// \return the folder holding the decoded audio cache files (shared by all projects)
+wxFileName getAudioCachePath();
+
+/// \return the folder holding the stored audio peaks of clips (shared by all projects)
+wxFileName getAudioPeaksPath();
+
 /// \return the path where the localized strings databases reside
 wxFileName getLanguagesPath();
 
@@ -0,0 +1,77 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+/// Read-only access to a file via plain (positional) reads.
+///
+/// Unlike a memory mapping, reading never crashes when the file is truncated
+/// or on a network share that becomes unavailable: a read then simply returns
+/// less data. Other processes may keep writing, renaming, or deleting the
+/// file while it is open.
+///
+/// Reads at an explicit offset do not depend on (nor change) a shared file
+/// position, thus multiple threads may read via the same object.
+class ReadOnlyFile
+{
+public:
+
+    //////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Open the given file. If the file does not exist or can't be opened,
+    /// the object is created, but isOpen() returns false.
+    explicit ReadOnlyFile(const wxFileName& path);
+    ReadOnlyFile(const ReadOnlyFile&) = delete;
+    ReadOnlyFile& operator=(const ReadOnlyFile&) = delete;
+    virtual ~ReadOnlyFile();
+
+    //////////////////////////////////////////////////////////////////////////
+    // GET/SET
+    //////////////////////////////////////////////////////////////////////////
+
+    bool isOpen() const;
+
+    /// \return size of the file in bytes, when it was opened (0 if the file is not open).
+    int64_t getSize() const;
+
+    /// Read part of the file.
+    /// \param offset first byte to be read
+    /// \param buffer destination, must hold at least size bytes
+    /// \param size number of bytes to be read
+    /// \return number of bytes read (less than size at the end of the file), -1 upon error
+    int read(int64_t offset, void* buffer, int size) const;
+
+    /// Hint the operating system that the given range will be read soon.
+    /// Reading the range from disk starts in the background. Ranges beyond
+    /// the end of the file are ignored. Does not block.
+    void prefetch(int64_t offset, int64_t length) const;
+
+private:
+
+    //////////////////////////////////////////////////////////////////////////
+    // MEMBERS
+    //////////////////////////////////////////////////////////////////////////
+
+    int64_t mSize = 0;
+#ifdef _MSC_VER
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+#else
+    int mFile = -1;
+#endif
+};
@@ -0,0 +1,254 @@
+// Copyright 2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+enum class RingBufferProducers
+{
+    Single,     ///< Only one thread at a time may call push().
+    Multiple    ///< Any number of threads may call push() simultaneously.
+};
+
+/// Bounded queue for passing elements between threads without locking.
+///
+/// Each slot holds a sequence number that indicates whether the slot is free
+/// for the producer, or filled for the consumer (see Dmitry Vyukov's bounded
+/// queue). Elements are only accessed by the thread that claimed the slot.
+/// For the element at position p, the slot's sequence number is 2p when the
+/// slot is free and 2p + 1 when it is filled. Unlike Vyukov's p and p + 1,
+/// these values never coincide with those of the next round (p + maxSize),
+/// not even for a buffer with only one slot.
+///
+/// Removing elements (pop, flush) is always safe from multiple threads. That
+/// is required since typically another thread than the consumer flushes the
+/// buffer, for unblocking a producer when stopping. Adding elements requires
+/// an atomic increment (compare-exchange) if there may be multiple producers.
+///
+/// A mutex is only used when a thread must block: pop() on an empty buffer,
+/// or push() on a full buffer. Such a thread is notified only if it indicated
+/// that it is waiting, thus normally push and pop do not make any system calls.
+///
+/// The interface is the same as that of Fifo, which is used where performance
+/// does not matter.
+template<class ELEMENT, RingBufferProducers PRODUCERS = RingBufferProducers::Single>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t maxSize)
+        :   mMaxSize(maxSize)
+        ,   mSlots(maxSize)
+    {
+        ASSERT_MORE_THAN_ZERO(maxSize);
+        for (size_t i = 0; i < mMaxSize; ++i)
+        {
+            mSlots[i].Sequence.store(freeSequence(i), std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer& other) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    ~RingBuffer() = default;
+
+    /// \return number of elements in the buffer. Note that the result may be
+    ///         outdated already when it is returned, if other threads are
+    ///         pushing or popping simultaneously.
+    size_t getSize() const
+    {
+        size_t dequeued{ mDequeuePosition.load(std::memory_order_acquire) };
+        size_t enqueued{ mEnqueuePosition.load(std::memory_order_acquire) };
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    /// Remove all elements.
+    void flush()
+    {
+        ELEMENT e;
+        while (tryPop(e)) {}
+        notifyWaiting();
+    }
+
+    /// Get the front ELEMENT and remove it. Blocks until a element is available.
+    /// \return found element
+    ELEMENT pop()
+    {
+        ELEMENT result;
+        if (!tryPop(result))
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            startWaiting();
+            while (!tryPop(result))
+            {
+                mCondition.wait(lock);
+            }
+            --mWaiting;
+        }
+        notifyWaiting(); // Wake a producer blocked on a full buffer
+        return result;
+    }
+
+    /// Inserts an object in the list.
+    /// If list is full, blocks until list is no longer full.
+    void push(const ELEMENT& e)
+    {
+        if (!tryPush(e))
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            startWaiting();
+            while (!tryPush(e))
+            {
+                mCondition.wait(lock);
+            }
+            --mWaiting;
+        }
+        notifyWaiting(); // Wake a consumer blocked on an empty buffer
+    }
+
+    /// Inserts an object in the list, without blocking.
+    /// \return false if the list is full
+    bool tryPush(const ELEMENT& e)
+    {
+        size_t position{ mEnqueuePosition.load(std::memory_order_relaxed) };
+        if (PRODUCERS == RingBufferProducers::Single)
+        {
+            Slot& slot{ mSlots[position % mMaxSize] };
+            if (slot.Sequence.load(std::memory_order_acquire) != freeSequence(position))
+            {
+                return false; // Full: slot still holds the element that was pushed one round earlier.
+            }
+            slot.Element = e;
+            slot.Sequence.store(filledSequence(position), std::memory_order_release);
+            mEnqueuePosition.store(position + 1, std::memory_order_release); // After filling the slot, for an exact getSize().
+            return true;
+        }
+
+        Slot* slot{ nullptr };
+        while (true)
+        {
+            slot = &mSlots[position % mMaxSize];
+            size_t sequence{ slot->Sequence.load(std::memory_order_acquire) };
+            if (sequence == freeSequence(position))
+            {
+                // Free slot found. Claim it.
+                if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+                // Another producer claimed the slot. 'position' has been updated by compare_exchange.
+            }
+            else if (sequence < freeSequence(position))
+            {
+                return false; // Full: slot still holds the element that was pushed one round earlier.
+            }
+            else
+            {
+                position = mEnqueuePosition.load(std::memory_order_relaxed); // Another producer filled this slot already.
+            }
+        }
+        slot->Element = e;
+        slot->Sequence.store(filledSequence(position), std::memory_order_release);
+        return true;
+    }
+
+    /// Get the front ELEMENT and remove it, without blocking.
+    /// \param e upon return, holds the front element (if any)
+    /// \return false if the list is empty
+    bool tryPop(ELEMENT& e)
+    {
+        size_t position{ mDequeuePosition.load(std::memory_order_relaxed) };
+        Slot* slot{ nullptr };
+        while (true)
+        {
+            slot = &mSlots[position % mMaxSize];
+            size_t sequence{ slot->Sequence.load(std::memory_order_acquire) };
+            if (sequence == filledSequence(position))
+            {
+                // Filled slot found. Claim it.
+                if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+                // Another thread (flush) claimed the slot. 'position' has been updated by compare_exchange.
+            }
+            else if (sequence < filledSequence(position))
+            {
+                return false; // Empty
+            }
+            else
+            {
+                position = mDequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        e = std::move(slot->Element);
+        slot->Element = ELEMENT(); // Release any resources held by the element, now.
+        slot->Sequence.store(freeSequence(position + mMaxSize), std::memory_order_release);
+        return true;
+    }
+
+private:
+
+    struct Slot
+    {
+        std::atomic<size_t> Sequence;
+        ELEMENT Element;
+    };
+
+    const size_t mMaxSize;
+    std::vector<Slot> mSlots;
+
+    // Padding avoids that producers and consumers invalidate each other's cache lines.
+    char mPadding1[64];
+    std::atomic<size_t> mEnqueuePosition{ 0 };
+    char mPadding2[64];
+    std::atomic<size_t> mDequeuePosition{ 0 };
+    char mPadding3[64];
+
+    // Only for blocking
+    boost::mutex mMutex;
+    boost::condition_variable mCondition;
+    std::atomic<int> mWaiting{ 0 };
+
+    /// \return sequence number of a slot that may be filled with the element for the given position
+    static size_t freeSequence(size_t position)
+    {
+        return 2 * position;
+    }
+
+    /// \return sequence number of a slot that holds the element for the given position
+    static size_t filledSequence(size_t position)
+    {
+        return 2 * position + 1;
+    }
+
+    /// Must be called with mMutex locked.
+    void startWaiting()
+    {
+        ++mWaiting;
+        // Ensure that either the subsequent try in the waiting thread sees the
+        // change, or the thread making the change sees mWaiting (notifyWaiting).
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void notifyWaiting()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mWaiting.load(std::memory_order_relaxed) > 0)
+        {
+            boost::mutex::scoped_lock lock(mMutex); // Avoid notifying between the waiting thread's check and wait.
+            mCondition.notify_all();
+        }
+    }
+};
@@ -50,4 +50,16 @@ RETURNTYPE RunInMainReturning(const std::function<RETURNTYPE()>& method)
 
 void setCurrentThreadName(const char* name);
 
+/// Call a method for a number of items, using a bounded number of threads.
+/// Intended for work that is dominated by waiting for the disk (for instance,
+/// opening media files), for which a few threads hide the latencies, but many
+/// simultaneous requests only cause more seeking on rotating disks.
+/// Returns when all items have been handled (or processing was stopped).
+/// \param count number of items
+/// \param name name of the threads (see setCurrentThreadName)
+/// \param method called once for each item index, from one of the threads. Return false to stop processing the remaining items.
+/// \param whileWaiting if not nullptr, called repeatedly from the calling thread whilst waiting (for instance, for updating progress)
+/// \param interval time (in ms) between two calls of whileWaiting
+void runParallel(size_t count, const char* name, const std::function<bool(size_t)>& method, const std::function<void()>& whileWaiting = nullptr, int interval = 100);
+
 }} // namespace
@@ -172,10 +172,13 @@ void Config::init(bool inCxxTestMode)
     checkLong(sPathTimelineDefaultVideoTrackHeight, 25, 250);
     checkLong(sPathVideoDefaultWidth, 10, 10000);
     checkLong(sPathVideoDefaultHeight, 10, 10000);
+    checkLong(sPathVideoDecodingThreads, 0, 256);
     checkEnum(sPathVideoDefaultScaling, model::VideoScaling);
     checkEnum(sPathVideoDefaultAlignment, model::VideoAlignment);
     checkLong(sPathAudioDefaultSampleRate, 100, 100000);
     checkLong(sPathAudioDefaultNumberOfChannels, 1, 2);
+    checkBool(sPathAudioCacheEnabled);
+    checkLong(sPathAudioCacheSize, 100, 10000000);
     checkEnum(sPathDebugLogLevel, LogLevel);
     checkEnum(sPathProjectDefaultNewProjectType, model::DefaultNewProjectWizardStart);
     checkEnum(sPathDebugLogLevelAvcodec, LogLevelAvcodec);
@@ -205,6 +208,8 @@ void Config::init(bool inCxxTestMode)
     setDefault(sPathEditAutoStartPlayback, false);
     setDefault(sPathAudioDefaultNumberOfChannels, 2);
     setDefault(sPathAudioDefaultSampleRate, 44100);
+    setDefault(sPathAudioCacheEnabled, false); // Opt-in, since the cache files are large.
+    setDefault(sPathAudioCacheSize, 10000);
     setDefault(sPathFileDefaultExtension, "avi");
     setDefault(sPathTimelineAutoAddEmptyTrackWhenDragging, true);
     setDefault(sPathTimelineDefaultStillImageLength, 150);
@@ -215,6 +220,7 @@ void Config::init(bool inCxxTestMode)
     setDefault(sPathVideoDefaultHeight, 720);
     setDefault(sPathVideoDefaultScaling, model::VideoScaling_toString(model::VideoScalingFitToFill));
     setDefault(sPathVideoDefaultWidth, 1280);
+    setDefault(sPathVideoDecodingThreads, 0); // Per default, use all cores
     setDefault(sPathProjectLastOpened, "");
     setDefault(sPathDebugLogLevel, inCxxTestMode ? LogLevel_toString(LogWarning) : LogLevel_toString(LogInfo));
     setDefault(sPathProjectDefaultNewProjectType, model::DefaultNewProjectWizardStart_toString(model::DefaultNewProjectWizardStartFolder));
@@ -499,6 +505,8 @@ void Config::releaseWriteToDisk()
 // CONFIG PATHS
 //////////////////////////////////////////////////////////////////////////
 
+const wxString Config::sPathAudioCacheEnabled("/Audio/CacheEnabled");
+const wxString Config::sPathAudioCacheSize("/Audio/CacheSize");
 const wxString Config::sPathAudioDefaultNumberOfChannels("/Audio/DefaultNumberOfChannels");
 const wxString Config::sPathAudioDefaultSampleRate("/Audio/DefaultSampleRate");
 const wxString Config::sPathDebugIncludeScreenShotInDump("/Debug/IncludeScreenshotInDump");
@@ -543,6 +551,7 @@ const wxString Config::sPathVideoDefaultFrameRate("/Video/DefaultFrameRate");
 const wxString Config::sPathVideoDefaultHeight("/Video/DefaultHeight");
 const wxString Config::sPathVideoDefaultScaling("/Video/DefaultScaling");
 const wxString Config::sPathVideoDefaultWidth("/Video/DefaultWidth");
+const wxString Config::sPathVideoDecodingThreads("/Video/DecodingThreads");
 const wxString Config::sPathVideoOverruleFourCC("/Video/FourCC");
 const wxString Config::sPathWorkspaceLanguage("/Workspace/Language");
 const wxString Config::sPathWorkspaceH("/Workspace/H");
@@ -42,19 +42,48 @@ std::map<LogLevelAvcodec, wxString> LogLevelAvcodecConverter::getMapToHumanReadi
 const int Avcodec::sMaxLogSize{ 500 };
 char* Avcodec::sFixedBuffer{ 0 };
 int Avcodec::sLevel{ AV_LOG_FATAL };
+boost::mutex Avcodec::sDecodingThreadsMutex;
+const int Avcodec::sMaximumThreadsPerDecoder{ 16 }; // More threads than this do not improve decoding speed (see MAX_AUTO_THREADS in avcodec).
+int Avcodec::sDecodingThreadsInUse{ 0 };
+int Avcodec::sDecodersActive{ 0 };
 
 //////////////////////////////////////////////////////////////////////////
 // INITIALIZATION
 //////////////////////////////////////////////////////////////////////////
 
+/// Lock manager used by avcodec for serializing its internal (global) actions.
+static int lockManager(void** mutex, enum AVLockOp op)
+{
+    switch (op)
+    {
+    case AV_LOCK_CREATE:
+        *mutex = new boost::mutex();
+        break;
+    case AV_LOCK_OBTAIN:
+        static_cast<boost::mutex*>(*mutex)->lock();
+        break;
+    case AV_LOCK_RELEASE:
+        static_cast<boost::mutex*>(*mutex)->unlock();
+        break;
+    case AV_LOCK_DESTROY:
+        delete static_cast<boost::mutex*>(*mutex);
+        *mutex = nullptr;
+        break;
+    }
+    return 0;
+}
+
 void Avcodec::init()
 {
     sFixedBuffer = new char[sMaxLogSize];
     av_register_all();
+    int result{ av_lockmgr_register(lockManager) };
+    ASSERT_ZERO(result);
 }
 
 void Avcodec::exit()
 {
+    av_lockmgr_register(nullptr);
     delete[] sFixedBuffer;
     sFixedBuffer = 0;
 }
@@ -65,6 +94,71 @@ void Avcodec::exit()
 
 boost::mutex Avcodec::sMutex;
 
+//////////////////////////////////////////////////////////////////////////
+// DECODING THREADS
+//////////////////////////////////////////////////////////////////////////
+
+// static
+int Avcodec::claimDecodingThreads()
+{
+    boost::mutex::scoped_lock lock(sDecodingThreadsMutex);
+    int budget{ getDecodingThreadBudget() };
+    int remaining{ std::max(0, budget - sDecodingThreadsInUse) };
+
+    // Divide the budget evenly between the decoders that are already active and
+    // the new decoder. Without this, the first opened decoder would claim all
+    // threads, leaving only one thread for all other decoders (multiple tracks).
+    int share{ std::max(1, budget / (sDecodersActive + 1)) };
+    int result{ std::max(1, std::min(std::min(share, remaining), sMaximumThreadsPerDecoder)) };
+
+    sDecodingThreadsInUse += result;
+    ++sDecodersActive;
+    VAR_DEBUG(result)(budget)(sDecodingThreadsInUse)(sDecodersActive);
+    return result;
+}
+
+// static
+void Avcodec::releaseDecodingThreads(int nThreads)
+{
+    boost::mutex::scoped_lock lock(sDecodingThreadsMutex);
+    ASSERT_MORE_THAN_ZERO(nThreads);
+    ASSERT_MORE_THAN_ZERO(sDecodersActive);
+    sDecodingThreadsInUse -= nThreads;
+    --sDecodersActive;
+    ASSERT_MORE_THAN_EQUALS_ZERO(sDecodingThreadsInUse);
+}
+
+// static
+bool Avcodec::reclaimDecodingThreads(int nThreads)
+{
+    boost::mutex::scoped_lock lock(sDecodingThreadsMutex);
+    ASSERT_MORE_THAN_ZERO(nThreads);
+    int budget{ getDecodingThreadBudget() };
+    int remaining{ std::max(0, budget - sDecodingThreadsInUse) };
+    int share{ std::max(1, budget / (sDecodersActive + 1)) };
+    if (nThreads > 1 && (nThreads > remaining || nThreads > share))
+    {
+        VAR_DEBUG(nThreads)(budget)(sDecodingThreadsInUse)(sDecodersActive);
+        return false;
+    }
+    sDecodingThreadsInUse += nThreads;
+    ++sDecodersActive;
+    VAR_DEBUG(nThreads)(budget)(sDecodingThreadsInUse)(sDecodersActive);
+    return true;
+}
+
+// static
+int Avcodec::getDecodingThreadBudget()
+{
+    int budget{ Config::get().read<int>(Config::sPathVideoDecodingThreads) };
+    if (budget == 0)
+    {
+        // Default: use all available cores.
+        budget = narrow_cast<int>(boost::thread::hardware_concurrency());
+    }
+    return std::max(1, budget);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // LOGGING
 //////////////////////////////////////////////////////////////////////////
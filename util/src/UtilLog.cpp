@@ -17,8 +17,8 @@
 
 #include "Dialog.h"
 #include "UtilAssert.h"
-#include "UtilFifo.h"
 #include "UtilPath.h"
+#include "UtilRingBuffer.h"
 #include "UtilStackWalker.h"
 #include "UtilThread.h"
 #ifdef _MSC_VER
@@ -156,7 +156,7 @@ private:
 
     bool mEnabled;
     boost::scoped_ptr<boost::thread> mThread;
-    Fifo<std::string> mFifo;
+    RingBuffer<std::string, RingBufferProducers::Multiple> mFifo;
     FILE* mFile;
 };
 
@@ -0,0 +1,108 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "UtilMemoryMappedFile.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+MemoryMappedFile::MemoryMappedFile(const wxFileName& path)
+{
+    if (!path.FileExists()) { return; }
+#ifdef _MSC_VER
+    mFile = CreateFileW(path.GetLongPath().wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        VAR_WARNING(path)(GetLastError());
+        return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+    {
+        return;
+    }
+    mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        VAR_WARNING(path)(GetLastError());
+        return;
+    }
+    void* data{ MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0) };
+    if (data == nullptr)
+    {
+        VAR_WARNING(path)(GetLastError());
+        return;
+    }
+    mData = static_cast<const char*>(data);
+    mSize = static_cast<size_t>(size.QuadPart);
+#else
+    int file{ open(path.GetLongPath().fn_str(), O_RDONLY) };
+    if (file < 0)
+    {
+        VAR_WARNING(path)(errno);
+        return;
+    }
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        void* data{ mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0) };
+        if (data != MAP_FAILED)
+        {
+            mData = static_cast<const char*>(data);
+            mSize = static_cast<size_t>(status.st_size);
+        }
+        else
+        {
+            VAR_WARNING(path)(errno);
+        }
+    }
+    close(file); // The mapping remains valid.
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+#ifdef _MSC_VER
+    if (mData != nullptr) { UnmapViewOfFile(mData); }
+    if (mMapping != nullptr) { CloseHandle(mMapping); }
+    if (mFile != INVALID_HANDLE_VALUE) { CloseHandle(mFile); }
+#else
+    if (mData != nullptr) { munmap(const_cast<char*>(mData), mSize); }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+const char* MemoryMappedFile::getData() const
+{
+    return mData;
+}
+
+size_t MemoryMappedFile::getSize() const
+{
+    return mSize;
+}
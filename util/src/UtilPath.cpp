@@ -17,6 +17,7 @@
 
 #include "UtilPath.h"
 
+#include <wx/file.h>
 #include <wx/msgdlg.h>
 #include "Config.h"
 
@@ -112,6 +113,49 @@ time_t lastModifiedTime(const wxFileName& filename)
     return result;
 }
 
+wxString FileIdentity::toString() const
+{
+    return wxString::Format("%s|%" PRIu64 "|%" PRId64, Path, static_cast<uint64_t>(Size), Modified);
+}
+
+boost::optional<FileIdentity> getIdentity(const wxFileName& file)
+{
+    wxULongLong size{ file.GetSize() };
+    wxDateTime modified{ file.GetModificationTime() };
+    if (size == wxInvalidSize || !modified.IsValid())
+    {
+        return boost::none; // Missing file, or removed just now.
+    }
+    FileIdentity result;
+    result.Path = file.GetLongPath();
+    result.Size = static_cast<int64_t>(size.GetValue());
+    result.Modified = static_cast<int64_t>(modified.GetTicks());
+    return result;
+}
+
+bool writeAtomically(const wxFileName& file, const std::function<bool(wxFile&)>& write)
+{
+    if (!file.DirExists() &&
+        !file.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+    {
+        VAR_WARNING(file);
+        return false;
+    }
+    wxFileName temp{ file };
+    temp.SetExt(file.GetExt() + "_tmp");
+    wxFile output;
+    bool ok{ output.Create(temp.GetLongPath(), true) && write(output) };
+    ok = output.Close() && ok;
+    if (!ok ||
+        !wxRenameFile(temp.GetLongPath(), file.GetLongPath(), true))
+    {
+        VAR_WARNING(temp)(file);
+        wxRemoveFile(temp.GetLongPath());
+        return false;
+    }
+    return true;
+}
+
 bool equals(const wxFileName& f1, const wxFileName& f2)
 {
     return toPath( f1 ).IsSameAs( toPath( f2 ) );
@@ -301,6 +345,29 @@ wxFileName getConfigFilePath()
     return result;
 }
 
+wxFileName getMediaCacheFilePath()
+{
+    wxFileName result{ getConfigFilePath() }; // Next to the config file, thus also one cache per executable name.
+    result.SetExt("mediacache");
+    return result;
+}
+
+wxFileName getAudioCachePath()
+{
+    wxFileName config{ getConfigFilePath() }; // Next to the config file, thus also one cache per executable name.
+    wxFileName result{ config.GetPath(), "" };
+    result.AppendDir(config.GetName() + ".audiocache");
+    return result;
+}
+
+wxFileName getAudioPeaksPath()
+{
+    wxFileName config{ getConfigFilePath() };
+    wxFileName result{ config.GetPath(), "" };
+    result.AppendDir(config.GetName() + ".peaks");
+    return result;
+}
+
 wxFileName getLanguagesPath()
 {
     wxFileName result{ util::path::getResourcesPath() };
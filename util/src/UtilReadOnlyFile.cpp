@@ -0,0 +1,123 @@
+// Copyright 2013-2016 Eric Raijmakers.
+//
+// This file is part of Vidiot.
+//
+// Vidiot is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Vidiot is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Vidiot. If not, see <http://www.gnu.org/licenses/>.
+
+#include "UtilReadOnlyFile.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// INITIALIZATION
+//////////////////////////////////////////////////////////////////////////
+
+ReadOnlyFile::ReadOnlyFile(const wxFileName& path)
+{
+#ifdef _MSC_VER
+    // Deny nothing: other applications may continue writing, renaming, or deleting the file.
+    // Sequential scan: reading ahead (by the cache manager) is the only hint available on all supported versions of Windows.
+    mFile = CreateFileW(path.GetLongPath().wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        VAR_WARNING(path)(GetLastError());
+        return;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(mFile, &size))
+    {
+        mSize = size.QuadPart;
+    }
+#else
+    mFile = open(path.GetLongPath().fn_str(), O_RDONLY);
+    if (mFile < 0)
+    {
+        VAR_WARNING(path)(errno);
+        return;
+    }
+    struct stat status;
+    if (fstat(mFile, &status) == 0)
+    {
+        mSize = status.st_size;
+    }
+#endif
+}
+
+ReadOnlyFile::~ReadOnlyFile()
+{
+#ifdef _MSC_VER
+    if (mFile != INVALID_HANDLE_VALUE) { CloseHandle(mFile); }
+#else
+    if (mFile >= 0) { close(mFile); }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GET/SET
+//////////////////////////////////////////////////////////////////////////
+
+bool ReadOnlyFile::isOpen() const
+{
+#ifdef _MSC_VER
+    return mFile != INVALID_HANDLE_VALUE;
+#else
+    return mFile >= 0;
+#endif
+}
+
+int64_t ReadOnlyFile::getSize() const
+{
+    return mSize;
+}
+
+int ReadOnlyFile::read(int64_t offset, void* buffer, int size) const
+{
+    if (!isOpen() || offset < 0 || size < 0) { return -1; }
+#ifdef _MSC_VER
+    OVERLAPPED position{ 0 }; // Synchronous read at the given offset.
+    position.Offset = static_cast<DWORD>(offset & 0xffffffff);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD n{ 0 };
+    if (!ReadFile(mFile, buffer, static_cast<DWORD>(size), &n, &position))
+    {
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+    return static_cast<int>(n);
+#else
+    ssize_t n{ 0 };
+    do
+    {
+        n = pread(mFile, buffer, static_cast<size_t>(size), static_cast<off_t>(offset));
+    }
+    while (n < 0 && errno == EINTR);
+    return static_cast<int>(n);
+#endif
+}
+
+void ReadOnlyFile::prefetch(int64_t offset, int64_t length) const
+{
+    if (!isOpen() || offset < 0 || offset >= mSize) { return; }
+    length = std::min(length, mSize - offset);
+    if (length <= 0) { return; }
+#ifdef _MSC_VER
+    // NOT: PrefetchVirtualMemory. Requires Windows 8 and a memory mapping.
+    // Reading ahead is done by the cache manager (see FILE_FLAG_SEQUENTIAL_SCAN).
+#else
+    posix_fadvise(mFile, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#endif
+}
@@ -23,6 +23,10 @@
 
 namespace util { namespace thread {
 
+/// Maximum number of threads used by runParallel. More threads than cores do
+/// not help, and many simultaneous requests only cause more disk seeks.
+static const unsigned int sThreadParallelMaximumThreads{ 8 };
+
 RunInMainScheduler::RunInMainScheduler()
 {
     Bind(wxEVT_THREAD, &RunInMainScheduler::onThreadEvent, this);
@@ -115,4 +119,48 @@ void setCurrentThreadName(const char* name)
 #endif
 }
 
+void runParallel(size_t count, const char* name, const std::function<bool(size_t)>& method, const std::function<void()>& whileWaiting, int interval)
+{
+    unsigned int nThreads{ std::min(sThreadParallelMaximumThreads, std::max(1u, boost::thread::hardware_concurrency())) };
+    nThreads = static_cast<unsigned int>(std::min<size_t>(nThreads, count));
+    VAR_DEBUG(name)(count)(nThreads);
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> stop{ false };
+    unsigned int running{ nThreads };
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::thread_group threads;
+    for (unsigned int i = 0; i < nThreads; ++i)
+    {
+        threads.create_thread([count, name, &method, &next, &stop, &running, &mutex, &condition]
+        {
+            setCurrentThreadName(name);
+            for (size_t index = next++; index < count && !stop; index = next++)
+            {
+                if (!method(index))
+                {
+                    stop = true;
+                }
+            }
+            boost::mutex::scoped_lock lock(mutex);
+            --running;
+            condition.notify_all();
+        });
+    }
+
+    if (whileWaiting)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        while (running > 0)
+        {
+            condition.timed_wait(lock, boost::posix_time::milliseconds(interval));
+            lock.unlock(); // Do not block the finishing threads during the callback.
+            whileWaiting();
+            lock.lock();
+        }
+    }
+    threads.join_all();
+}
+
 }} // namespace
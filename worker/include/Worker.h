@@ -17,13 +17,13 @@
 
 #pragma once
 
+#include "UtilRingBuffer.h"
 #include "UtilSingleInstance.h"
-#include "UtilFifo.h"
 #include "Work.h"
 
 namespace worker {
 
-typedef Fifo<WorkPtr> FifoWork;
+typedef RingBuffer<WorkPtr, RingBufferProducers::Multiple> FifoWork;
 
 /// This class is responsible for running lengthy tasks in the
 /// background.